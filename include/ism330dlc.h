@@ -0,0 +1,132 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_H
+#define ISM330DLC_H
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+// Raw sample set read in one go (output registers or one FIFO pattern tick)
+// and the CLOCK_MONOTONIC time it was sampled at. flags tells which parts of
+// the frame hold fresh data:
+#define FRAME_GYRO 0x01
+#define FRAME_ACCEL 0x02
+#define FRAME_TEMP 0x04
+#define FRAME_TIMESTAMP 0x08
+#define FRAME_MAG 0x10
+#define FRAME_RATE 0x20 // First frame at a new output data rate
+
+struct ism330dlc_frame {
+    uint64_t timestamp_ns;
+    int16_t temperature;
+    int16_t gyro[3];
+    int16_t accel[3];
+    int16_t mag[3];       // External magnetometer through the sensor hub
+    int16_t sensor;       // ID of the sensor it came from
+    uint32_t device_time; // 24 bit timestamp counter [ticks]
+    int flags;
+};
+
+// ISM330DLC driver functions. Every function takes the bus the device sits on
+// and its slave address so the same code runs against pi_i2c, the simulated
+// device or any other transport.
+
+// Say what a pi_i2c error code means (at DEBUG_LEVEL_WARN) and hand it back.
+// Failed transactions are already counted in bus_metrics:
+int i2c_error_handler(int errno);
+
+int scan_for_device(struct ism330dlc_bus *bus, int device_addr);
+
+int verify_device_id(struct ism330dlc_bus *bus, int device_addr);
+
+// Retry between WHO_AM_I reads while the device boots [us]
+#define PROBE_RETRY_US 1000
+
+// Gyroscope settling time coming out of power-down [s]
+#define GYRO_TURN_ON_S 0.07
+
+// Read WHO_AM_I straight from device_addr, retrying for up to
+// boot_timeout_us while the device boots. Falls back to scan_for_device() and
+// verify_device_id() if it never answers:
+int probe_device(struct ism330dlc_bus *bus, int device_addr,
+                 unsigned int boot_timeout_us);
+
+// Poll the status register and throw away the samples the accelerometer and
+// gyroscope give while settling at the ACCEL_*_HZ/GYRO_*_HZ rates they were
+// just set to. The next sample out is a valid one:
+int settle_device(struct ism330dlc_bus *bus, int device_addr, int accel_odr,
+                  int gyro_odr);
+
+// Set device configuration by writing to a register address
+int configure_device(struct ism330dlc_bus *bus, int device_addr, int reg_addr,
+                     int *configs, int num_configs);
+
+// Apply one of the register setting masks from ism330dlc_registers.h to a
+// register value and return the new value:
+int apply_config(int reg_value, int config);
+
+// Output data rate in Hz for an ACCEL_*_HZ, GYRO_*_HZ or FIFO_ODR_* setting:
+float odr_to_hz(int odr);
+
+// milli-g/LSB and milli-dps/LSB for an ACCEL_FS_* and GYRO_FS_* setting:
+float accel_sensitivity(int sensitivity);
+float gyro_sensitivity(int sensitivity);
+
+// Temperature, gyroscope and accelerometer output registers (OUT_TEMP_L to
+// OUTZ_H_XL) in one 14 byte auto-increment read. Set BDU in CTRL3_C so the
+// two halves of every axis come from the same sample:
+int get_frame(struct ism330dlc_bus *bus, int device_addr,
+              struct ism330dlc_frame *frame);
+
+// Unpack the 14 little endian temperature, gyroscope and accelerometer bytes
+// of the output registers into a frame:
+void unpack_frame(const int *raw, struct ism330dlc_frame *frame);
+
+// Longest get_frames() waits for a sample new for both sensors: two periods
+// at the slowest output data rate (12.5 Hz) [us]
+#define FRAME_WAIT_US 160000
+
+// Fill num_frames frames with consecutive samples. Each read takes the status
+// register along with the output registers and only keeps samples that are
+// new for both sensors, waiting poll_us between reads that are not. Gives up
+// once no sample came for FRAME_WAIT_US (a sensor powered down, say) and
+// returns the frames it got or -EDEVICEHUNG if there were none:
+int get_frames(struct ism330dlc_bus *bus, int device_addr,
+               struct ism330dlc_frame *frames, int num_frames,
+               unsigned int poll_us);
+
+// Get acceleration data and return in mili-g. Reads are retried under
+// RETRY_POLICY_DEFAULT (ism330dlc_recovery.h) and the error is returned once
+// the deadline passed:
+int get_accel(struct ism330dlc_bus *bus, int device_addr, int sensitivity,
+              float *accel_data);
+
+// Get gyroscope data and return in milli degrees per second (retried like
+// get_accel()):
+int get_gyro(struct ism330dlc_bus *bus, int device_addr, int sensitivity,
+             float *gyro_data);
+
+#endif
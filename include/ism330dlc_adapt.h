@@ -0,0 +1,120 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_ADAPT_H
+#define ISM330DLC_ADAPT_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_shadow.h"    // ISM330DLC shadow registers
+
+// Adaptive output data rate. Over every window_s of drained frames the
+// controller measures how much is going on: the RMS angular rate and the
+// RMS of the acceleration about its mean (gravity and any offset taken
+// out). Over the busy thresholds it steps both sensors up to the next ODR
+// straight away. Only once both have stayed under the lower quiet
+// thresholds for hold_s does it step back down, one ODR a window for as
+// long as it stays quiet, so a signal sitting between the two thresholds
+// does not make it flap. Above 208 Hz the gyroscope runs in
+// high-performance mode, at 208 Hz and below in normal mode (G_HM_MODE in
+// CTRL7_G).
+
+// 26 Hz to 1.66 kHz:
+#define ADAPT_NUM_RATES 7
+
+// Highest rate the gyroscope runs in normal mode at:
+#define ADAPT_NORMAL_MODE_MAX 3
+
+struct adapt_config {
+    int min_rate;       // Slowest rate (0 = 26 Hz, ADAPT_NUM_RATES - 1 =
+    int max_rate;       // 1.66 kHz) and fastest
+    float busy_dps;     // Step up with the gyroscope RMS over this [dps]
+    float busy_mg;      // or the acceleration RMS over this [milli-g]
+    float quiet_dps;    // Step down with both under these
+    float quiet_mg;
+    float hold_s;       // for this long [s]
+    float window_s;     // Measure over this much of the stream [s]
+};
+
+#define ADAPT_CONFIG_DEFAULT { \
+    .min_rate = 0,             \
+    .max_rate = 6,             \
+    .busy_dps = 10.0f,         \
+    .busy_mg = 30.0f,          \
+    .quiet_dps = 5.0f,         \
+    .quiet_mg = 15.0f,         \
+    .hold_s = 2.0f,            \
+    .window_s = 0.1f           \
+}
+
+struct adapt {
+    struct adapt_config config;
+
+    int rate;                  // Index of the rate running now
+    uint64_t quiet_ns;         // Quiet since (0 = busy or in between)
+
+    // Window being measured (window_ns = first frame time):
+    double accel_sum[3];
+    double accel_sq[3];
+    double gyro_sq;
+    int count;
+    uint64_t window_ns;
+
+    // Last measurement:
+    float gyro_dps;
+    float accel_mg;
+
+    // Statistics:
+    unsigned long switches;
+    uint64_t since_ns;         // When the current rate started
+    uint64_t rate_ns[ADAPT_NUM_RATES];
+};
+
+// Start out at rate at time now_ns:
+void adapt_init(struct adapt *adapt, const struct adapt_config *config,
+                int rate, uint64_t now_ns);
+
+// Index of the rate an ACCEL_*_HZ setting runs at, -1 if it is not one of
+// them:
+int adapt_rate_index(int accel_odr);
+
+// ACCEL_*_HZ, GYRO_*_HZ and FIFO_ODR_* settings of a rate:
+int adapt_accel_odr(int rate);
+int adapt_gyro_odr(int rate);
+int adapt_fifo_odr(int rate);
+
+// Add a drained batch to the window (scales in milli-g/LSB and
+// milli-dps/LSB) and say which rate to run at next. The controller does
+// not move until adapt_switched() says the device has:
+int adapt_update(struct adapt *adapt, const struct ism330dlc_frame *frames,
+                 int num_frames, float accel_scale, float gyro_scale);
+
+void adapt_switched(struct adapt *adapt, int rate, uint64_t now_ns);
+
+// Stage both ODRs and the gyroscope power mode of a rate (CTRL1_XL, CTRL2_G
+// and CTRL7_G):
+void adapt_stage(struct reg_shadow *regs, int rate);
+
+#endif
@@ -0,0 +1,99 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_BUS_H
+#define ISM330DLC_BUS_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Register bus used to talk to the ISM330DLC. Every transport (pi_i2c, the
+// simulated device, ...) fills out one of these so the driver does not care
+// what is on the other end of the wire.
+//
+// All functions follow the pi_i2c conventions: data is one byte per int and
+// a negative return value is one of the pi_i2c error codes (-ENACK, ...).
+// Reads and writes made through bus_read()/bus_write() are timed and their
+// errors counted in bus_metrics.
+struct ism330dlc_bus {
+    const char *name;
+
+    int (*read)(void *ctx, int device_addr, int reg_addr, int *data,
+                int num_bytes);
+    int (*write)(void *ctx, int device_addr, int reg_addr, int *data,
+                 int num_bytes);
+    int (*scan)(void *ctx, int *address_book);
+    int (*delay_us)(void *ctx, unsigned int usec);
+
+    // 4-wire SPI: nothing NACKs and the device_addr is ignored. The I2C
+    // interface of the device is turned off (I2C_disable) so it does not
+    // take SPI traffic for I2C:
+    int spi;
+
+    void *ctx;
+};
+
+// Bit-banged pi_i2c on the GPIO pins given to config_i2c():
+extern struct ism330dlc_bus pi_i2c_bus;
+
+// Register address a transport that splits a burst continues from after
+// num_bytes. With IF_INC the address moves on, but a FIFO burst starts at
+// FIFO_DATA_OUT_L again as FIFO_DATA_OUT_H rolls back to it:
+static inline int bus_burst_next(int reg_addr, int num_bytes) {
+    return reg_addr == FIFO_DATA_OUT_L ? reg_addr : reg_addr + num_bytes;
+}
+
+static inline int bus_read(struct ism330dlc_bus *bus, int device_addr,
+                           int reg_addr, int *data, int num_bytes) {
+    uint64_t start_ns = metrics_now_ns();
+
+    int ret = bus->read(bus->ctx, device_addr, reg_addr, data, num_bytes);
+
+    metrics_record(METRIC_READ, start_ns, ret);
+
+    return ret;
+}
+
+static inline int bus_write(struct ism330dlc_bus *bus, int device_addr,
+                            int reg_addr, int *data, int num_bytes) {
+    uint64_t start_ns = metrics_now_ns();
+
+    int ret = bus->write(bus->ctx, device_addr, reg_addr, data, num_bytes);
+
+    metrics_record(METRIC_WRITE, start_ns, ret);
+
+    return ret;
+}
+
+static inline int bus_scan(struct ism330dlc_bus *bus, int *address_book) {
+    return bus->scan(bus->ctx, address_book);
+}
+
+static inline int bus_delay_us(struct ism330dlc_bus *bus, unsigned int usec) {
+    return bus->delay_us(bus->ctx, usec);
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_CALIB_H
+#define ISM330DLC_CALIB_H
+
+// Include C standard libraries:
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+#include "ism330dlc.h"           // ISM330DLC driver
+
+// Online bias calibration. Frames are cut into short windows and a window
+// where every axis is quiet and the accelerometer reads about 1 g counts as
+// still. Still windows update:
+// - The gyroscope bias (the mean rate, smoothed over windows). It is applied
+//   on the host in the conversion stage (convert_scale_bias()).
+// - The accelerometer offset. With still windows in at least
+//   CALIB_FIT_ORIENTATIONS orientations it is the centre of a least squares
+//   sphere through them, otherwise only the error along gravity is known.
+//   It goes into X/Y/Z_OFS_USR so the device subtracts it from every sample
+//   (output registers and FIFO) at no cost to the host.
+// Profiles are saved per sensor so the next run starts calibrated.
+
+// Still window length and the fewest samples that make one:
+#define CALIB_WINDOW_NS 500000000ULL
+#define CALIB_WINDOW_MIN_SAMPLES 8
+
+// Still means every axis' standard deviation is under these and the
+// accelerometer magnitude is within CALIB_GRAVITY_TOLERANCE_MG of 1 g:
+#define CALIB_GYRO_STILL_MDPS 300.0f
+#define CALIB_ACCEL_STILL_MG 10.0f
+#define CALIB_GRAVITY_TOLERANCE_MG 150.0f
+
+// Weight of each still window in the running gyroscope bias:
+#define CALIB_GYRO_ALPHA 0.2f
+
+// Orientations are told apart when their gravity directions are more than
+// about 30 degrees apart:
+#define CALIB_MAX_ORIENTATIONS 6
+#define CALIB_SAME_ORIENTATION_COS 0.87f
+#define CALIB_FIT_ORIENTATIONS 4
+
+// X/Y/Z_OFS_USR weights (USR_OFF_W) [milli-g/LSB]:
+#define CALIB_OFFSET_FINE_MG (1000.0f / 1024)
+#define CALIB_OFFSET_COARSE_MG (1000.0f / 64)
+
+struct calib_profile {
+    float accel_offset[3]; // [milli-g]
+    float gyro_bias[3];    // [milli-dps]
+    unsigned long windows; // Still windows it was estimated from
+};
+
+struct calib {
+    struct calib_profile profile;
+
+    float accel_scale;     // [milli-g/LSB]
+    float gyro_scale;      // [milli-dps/LSB]
+
+    // Window being gathered (raw gyroscope then accelerometer axes):
+    uint64_t window_ns;
+    long count;
+    double sum[6];
+    double sum_sq[6];
+    int skip;              // Windows to throw away (offsets just changed)
+
+    // Offsets in the device and their register values:
+    float applied[3];      // [milli-g]
+    int offset_reg[3];
+    int coarse;
+    int offsets_due;       // Registers need writing (calib_offset_registers())
+
+    // Sphere fit normal equations and the orientations seen:
+    double ata[4][4];
+    double atb[4];
+    float orientation[CALIB_MAX_ORIENTATIONS][3];
+    int orientations;
+
+    // Gyroscope bias for the consumer thread [micro-dps]:
+    atomic_int gyro_bias_udps[3];
+
+    // Statistics:
+    unsigned long still;
+    unsigned long moving;
+};
+
+// accel_scale/gyro_scale are the sensor's milli-g/milli-dps per LSB. The
+// profile (or NULL) is where the estimate starts:
+void calib_init(struct calib *calib, float accel_scale, float gyro_scale,
+                const struct calib_profile *profile);
+
+// Feed one sensor's frames in time order. Returns 1 when the offset
+// registers should be rewritten:
+int calib_feed(struct calib *calib, const struct ism330dlc_frame *frames,
+               int num_frames);
+
+// X/Y/Z_OFS_USR values and USR_OFF_W (USR_OFF_W_2_POW_*) for the current
+// estimate:
+void calib_offset_registers(const struct calib *calib, int *offsets,
+                            int *weight);
+
+// The registers from calib_offset_registers() were written:
+void calib_offsets_written(struct calib *calib);
+
+// Current gyroscope bias [milli-dps] (from any thread):
+void calib_gyro_bias(struct calib *calib, float *gyro_bias);
+
+// Profile files hold one "name x y z" line per vector. Loading fails (-1)
+// if the file is missing or incomplete:
+int calib_load(struct calib_profile *profile, const char *path);
+int calib_save(const struct calib_profile *profile, const char *path);
+
+#endif
@@ -0,0 +1,99 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_CLOCK_H
+#define ISM330DLC_CLOCK_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Maps the device's 24 bit timestamp counter onto CLOCK_MONOTONIC. Counter
+// readings are unwrapped into a 64 bit tick count and an exponentially
+// weighted least squares fit of host time against ticks tracks both the
+// offset and the drift of the device oscillator. Frames drained from the
+// FIFO then get their sample instant from their own timestamp without a
+// clock_gettime() per sample.
+
+// TIMER_HR = 1 (page 69):
+#define CLOCK_TICK_NS 25000.0
+
+struct clock_model {
+    double tick_ns; // Nominal tick length
+
+    // Counter unwrapping:
+    int started;
+    uint32_t last_raw;
+    uint64_t ticks;
+
+    // Fit of host time against ticks about the first observation:
+    double forget;
+    double weight;
+    double mean_x;
+    double mean_y;
+    double var_x;
+    double cov_xy;
+    uint64_t origin_ticks;
+    uint64_t origin_ns;
+
+    // Host ns = origin_ns + offset_ns + rate * (ticks - origin_ticks):
+    double offset_ns;
+    double rate;
+
+    unsigned long observations;
+    unsigned long wraps;
+};
+
+void clock_model_init(struct clock_model *model, double tick_ns);
+
+// 24 bit counter reading to an unwrapped tick count. Readings may come a
+// little out of order (FIFO samples older than the last sync read):
+uint64_t clock_model_unwrap(struct clock_model *model, uint32_t raw);
+
+// Feed a pair of device ticks and the host time they were taken at:
+void clock_model_observe(struct clock_model *model, uint64_t ticks,
+                         uint64_t host_ns);
+
+// CLOCK_MONOTONIC time of an unwrapped tick count:
+uint64_t clock_model_host_ns(struct clock_model *model, uint64_t ticks);
+
+// Device drift against the host in parts per million:
+double clock_model_drift_ppm(struct clock_model *model);
+
+// Enable the counter at 25 us/LSB and reset it:
+int enable_device_timer(struct ism330dlc_bus *bus, int device_addr);
+
+// Restart the counter from zero (TIMESTAMP2_REG = AAh):
+int reset_device_timer(struct ism330dlc_bus *bus, int device_addr);
+
+// Read TIMESTAMP0_REG to TIMESTAMP2_REG in one burst:
+int get_device_time(struct ism330dlc_bus *bus, int device_addr,
+                    uint32_t *device_time);
+
+// Read the counter between two CLOCK_MONOTONIC readings and observe it at the
+// midpoint:
+int clock_model_sync(struct clock_model *model, struct ism330dlc_bus *bus,
+                     int device_addr);
+
+#endif
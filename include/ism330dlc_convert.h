@@ -0,0 +1,92 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_CONVERT_H
+#define ISM330DLC_CONVERT_H
+
+// Include C standard libraries:
+#include <stddef.h> // C Standard definitions
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc.h"           // ISM330DLC driver
+
+// Batch conversion of raw frames to physical units. The scale factors are
+// looked up once per sensor from tables indexed by the ACCEL_FS_*/GYRO_FS_*
+// register bits, then whole batches are converted with NEON (Arm) or SSE2
+// (x86) when the compiler targets them, or a plain loop otherwise. Define
+// ISM330DLC_NO_SIMD to force the plain loop. The gyroscope bias estimated by
+// calibration (ism330dlc_calib.h) is taken off in the same pass.
+
+// To convert from g's to SI units
+#define GRAVITY_CONSTANT 9.8066 // [m/s^2]
+
+// Output units:
+#define CONVERT_SI 0    // m/s^2 and rad/s
+#define CONVERT_MILLI 1 // milli-g and milli-dps
+
+struct convert_scale {
+    float gyro;      // Units per LSB
+    float accel;     // Units per LSB
+    int64_t gyro_q;  // Units per LSB in Q32 (fixed-point output)
+    int64_t accel_q; // Units per LSB in Q32 (fixed-point output)
+
+    // Gyroscope bias to subtract (4th lane 0 for the vector kernels) in
+    // output units and Q16.16:
+    float gyro_bias[4];
+    int32_t gyro_bias_q[3];
+    float gyro_unit; // Output units per milli-dps
+};
+
+// One converted frame, gyroscope then accelerometer like the raw frame:
+struct convert_sample {
+    float gyro[3];
+    float accel[3];
+};
+
+// Q16.16 fixed-point converted frame. Fits every full-scale in SI units:
+struct convert_sample_q {
+    int32_t gyro[3];
+    int32_t accel[3];
+};
+
+void convert_scale_init(struct convert_scale *scale, int accel_fs,
+                        int gyro_fs, int units);
+
+// Subtract a gyroscope bias [milli-dps] from every converted frame:
+void convert_scale_bias(struct convert_scale *scale, const float *gyro_bias);
+
+// Convert num_frames frames. Each frame is converted with
+// scales[frames[i].sensor] so merged frames from several sensors go through
+// in one call:
+void convert_frames(const struct convert_scale *scales,
+                    const struct ism330dlc_frame *frames, size_t num_frames,
+                    struct convert_sample *out);
+
+void convert_frames_q(const struct convert_scale *scales,
+                      const struct ism330dlc_frame *frames,
+                      size_t num_frames, struct convert_sample_q *out);
+
+// Name of the conversion kernel built in ("neon", "sse2" or "scalar"):
+const char *convert_kernel(void);
+
+#endif
@@ -0,0 +1,69 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_DEBUG_H
+#define ISM330DLC_DEBUG_H
+
+// Include C standard libraries:
+#include <stdio.h> // C Standard I/O libary
+
+// Driver messages by level. Anything above ISM330DLC_DEBUG_LEVEL compiles out
+// entirely so per-sample messages cost nothing unless asked for, e.g.:
+//
+//   make DEBUG_LOG=-DISM330DLC_DEBUG_LEVEL=4
+
+#define DEBUG_LEVEL_NONE 0
+#define DEBUG_LEVEL_ERROR 1 // Something failed
+#define DEBUG_LEVEL_WARN 2  // Bus errors that may be recovered from
+#define DEBUG_LEVEL_INFO 3  // Startup and configuration
+#define DEBUG_LEVEL_DEBUG 4 // Every sample and runtime register write
+
+#ifndef ISM330DLC_DEBUG_LEVEL
+#define ISM330DLC_DEBUG_LEVEL DEBUG_LEVEL_INFO
+#endif
+
+#if ISM330DLC_DEBUG_LEVEL >= DEBUG_LEVEL_ERROR
+#define PRINT_ERROR(...) printf(__VA_ARGS__)
+#else
+#define PRINT_ERROR(...) do { } while (0)
+#endif
+
+#if ISM330DLC_DEBUG_LEVEL >= DEBUG_LEVEL_WARN
+#define PRINT_WARN(...) printf(__VA_ARGS__)
+#else
+#define PRINT_WARN(...) do { } while (0)
+#endif
+
+#if ISM330DLC_DEBUG_LEVEL >= DEBUG_LEVEL_INFO
+#define PRINT_INFO(...) printf(__VA_ARGS__)
+#else
+#define PRINT_INFO(...) do { } while (0)
+#endif
+
+#if ISM330DLC_DEBUG_LEVEL >= DEBUG_LEVEL_DEBUG
+#define PRINT_DEBUG(...) printf(__VA_ARGS__)
+#else
+#define PRINT_DEBUG(...) do { } while (0)
+#endif
+
+#endif
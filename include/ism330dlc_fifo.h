@@ -0,0 +1,123 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_FIFO_H
+#define ISM330DLC_FIFO_H
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// FIFO streaming: the FIFO collects gyroscope and accelerometer data sets at
+// the FIFO output data rate and the host drains it in large bursts from
+// FIFO_DATA_OUT_L/H instead of reading the output registers sample by
+// sample.
+
+// 4 kbyte FIFO (page 31):
+#define FIFO_WORDS 2048
+
+// Longest FIFO pattern: decimations 3 and 32 only line up again after 96
+// ticks, with the other two data sets in every one of them:
+#define FIFO_PATTERN_MAX (2 * 3 * 96 + 3 * 96 / 3 + 3 * 96 / 32)
+
+struct fifo_config {
+    int mode;      // FIFO_CONTINUOUS_MODE, FIFO_FIFO_MODE, ...
+    int odr;       // FIFO_ODR_*
+    int dec_gyro;  // DEC_FIFO_GYRO_*
+    int dec_accel; // DEC_FIFO_XL_*
+    int dec_hub;   // DEC_DS3_FIFO_* (sensor hub data as the 3rd data set)
+    int dec_timestamp; // DEC_DS4_FIFO_* (timestamp as the 4th data set)
+    int watermark; // [words]
+};
+
+struct fifo_status {
+    int unread;    // [words]
+    int pattern;   // Pattern index of the next word out of the FIFO
+    int watermark;
+    int overrun;
+    int full;
+    int empty;
+};
+
+struct fifo_stream {
+    struct ism330dlc_bus *bus;
+    int device_addr;
+
+    // Data set (FRAME_GYRO/FRAME_ACCEL/FRAME_MAG/FRAME_TIMESTAMP) and axis
+    // of every word of the pattern and whether it is the last word of its
+    // FIFO tick:
+    int pattern_len;
+    uint8_t pattern_set[FIFO_PATTERN_MAX];
+    uint8_t pattern_axis[FIFO_PATTERN_MAX];
+    uint8_t pattern_last[FIFO_PATTERN_MAX];
+
+    int pattern_index;
+    int synced;
+    int skipping;
+    int backlog; // FIFO was still at the watermark after the last drain
+
+    struct ism330dlc_frame frame; // Frame being assembled
+
+    int buffer[2 * FIFO_WORDS];
+
+    // Statistics:
+    unsigned long bursts;
+    unsigned long words;
+    unsigned long frames;
+    unsigned long overruns;
+    unsigned long dropped; // Frames thrown away with a wrapped burst
+};
+
+// Configure FIFO_CTRL1 to FIFO_CTRL5 for streaming and set up the stream:
+int configure_fifo(struct ism330dlc_bus *bus, int device_addr,
+                   const struct fifo_config *config,
+                   struct fifo_stream *stream);
+
+// Set up the stream for a FIFO configured some other way (see
+// ism330dlc_shadow.h). The FIFO has to start out empty:
+int init_fifo_stream(struct ism330dlc_bus *bus, int device_addr,
+                     const struct fifo_config *config,
+                     struct fifo_stream *stream);
+
+// Set the stream up again for a new configuration of the same FIFO, keeping
+// its statistics. The FIFO has to start out empty:
+int restart_fifo_stream(const struct fifo_config *config,
+                        struct fifo_stream *stream);
+
+// FIFO_CTRL1 to FIFO_CTRL5 values for a configuration:
+void fifo_registers(const struct fifo_config *config, int *reg_value);
+
+// Whether the configuration puts the timestamp in the FIFO (dec_timestamp is
+// anything but DEC_DS4_FIFO_NOT_IN_FIFO):
+int fifo_timestamp_enabled(const struct fifo_config *config);
+
+// Read FIFO_STATUS1 to FIFO_STATUS4 in one burst:
+int get_fifo_status(struct ism330dlc_bus *bus, int device_addr,
+                    struct fifo_status *status);
+
+// Drain what is in the FIFO (up to max_frames) in one burst read and rebuild
+// frames from the FIFO pattern. A burst the FIFO wrapped under is dropped and
+// counted as an overrun. Returns the number of frames or an error:
+int drain_fifo(struct fifo_stream *stream, struct ism330dlc_frame *frames,
+               int max_frames);
+
+#endif
@@ -0,0 +1,96 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_FILTER_H
+#define ISM330DLC_FILTER_H
+
+// Include C standard libraries:
+#include <stddef.h> // C Standard definitions
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc.h"           // ISM330DLC driver
+
+// Decimated output streams taken from one acquisition. Each stream low-pass
+// filters every sensor's frames and keeps one in factor:
+// - FILTER_FIR: windowed-sinc FIR evaluated polyphase (only for the frames
+//   that are kept) with the cutoff at 80 % of the output Nyquist frequency
+// - FILTER_CIC: 3rd order cascaded integrator-comb in integer arithmetic,
+//   cheaper but with passband droop
+// Output frames are raw frames like the input (so conversion, fusion and the
+// writers take them as they are), stamped at the centre of the filter so
+// the group delay is accounted for. The device's own filtering (ODR and the
+// gyroscope LPF1, sensor_config.gyro_lpf1) comes first.
+
+#define FILTER_FIR 0
+#define FILTER_CIC 1
+
+#define FILTER_MAX_SENSORS 8
+#define FILTER_MAX_TAPS 255
+#define FILTER_MAX_FACTOR 64
+#define FILTER_CIC_ORDER 3
+
+// Input samples kept (and the history length) per sensor:
+#define FILTER_HISTORY 256
+
+// Gyroscope then accelerometer axes:
+#define FILTER_CHANNELS 6
+
+struct decimator {
+    int phase;            // Inputs since the last output
+    int head;             // Oldest sample in history
+
+    // Inputs twice over so the newest FILTER_HISTORY are always contiguous:
+    float history[FILTER_CHANNELS][2 * FILTER_HISTORY];
+    uint64_t stamps[2 * FILTER_HISTORY];
+
+    // CIC integrator and comb states (wrap around by design):
+    uint64_t integrator[FILTER_CHANNELS][FILTER_CIC_ORDER];
+    uint64_t comb[FILTER_CHANNELS][FILTER_CIC_ORDER];
+};
+
+struct filter_stream {
+    int type;
+    int factor;
+
+    int num_taps;
+    float taps[FILTER_MAX_TAPS];
+    int delay;            // Group delay [input samples]
+    int64_t cic_gain;     // factor^FILTER_CIC_ORDER
+
+    struct decimator sensors[FILTER_MAX_SENSORS];
+
+    unsigned long frames_in;
+    unsigned long frames_out;
+};
+
+// Set up a stream that keeps one frame in factor (2 to FILTER_MAX_FACTOR):
+int filter_stream_init(struct filter_stream *stream, int type, int factor);
+
+// Filter and decimate num_frames merged frames (frames[i].sensor below
+// FILTER_MAX_SENSORS). out can be frames itself since it never gets ahead
+// of the input. Returns the number of frames out:
+size_t filter_stream_run(struct filter_stream *stream,
+                         const struct ism330dlc_frame *frames,
+                         size_t num_frames, struct ism330dlc_frame *out);
+
+#endif
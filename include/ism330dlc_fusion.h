@@ -0,0 +1,109 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_FUSION_H
+#define ISM330DLC_FUSION_H
+
+// Include C standard libraries:
+#include <stddef.h> // C Standard definitions
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_convert.h"   // ISM330DLC unit conversion
+
+// Incremental attitude estimation. Every frame updates the orientation
+// quaternion of the sensor it came from, integrating the gyroscope over the
+// time since that sensor's previous frame and pulling towards the gravity
+// direction the accelerometer sees (Madgwick's gradient descent step or
+// Mahony's PI feedback). The cost per update is fixed so attitude keeps up
+// with the full output data rate.
+//
+// fusion_update() runs in float. fusion_update_q() is Mahony in Q30/Q16.16
+// fixed-point, for Pi models where that is cheaper. fusion_frames() uses the
+// fixed-point one when built with ISM330DLC_FUSION_FIXED.
+
+// Filters:
+#define FUSION_MADGWICK 0
+#define FUSION_MAHONY 1
+
+// Default gains:
+#define FUSION_MADGWICK_BETA 0.1f // Gradient descent step [rad/s]
+#define FUSION_MAHONY_KP 0.5f     // Proportional feedback [1/s]
+#define FUSION_MAHONY_KI 0.0f     // Integral feedback [1/s^2]
+
+// A gap longer than this (or time going backwards) restarts integration
+// rather than integrating across it:
+#define FUSION_MAX_DT_S 0.1f
+
+struct fusion {
+    int filter;
+    float beta;
+    float kp;
+    float ki;
+
+    // Orientation of the sensor frame (w, x, y, z) and Mahony's integral
+    // term:
+    float q[4];
+    float integral[3];
+
+    // Fixed-point state (Q30 quaternion, Q16.16 integral term and gains):
+    int32_t q_q[4];
+    int32_t integral_q[3];
+    int32_t kp_q;
+    int32_t ki_q;
+
+    uint64_t last_ns;
+    int started;
+
+    unsigned long updates;
+    unsigned long restarts;
+};
+
+// Attitude after a frame:
+struct fusion_attitude {
+    uint64_t timestamp_ns;
+    int sensor;
+    float q[4];
+};
+
+void fusion_init(struct fusion *fusion, int filter);
+
+// One sample in SI units (rad/s, m/s^2) taken at timestamp_ns:
+void fusion_update(struct fusion *fusion, const struct convert_sample *sample,
+                   uint64_t timestamp_ns);
+
+// One sample in Q16.16 SI units (convert_frames_q() with CONVERT_SI):
+void fusion_update_q(struct fusion *fusion,
+                     const struct convert_sample_q *sample,
+                     uint64_t timestamp_ns);
+
+// Convert and fuse a batch of merged frames. fusions and scales (CONVERT_SI)
+// are indexed by frames[i].sensor. Fills out one attitude per frame:
+void fusion_frames(struct fusion *fusions, const struct convert_scale *scales,
+                   const struct ism330dlc_frame *frames, size_t num_frames,
+                   struct fusion_attitude *out);
+
+// Roll, pitch and yaw (Z-Y-X) of a quaternion [rad]:
+void fusion_euler(const float *q, float *euler);
+
+#endif
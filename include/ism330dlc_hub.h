@@ -0,0 +1,84 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_HUB_H
+#define ISM330DLC_HUB_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+#include "ism330dlc_shadow.h"    // ISM330DLC shadow registers
+
+// Sensor hub: the ISM330DLC's I2C master polls an external magnetometer on
+// its auxiliary bus (SDx/SCx) every accelerometer sample and puts what it
+// read in SENSORHUB1_REG onwards, right after the accelerometer output
+// registers, and in the FIFO as the 3rd data set. The host gets 9-axis
+// frames from the same burst reads as before and the magnetometer is
+// sampled in step with the accelerometer without any host transactions.
+//
+// The magnetometer is set up through slave 0 in write mode, one register per
+// sensor hub cycle, then slave 0 is left reading its output registers.
+
+// LIS2MDL magnetometer (the ISM330DLC application note pairing):
+#define LIS2MDL_ADDR 0x1E
+#define LIS2MDL_WHO_AM_I 0x4F
+#define LIS2MDL_ID 0x40
+#define LIS2MDL_CFG_REG_A 0x60
+#define LIS2MDL_CFG_REG_C 0x62
+#define LIS2MDL_OUTX_L_REG 0x68
+
+// Temperature compensated, 100 Hz, continuous mode:
+#define LIS2MDL_CFG_REG_A_100_HZ 0x8C
+
+// Block data update:
+#define LIS2MDL_CFG_REG_C_BDU 0x10
+
+// milli-gauss/LSB:
+#define LIS2MDL_SENSITIVITY 1.5f
+
+// Bytes of magnetometer output read every cycle (X, Y and Z):
+#define HUB_MAG_BYTES 6
+
+// Wait this long for one sensor hub cycle (a few accelerometer samples at
+// the slowest ODR the hub is used at):
+#define HUB_TIMEOUT_US 500000
+#define HUB_POLL_US 1000
+
+struct hub_config {
+    int mag_addr; // 7-bit address on the auxiliary bus (0 = no sensor hub)
+    int pull_up;  // Use the internal pull-ups on SDx/SCx
+};
+
+// Check the magnetometer answers, configure it and leave the hub reading it.
+// The accelerometer has to be running since its samples trigger the hub.
+// MASTER_CONFIG and CTRL10_C go through the shadow so the hub is back on
+// after shadow_restore(), but the slave registers (embedded functions bank
+// A) do not, so call this again after a power cycle:
+int hub_open(struct reg_shadow *regs, const struct hub_config *config);
+
+// Magnetometer axes from the HUB_MAG_BYTES read out of SENSORHUB1_REG
+// onwards:
+void hub_unpack(const int *raw, int16_t *mag);
+
+#endif
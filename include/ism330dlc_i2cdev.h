@@ -0,0 +1,84 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_I2CDEV_H
+#define ISM330DLC_I2CDEV_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+// Include Linux headers:
+#include <linux/i2c.h>  // Linux I2C messages
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Register bus on a kernel I2C adapter through /dev/i2c-<adapter>. A read
+// is one I2C_RDWR combined transaction: the register address write and the
+// data read with a repeated start in between, so the whole transfer is the
+// adapter driver's and the host only sleeps in the ioctl. The bus clock
+// (400 kHz, 1 MHz, ...) is set on the adapter, e.g. dtparam=
+// i2c_arm_baudrate=1000000 on a Pi, and read back from the device tree.
+//
+// Adapters without plain I2C transfers (the i2c-stub module) are driven
+// through SMBus I2C block reads and writes instead, 32 bytes at a time.
+//
+// Kernel errors come back as pi_i2c codes: a NACK (ENXIO, EREMOTEIO) as
+// -ENACK, a timeout as -EBUSLOCKUP so a stuck bus is power cycled, a lost
+// arbitration as -EFAILSTCOND and anything else as -EBUSUNKERR.
+
+// Longest transfer (a full FIFO drain):
+#define I2CDEV_MAX_BYTES 4096
+
+// SMBus block transfers:
+#define I2CDEV_BLOCK_BYTES 32
+
+struct i2cdev {
+    int adapter;
+    int fd;                    // -1 with a stand-in
+    unsigned long funcs;       // I2C_FUNCS of the adapter
+    unsigned int clock_hz;     // From the device tree (0 = unknown)
+    int slave_addr;            // Last I2C_SLAVE (SMBus transfers)
+
+    // Stand-in for the kernel: gets the I2C_RDWR messages and returns 0 or
+    // a negative errno (NULL = the adapter through fd):
+    int (*transfer)(void *ctx, struct i2c_msg *msgs, int num_msgs);
+    void *ctx;
+
+    // Statistics:
+    unsigned long transfers;
+};
+
+// Open /dev/i2c-<adapter> and fill out bus to go through it:
+int i2cdev_open(struct i2cdev *dev, struct ism330dlc_bus *bus, int adapter);
+
+// Same as an adapter with I2C_FUNC_I2C but every transfer goes to
+// transfer(ctx, ...) instead of the kernel (sim_i2c_transfer() puts the
+// simulated device there):
+void i2cdev_standin(struct i2cdev *dev, struct ism330dlc_bus *bus,
+                    int (*transfer)(void *ctx, struct i2c_msg *msgs,
+                                    int num_msgs),
+                    void *ctx);
+
+void i2cdev_close(struct i2cdev *dev);
+
+#endif
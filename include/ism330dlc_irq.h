@@ -0,0 +1,70 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_IRQ_H
+#define ISM330DLC_IRQ_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Interrupt driven acquisition: data-ready or the FIFO watermark is routed
+// to INT1 and the host blocks on the edge instead of sleeping between reads.
+//
+// An edge source is anything that can block until INT1 rises: a gpiochip
+// line or the simulated device.
+struct ism330dlc_irq {
+    const char *name;
+
+    // Block until the next rising edge or timeout_ms. On success the edge
+    // time (CLOCK_MONOTONIC) goes into timestamp_ns. Returns 0 on an edge,
+    // 1 on a timeout and negative on error:
+    int (*wait)(void *ctx, int timeout_ms, uint64_t *timestamp_ns);
+
+    void *ctx;
+};
+
+struct gpio_irq {
+    int chip_fd;
+    int event_fd;
+};
+
+static inline int irq_wait(struct ism330dlc_irq *irq, int timeout_ms,
+                           uint64_t *timestamp_ns) {
+    return irq->wait(irq->ctx, timeout_ms, timestamp_ns);
+}
+
+// Route INT1_CTRL settings (INT1_DRDY_XL_ENABLED, INT1_FTH_ENABLED, ...) to
+// INT1. Data-ready is pulsed so every sample gives its own edge:
+int route_int1(struct ism330dlc_bus *bus, int device_addr, int *configs,
+               int num_configs);
+
+// Rising edges of a line on a gpiochip (e.g. /dev/gpiochip0) through the
+// Linux line event interface:
+int gpio_irq_open(struct gpio_irq *gpio, struct ism330dlc_irq *irq,
+                  const char *chip_path, int line);
+
+void gpio_irq_close(struct gpio_irq *gpio);
+
+#endif
@@ -0,0 +1,103 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_LOG_H
+#define ISM330DLC_LOG_H
+
+// Include C standard libraries:
+#include <stddef.h> // C Standard definitions
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc.h"           // ISM330DLC driver
+
+// Compact binary sample log. A fixed header describing the run is followed by
+// fixed-size records of raw axes and a timestamp. The writer appends through
+// a shared memory mapping and updates the record count in the header after
+// every batch, so a run that dies part way through still leaves every batch
+// before it readable.
+
+#define LOG_MAGIC "ISM330LG"
+#define LOG_VERSION 2
+
+// The file grows by this much at a time:
+#define LOG_CHUNK_BYTES (4 << 20)
+
+struct log_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t reserved;
+    float accel_odr;         // [Hz]
+    float gyro_odr;          // [Hz]
+    int32_t accel_fs;        // ACCEL_FS_* setting
+    int32_t gyro_fs;         // GYRO_FS_* setting
+    float accel_scale;       // [milli-g/LSB]
+    float gyro_scale;        // [milli-dps/LSB]
+    uint64_t records;        // Records committed so far
+    uint8_t pad[8];
+};
+
+struct log_record {
+    uint64_t timestamp_ns;   // CLOCK_MONOTONIC
+    int16_t gyro[3];
+    int16_t accel[3];
+    int16_t temperature;
+    uint8_t flags;           // FRAME_* bits
+    uint8_t sensor;          // ID of the sensor it came from
+};
+
+struct log_writer {
+    int fd;
+    uint8_t *map;
+    size_t mapped;
+    uint64_t records;
+};
+
+// Read-only view of a log (a live one or one left behind by a crash):
+struct log_view {
+    int fd;
+    const uint8_t *map;
+    size_t mapped;
+    const struct log_header *header;
+    const struct log_record *records;
+    uint64_t num_records;
+};
+
+// Create path and write the header from info (counts are filled in):
+int log_open(struct log_writer *log, const char *path,
+             const struct log_header *info);
+
+int log_append(struct log_writer *log, const struct ism330dlc_frame *frames,
+               size_t num_frames);
+
+// Trim the file to what was written and close it:
+int log_close(struct log_writer *log);
+
+// Map a log for reading. Records past the committed count that were written
+// before a crash are recovered too:
+int log_map(struct log_view *view, const char *path);
+
+void log_unmap(struct log_view *view);
+
+#endif
@@ -0,0 +1,100 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_METRICS_H
+#define ISM330DLC_METRICS_H
+
+// Include C standard libraries:
+#include <stdio.h>     // C Standard I/O libary
+#include <stdint.h>    // C Standard integer types
+#include <time.h>      // C Standard date and time manipulation
+#include <stdatomic.h> // C Standard atomics
+
+// Bus health counters shared by every bus and thread: latency histograms of
+// register reads, register writes and FIFO drains, error counts by pi_i2c
+// error code and retries. Updates are relaxed atomic adds so recording costs
+// a few nanoseconds next to a transaction of tens of microseconds. Dump with
+// metrics_dump() (test_ism330dlc does on SIGUSR1 and at exit).
+
+// Operations:
+#define METRIC_READ 0
+#define METRIC_WRITE 1
+#define METRIC_FIFO_DRAIN 2
+#define METRIC_OPS 3
+
+// Bucket 0 is under 1 us, bucket k is [2^(k-1), 2^k) us and the last one is
+// open ended:
+#define METRICS_BUCKETS 24
+
+// Error counters indexed by -error (pi_i2c codes are small):
+#define METRICS_ERRORS 16
+
+struct metrics_hist {
+    atomic_ulong count;
+    atomic_ulong errors;
+    atomic_ullong total_ns;
+    atomic_ullong max_ns;
+    atomic_ulong buckets[METRICS_BUCKETS];
+};
+
+struct ism330dlc_metrics {
+    struct metrics_hist ops[METRIC_OPS];
+    atomic_ulong errors[METRICS_ERRORS];
+    atomic_ulong retries;
+};
+
+extern struct ism330dlc_metrics bus_metrics;
+
+static inline uint64_t metrics_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Add one duration to a histogram (also used for other latencies, see
+// ism330dlc_rt.h):
+void metrics_hist_record(struct metrics_hist *hist, uint64_t ns);
+
+// Upper edge of the bucket holding the given fraction of the durations [us]:
+unsigned long metrics_hist_percentile(struct metrics_hist *hist,
+                                      double fraction);
+
+// Print a line per non-empty bucket, each starting with prefix:
+void metrics_hist_dump(struct metrics_hist *hist, const char *prefix,
+                       FILE *out);
+
+// Record an operation that started at start_ns and returned ret (negative
+// pi_i2c error codes are counted):
+void metrics_record(int op, uint64_t start_ns, int ret);
+
+static inline void metrics_retry(void) {
+    atomic_fetch_add_explicit(&bus_metrics.retries, 1, memory_order_relaxed);
+}
+
+void metrics_reset(void);
+
+void metrics_dump(FILE *out);
+
+#endif
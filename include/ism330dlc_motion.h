@@ -0,0 +1,75 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_MOTION_H
+#define ISM330DLC_MOTION_H
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+#include "ism330dlc_shadow.h"    // ISM330DLC shadow registers
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Motion triggered acquisition. While idle the device runs the accelerometer
+// alone at a low ODR and its embedded functions watch for wake-up (any axis
+// of the high-pass filtered acceleration over a threshold) and free-fall
+// (every axis under a threshold), latched in WAKE_UP_SRC and routed to INT1
+// through MD1_CFG. The host only hears from it when something happens (see
+// sensor_config.motion_trigger).
+
+// Events read from WAKE_UP_SRC:
+#define MOTION_WAKE_UP 0x01
+#define MOTION_FREE_FALL 0x02
+
+struct motion_config {
+    int idle_odr;          // ACCEL_*_HZ while idle (gyroscope powered down)
+    float wake_mg;         // Wake-up threshold [milli-g]
+    int wake_samples;      // Samples over it before waking up (1 to 4)
+    float free_fall_mg;    // Free-fall threshold, 156 to 500 (0 = off)
+    int free_fall_samples; // Samples under it before falling (1 to 63)
+    float pretrigger_s;    // FIFO history kept from before the event [s]
+    float inactive_s;      // Go back to idle without wake-up for this long
+};
+
+#define MOTION_CONFIG_DEFAULT { \
+    .idle_odr = ACCEL_26_HZ,    \
+    .wake_mg = 63.0f,           \
+    .wake_samples = 1,          \
+    .free_fall_mg = 312.0f,     \
+    .free_fall_samples = 6,     \
+    .pretrigger_s = 1.0f,       \
+    .inactive_s = 2.0f          \
+}
+
+// Stage the detection thresholds (TAP_CFG, WAKE_UP_THS, WAKE_UP_DUR and
+// FREE_FALL) for an accelerometer at full-scale accel_fs. Wake-up and
+// free-fall stay latched until WAKE_UP_SRC is read:
+void motion_stage(struct reg_shadow *regs, const struct motion_config *config,
+                  int accel_fs);
+
+// Stage wake-up and free-fall routing to INT1 (MD1_CFG) on or off:
+void motion_route(struct reg_shadow *regs, const struct motion_config *config,
+                  int enabled);
+
+// Read and clear WAKE_UP_SRC. Returns MOTION_* events or a pi_i2c error:
+int motion_events(struct ism330dlc_bus *bus, int device_addr);
+
+#endif
@@ -0,0 +1,101 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_RECOVERY_H
+#define ISM330DLC_RECOVERY_H
+
+// Include C standard libraries:
+#include <stdatomic.h> // C Standard atomics
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Bounded reads and bus recovery. A read is retried with a doubling backoff
+// until the sample's deadline and then given up on, so the caller marks the
+// sample missing instead of blocking. Consecutive EBUSLOCKUP/EDEVICEHUNG
+// errors mean the device is holding the bus, and only a power cycle
+// releases it. After that the device is back at its defaults and whoever
+// uses it has to set it up again (ism330dlc_sensor.h does this on its own).
+//
+// Worst case a read returns after deadline_us plus one transaction, or one
+// power cycle when it escalates.
+
+struct retry_policy {
+    unsigned int deadline_us;    // Budget for one sample, retries included
+    unsigned int backoff_us;     // Wait after the first failure
+    unsigned int backoff_max_us; // Cap on the doubling wait
+    int lockups_to_power_cycle;  // Consecutive lockups before power cycling
+};
+
+#define RETRY_POLICY_DEFAULT { \
+    .deadline_us = 5000,       \
+    .backoff_us = 100,         \
+    .backoff_max_us = 2000,    \
+    .lockups_to_power_cycle = 3 \
+}
+
+// Power switch of one or more devices (DEVICE_POWER_GPIO, the simulated
+// device, ...). Every cycle bumps generation so each device on the line can
+// tell it lost its configuration:
+struct ism330dlc_power {
+    const char *name;
+    int (*cycle)(void *ctx);
+    void *ctx;
+
+    atomic_uint generation;
+};
+
+struct bus_recovery {
+    struct retry_policy policy;
+    struct ism330dlc_power *power; // 0 = can not power cycle
+
+    int lockups;                   // Consecutive lockup errors
+
+    // Statistics:
+    unsigned long misses;          // Reads given up on at the deadline
+};
+
+void recovery_init(struct bus_recovery *recovery,
+                   const struct retry_policy *policy,
+                   struct ism330dlc_power *power);
+
+// Power cycle everything on the switch:
+int power_cycle(struct ism330dlc_power *power);
+
+static inline unsigned int power_generation(struct ism330dlc_power *power) {
+    return power ? atomic_load(&power->generation) : 0;
+}
+
+// Account for a failed transaction and escalate to a power cycle after
+// lockups_to_power_cycle lockups in a row. Returns 1 if it power cycled:
+int recovery_failed(struct bus_recovery *recovery, int error);
+
+static inline void recovery_succeeded(struct bus_recovery *recovery) {
+    recovery->lockups = 0;
+}
+
+// bus_read() retried under the policy. Returns 0 or the last error once the
+// deadline passed or the device was power cycled:
+int read_deadline(struct ism330dlc_bus *bus, struct bus_recovery *recovery,
+                  int device_addr, int reg_addr, int *data, int num_bytes);
+
+#endif
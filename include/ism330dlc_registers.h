@@ -118,6 +118,12 @@
 #define Y_OFS_USR 0x74                // Accelerometer user offset correction
 #define Z_OFS_USR 0x75                // Accelerometer user offset correction
 
+// Embedded functions register addresses, bank A (FUNC_CFG_EN set) (page 86):
+#define SLV0_ADD 0x02                 // Sensor hub slave 0 address
+#define SLV0_SUBADD 0x03              // Sensor hub slave 0 register
+#define SLAVE0_CONFIG 0x04            // Sensor hub slave 0 configuration
+#define DATAWRITE_SRC_MODE_SUB_SLV0 0x0E // Byte written to slave 0
+
 // Register defaults (page 38 to 40):
 #define FUNC_CFG_ACCESS_DEFAULT 0x00         // (= 00000000)
 #define SENSOR_SYNC_TIME_FRAME_DEFAULT 0x00  // (= 00000000)
@@ -160,15 +166,131 @@
 #define Y_OFS_USR_DEFAULT 0x00               // (= 00000000)
 #define Z_OFS_USR_DEFAULT 0x00               // (= 00000000)
 
+// FIFO status register bits (page 68):
+#define FIFO_STATUS2_WATERM 0x80          // Watermark level reached
+#define FIFO_STATUS2_OVER_RUN 0x40        // FIFO completely filled
+#define FIFO_STATUS2_FIFO_FULL_SMART 0x20 // FIFO full on next ODR cycle
+#define FIFO_STATUS2_FIFO_EMPTY 0x10      // FIFO empty
+#define FIFO_STATUS2_DIFF_FIFO 0x07       // Unread words [10:8]
+
+// Writing this to TIMESTAMP2_REG resets the timestamp counter (page 69):
+#define TIMESTAMP_RESET 0xAA
+
+// Status register bits (page 63):
+#define STATUS_XLDA 0x01 // Accelerometer new data available
+#define STATUS_GDA 0x02  // Gyroscope new data available
+#define STATUS_TDA 0x04  // Temperature new data available
+
+// Embedded function source register bits (page 71):
+#define FUNC_SRC1_SENSORHUB_END_OP 0x01 // Sensor hub communication done
+
+// Slave address read bit of SLV0_ADD (page 87):
+#define SLV0_ADD_READ 0x01
+
+// Wake-up source register bits (page 61):
+#define WAKE_UP_SRC_FF_IA 0x20          // Free-fall event
+#define WAKE_UP_SRC_SLEEP_STATE_IA 0x10 // Inactivity event
+#define WAKE_UP_SRC_WU_IA 0x08          // Wake-up event
+#define WAKE_UP_SRC_X_WU 0x04           // Wake-up on X
+#define WAKE_UP_SRC_Y_WU 0x02           // Wake-up on Y
+#define WAKE_UP_SRC_Z_WU 0x01           // Wake-up on Z
+
 // Register setting masks (page 41-85):
 // (OR the starting bit location of the setting at the end of the byte)
 // (OR the stoping bit location of the setting at the end of the byte)
+#define BDU_ENABLED 0x01 | (0x06 << 8) | (0x06 << 12)
+#define BDU_DISABLED 0x00 | (0x06 << 8) | (0x06 << 12)
+
+#define SW_RESET_ENABLED 0x01 | (0x00 << 8) | (0x00 << 12)
+
+#define IF_INC_ENABLED 0x01 | (0x02 << 8) | (0x02 << 12)
+#define IF_INC_DISABLED 0x00 | (0x02 << 8) | (0x02 << 12)
+
+#define INT1_DRDY_XL_ENABLED 0x01 | (0x00 << 8) | (0x00 << 12)
+#define INT1_DRDY_XL_DISABLED 0x00 | (0x00 << 8) | (0x00 << 12)
+#define INT1_DRDY_G_ENABLED 0x01 | (0x01 << 8) | (0x01 << 12)
+#define INT1_DRDY_G_DISABLED 0x00 | (0x01 << 8) | (0x01 << 12)
+#define INT1_FTH_ENABLED 0x01 | (0x03 << 8) | (0x03 << 12)
+#define INT1_FTH_DISABLED 0x00 | (0x03 << 8) | (0x03 << 12)
+
+#define INT1_WU_ENABLED 0x01 | (0x05 << 8) | (0x05 << 12)
+#define INT1_WU_DISABLED 0x00 | (0x05 << 8) | (0x05 << 12)
+#define INT1_FF_ENABLED 0x01 | (0x04 << 8) | (0x04 << 12)
+#define INT1_FF_DISABLED 0x00 | (0x04 << 8) | (0x04 << 12)
+
+#define INTERRUPTS_ENABLE_ENABLED 0x01 | (0x07 << 8) | (0x07 << 12)
+#define INTERRUPTS_ENABLE_DISABLED 0x00 | (0x07 << 8) | (0x07 << 12)
+
+#define SLOPE_FDS_HIGH_PASS 0x01 | (0x04 << 8) | (0x04 << 12)
+#define SLOPE_FDS_SLOPE 0x00 | (0x04 << 8) | (0x04 << 12)
+
+#define LIR_ENABLED 0x01 | (0x00 << 8) | (0x00 << 12)
+#define LIR_DISABLED 0x00 | (0x00 << 8) | (0x00 << 12)
+
+// Threshold and duration fields (OR in the value):
+#define WK_THS_FIELD (0x00 << 8) | (0x05 << 12)
+#define WAKE_DUR_FIELD (0x05 << 8) | (0x06 << 12)
+#define FF_DUR5_FIELD (0x07 << 8) | (0x07 << 12)
+#define FF_THS_FIELD (0x00 << 8) | (0x02 << 12)
+#define FF_DUR_FIELD (0x03 << 8) | (0x07 << 12)
+
+#define DRDY_PULSED_ENABLED 0x01 | (0x07 << 8) | (0x07 << 12)
+#define DRDY_PULSED_DISABLED 0x00 | (0x07 << 8) | (0x07 << 12)
+
 #define FIFO_BYPASS_MODE 0x00 | (0x00 << 8) | (0x02 << 12)
 #define FIFO_FIFO_MODE 0x01| (0x00 << 8) | (0x02 << 12)
 #define FIFO_CONTINUOUS_FIFO_MODE 0x03 | (0x00 << 8) | (0x02 << 12)
 #define FIFO_BYPASS_CONTINUOUS_MODE 0x04 | (0x00 << 8) | (0x02 << 12)
 #define FIFO_CONTINUOUS_MODE 0x06 | (0x00 << 8) | (0x02 << 12)
 
+#define FIFO_ODR_DISABLED 0x00 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_12_DOT_5_HZ 0x01 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_26_HZ 0x02 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_52_HZ 0x03 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_104_HZ 0x04 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_208_HZ 0x05 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_416_HZ 0x06 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_833_HZ 0x07 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_1_DOT_66_K_HZ 0x08 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_3_DOT_33_K_HZ 0x09 | (0x03 << 8) | (0x06 << 12)
+#define FIFO_ODR_6_DOT_66_K_HZ 0x0A | (0x03 << 8) | (0x06 << 12)
+
+#define DEC_FIFO_GYRO_NOT_IN_FIFO 0x00 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_NO_DECIMATION 0x01 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_2 0x02 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_3 0x03 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_4 0x04 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_8 0x05 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_16 0x06 | (0x03 << 8) | (0x05 << 12)
+#define DEC_FIFO_GYRO_32 0x07 | (0x03 << 8) | (0x05 << 12)
+
+#define DEC_FIFO_XL_NOT_IN_FIFO 0x00 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_NO_DECIMATION 0x01 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_2 0x02 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_3 0x03 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_4 0x04 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_8 0x05 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_16 0x06 | (0x00 << 8) | (0x02 << 12)
+#define DEC_FIFO_XL_32 0x07 | (0x00 << 8) | (0x02 << 12)
+
+#define TIMER_PEDO_FIFO_EN_ENABLED 0x01 | (0x07 << 8) | (0x07 << 12)
+#define TIMER_PEDO_FIFO_EN_DISABLED 0x00 | (0x07 << 8) | (0x07 << 12)
+
+#define DEC_DS4_FIFO_NOT_IN_FIFO 0x00 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_NO_DECIMATION 0x01 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_2 0x02 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_3 0x03 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_4 0x04 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_8 0x05 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_16 0x06 | (0x03 << 8) | (0x05 << 12)
+#define DEC_DS4_FIFO_32 0x07 | (0x03 << 8) | (0x05 << 12)
+
+#define TIMER_EN_ENABLED 0x01 | (0x05 << 8) | (0x05 << 12)
+#define TIMER_EN_DISABLED 0x00 | (0x05 << 8) | (0x05 << 12)
+
+#define TIMER_HR_25_US 0x01 | (0x04 << 8) | (0x04 << 12)
+#define TIMER_HR_6_DOT_4_MS 0x00 | (0x04 << 8) | (0x04 << 12)
+
 #define ACCEL_FS_2_G 0x00 | (0x02 << 8) | (0x03 << 12)
 #define ACCEL_FS_4_G 0x02 | (0x02 << 8) | (0x03 << 12)
 #define ACCEL_FS_8_G 0x03 | (0x02 << 8) | (0x03 << 12)
@@ -177,6 +299,7 @@
 #define ACCEL_POWER_DOWN 0x00 | (0x04 << 8) | (0x07 << 12)
 #define ACCEL_1_DOT_6_HZ 0x0B | (0x04 << 8) | (0x07 << 12)
 #define ACCEL_12_DOT_5_HZ 0x01 | (0x04 << 8) | (0x07 << 12)
+#define ACCEL_26_HZ 0x02 | (0x04 << 8) | (0x07 << 12)
 #define ACCEL_52_HZ 0x03 | (0x04 << 8) | (0x07 << 12)
 #define ACCEL_104_HZ 0x04 | (0x04 << 8) | (0x07 << 12)
 #define ACCEL_208_HZ 0x05 | (0x04 << 8) | (0x07 << 12)
@@ -210,8 +333,38 @@
 #define GYRO_FTYPE_2 0x02 | (0x00 << 8) | (0x01 << 12)
 #define GYRO_FTYPE_3 0x03 | (0x00 << 8) | (0x01 << 12)
 
+#define USR_OFF_W_2_POW_10_G 0x00 | (0x03 << 8) | (0x03 << 12)
+#define USR_OFF_W_2_POW_6_G 0x01 | (0x03 << 8) | (0x03 << 12)
+
 #define LPF1_SEL_G_ENABLED 0x01 | (0x01 << 8) | (0x01 << 12)
 #define LPF1_SEL_G_DISABLED 0x00 | (0x01 << 8) | (0x01 << 12)
 
+#define I2C_DISABLE_ENABLED 0x01 | (0x02 << 8) | (0x02 << 12)
+#define I2C_DISABLE_DISABLED 0x00 | (0x02 << 8) | (0x02 << 12)
+
+#define FUNC_CFG_EN_ENABLED 0x01 | (0x07 << 8) | (0x07 << 12)
+#define FUNC_CFG_EN_DISABLED 0x00 | (0x07 << 8) | (0x07 << 12)
+
+#define FUNC_EN_ENABLED 0x01 | (0x02 << 8) | (0x02 << 12)
+#define FUNC_EN_DISABLED 0x00 | (0x02 << 8) | (0x02 << 12)
+
+#define MASTER_ON_ENABLED 0x01 | (0x00 << 8) | (0x00 << 12)
+#define MASTER_ON_DISABLED 0x00 | (0x00 << 8) | (0x00 << 12)
+
+#define PULL_UP_EN_ENABLED 0x01 | (0x03 << 8) | (0x03 << 12)
+#define PULL_UP_EN_DISABLED 0x00 | (0x03 << 8) | (0x03 << 12)
+
+#define DEC_DS3_FIFO_NOT_IN_FIFO 0x00 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_NO_DECIMATION 0x01 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_2 0x02 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_3 0x03 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_4 0x04 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_8 0x05 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_16 0x06 | (0x00 << 8) | (0x02 << 12)
+#define DEC_DS3_FIFO_32 0x07 | (0x00 << 8) | (0x02 << 12)
+
+// Bytes read from slave 0 (OR in the count):
+#define SLAVE0_NUMOP_FIELD (0x00 << 8) | (0x02 << 12)
+
 #define G_HM_MODE_ENABLED 0x00 | (0x07 << 8) | (0x07 << 12)
 #define G_HM_MODE_DISABLED 0x01 | (0x07 << 8) | (0x07 << 12)
\ No newline at end of file
@@ -0,0 +1,122 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_REPLAY_H
+#define ISM330DLC_REPLAY_H
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_convert.h"   // ISM330DLC unit conversion
+#include "ism330dlc_log.h"       // ISM330DLC binary log
+
+// Recorded sessions played back as frames, in place of the sensors, so the
+// same conversion, filtering, fusion and output stages can be run over field
+// data as fast as they go or at a multiple of the recorded rate. Two kinds
+// of recording are read:
+//
+// - test_ism330dlc.bin logs (see ism330dlc_log.h), the raw register values
+//   of every sample, which come back bit for bit
+// - test_ism330dlc.csv files, whose converted values are turned back into
+//   register values (to the nearest LSB) with the scales they were written
+//   with
+
+#define REPLAY_CSV 0
+#define REPLAY_LOG 1
+
+// Values a CSV line can carry (struct replay columns):
+#define REPLAY_TIME 0
+#define REPLAY_SENSOR 1
+#define REPLAY_ACCEL_X 2
+#define REPLAY_GYRO_X 5
+#define REPLAY_GYRO_Z 7
+#define REPLAY_MAG_X 8
+#define REPLAY_MAG_Z 10
+#define REPLAY_RATE 11
+#define REPLAY_NUM_VALUES 12
+
+// Most fields a CSV line is read with:
+#define REPLAY_MAX_COLUMNS 16
+
+struct replay {
+    int format;
+
+    // Scales by sensor ID. Frames of sensors from num_sensors up are
+    // skipped:
+    const struct convert_scale *scales;
+    int num_sensors;
+
+    // REPLAY_CSV:
+    FILE *csv;
+    float mag_scale;                    // Magnetometer columns per LSB
+    int columns[REPLAY_NUM_VALUES];     // Field of every value (-1 = none)
+
+    // Lines that were not samples and frames of sensors out of range:
+    unsigned long skipped;
+
+    // REPLAY_LOG:
+    struct log_view view;
+    uint64_t next;
+
+    // 0 = as fast as possible, otherwise times the recorded rate:
+    double speed;
+
+    // Frame read ahead that was not due yet:
+    struct ism330dlc_frame held;
+    int pending;
+
+    // Recording time of the first and latest frame and host time the first
+    // was replayed at (CLOCK_MONOTONIC):
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t start_ns;
+
+    unsigned long frames;
+};
+
+// Open a recording, a log if it starts like one and a CSV file otherwise.
+// scales (num_sensors of them, by sensor ID) and mag_scale are what the CSV
+// values were written with. The column layout comes from the CSV header
+// (the timestamp and six axes of sensor 0 without one):
+int replay_open(struct replay *replay, const char *path, double speed,
+                const struct convert_scale *scales, int num_sensors,
+                float mag_scale);
+
+// Next frames of the recording (up to max_frames), held back until they are
+// due when replaying at a given speed. Returns 0 at the end:
+size_t replay_read(struct replay *replay, struct ism330dlc_frame *frames,
+                   size_t max_frames);
+
+// Whether the recording has more than sensor 0 in it (a log with other
+// sensor IDs or a CSV file with a Sensor column):
+int replay_multi_sensor(struct replay *replay);
+
+// Whether the recording marks output data rate changes (a log with FRAME_RATE
+// frames or a CSV file with a Rate Change column):
+int replay_rate_changes(struct replay *replay);
+
+void replay_close(struct replay *replay);
+
+#endif
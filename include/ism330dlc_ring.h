@@ -0,0 +1,74 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_RING_H
+#define ISM330DLC_RING_H
+
+// Include C standard libraries:
+#include <stddef.h>    // C Standard definitions
+#include <stdatomic.h> // C Standard atomics
+
+#include "ism330dlc.h"           // ISM330DLC driver
+
+// Lock-free single-producer/single-consumer ring of frames between the
+// acquisition thread and a consumer thread. The producer never waits: when
+// the ring is full the new frame is dropped and counted as an overrun so a
+// slow consumer can not stall the bus reads. Head and tail live on their own
+// cache lines so the two threads do not bounce one line between cores.
+
+#define RING_CACHE_LINE 64
+
+struct frame_ring {
+    // Written by the producer only:
+    _Alignas(RING_CACHE_LINE) atomic_size_t head;
+    atomic_ulong overruns;
+
+    // Written by the consumer only:
+    _Alignas(RING_CACHE_LINE) atomic_size_t tail;
+
+    // Fixed after ring_init():
+    _Alignas(RING_CACHE_LINE) size_t mask;
+    struct ism330dlc_frame *slots;
+};
+
+// Capacity is rounded up to a power of two:
+int ring_init(struct frame_ring *ring, size_t capacity);
+
+void ring_free(struct frame_ring *ring);
+
+// Producer side. Returns 0 or -1 when the ring was full and the frame was
+// dropped:
+int ring_push(struct frame_ring *ring, const struct ism330dlc_frame *frame);
+
+// Consumer side. Returns the number of frames copied out (up to max_frames):
+size_t ring_pop(struct frame_ring *ring, struct ism330dlc_frame *frames,
+                size_t max_frames);
+
+// Frames waiting in the ring:
+size_t ring_count(struct frame_ring *ring);
+
+static inline unsigned long ring_overruns(struct frame_ring *ring) {
+    return atomic_load_explicit(&ring->overruns, memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,81 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_RT_H
+#define ISM330DLC_RT_H
+
+// Include C standard libraries:
+#include <stdio.h>     // C Standard I/O libary
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+
+// Real-time acquisition. The bus threads run SCHED_FIFO, optionally pinned
+// to one CPU, with every page of the process locked in memory and faulted in
+// before the first sample. Polled reads are paced against absolute deadlines
+// on CLOCK_MONOTONIC (clock_nanosleep() with TIMER_ABSTIME) so the time spent
+// on the bus does not push the next sample back, and how late every read
+// started against its deadline goes into a jitter histogram (the same kind
+// the bus metrics keep).
+
+// Stack faulted in by every real-time thread before it starts:
+#define RT_STACK_PREFAULT_BYTES (256 * 1024)
+
+#define RT_DEFAULT_PRIORITY 80
+
+struct rt_config {
+    int enabled;
+    int priority;       // SCHED_FIFO priority of the bus threads (1 to 99)
+    int cpu;            // CPU to pin the bus threads to (-1 = any)
+};
+
+struct rt_jitter {
+    struct metrics_hist hist;
+    atomic_ulong skipped;  // Deadlines passed by before they could be met
+};
+
+// Lock every page the process has and will have in memory and keep malloc()
+// from giving memory back or mapping new chunks. Call once everything the
+// run needs is allocated:
+int rt_lock_memory(void);
+
+// Make the calling thread real-time per config and fault its stack in:
+int rt_enter(const struct rt_config *config);
+
+// Sleep until deadline_ns (CLOCK_MONOTONIC):
+void rt_sleep_until(uint64_t deadline_ns);
+
+// Record a sample taken late_ns after its deadline:
+void rt_jitter_record(struct rt_jitter *jitter, uint64_t late_ns);
+
+static inline void rt_jitter_skip(struct rt_jitter *jitter,
+                                  unsigned long deadlines) {
+    atomic_fetch_add_explicit(&jitter->skipped, deadlines,
+                              memory_order_relaxed);
+}
+
+// Print the histogram with a prefix on every line:
+void rt_jitter_dump(struct rt_jitter *jitter, const char *prefix, FILE *out);
+
+#endif
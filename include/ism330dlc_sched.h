@@ -0,0 +1,112 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_SCHED_H
+#define ISM330DLC_SCHED_H
+
+// Include C standard libraries:
+#include <stddef.h>    // C Standard definitions
+#include <stdatomic.h> // C Standard atomics
+#include <pthread.h>   // POSIX threads
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_rt.h"        // ISM330DLC real-time acquisition
+#include "ism330dlc_sensor.h"    // ISM330DLC sensor handle
+
+// Runs any number of sensors together. Sensors are grouped by the bus they
+// sit on and every bus gets its own acquisition thread, so separate buses
+// are read in parallel while sensors sharing a bus take turns on it, each
+// serviced when its FIFO watermark (or data-ready) edge comes in or it falls
+// due. Every sensor pushes into its own ring and sched_pop() merges them back
+// into one stream in timestamp order (all on CLOCK_MONOTONIC), each frame
+// tagged with the ID of the sensor it came from.
+
+#define SCHED_MAX_SENSORS 16
+
+// Frames taken out of a sensor ring at a time while merging:
+#define SCHED_MERGE_BATCH 256
+
+struct ism330dlc_sched;
+
+struct sched_bus {
+    struct ism330dlc_sched *sched;
+    struct ism330dlc_bus *bus;
+
+    struct ism330dlc_sensor *sensors[SCHED_MAX_SENSORS];
+    int num_sensors;
+
+    pthread_t thread;
+    int status;
+};
+
+// Frames taken out of a sensor ring that are waiting to be merged:
+struct sched_source {
+    struct ism330dlc_frame frames[SCHED_MERGE_BATCH];
+    size_t count;
+    size_t next;
+};
+
+struct ism330dlc_sched {
+    struct ism330dlc_sensor *sensors[SCHED_MAX_SENSORS];
+    struct sched_source sources[SCHED_MAX_SENSORS];
+    int num_sensors;
+
+    struct sched_bus buses[SCHED_MAX_SENSORS];
+    int num_buses;
+
+    // Samples to take from every sensor (0 = until sched_stop()):
+    long number_of_samples;
+
+    // Run the bus threads real-time and sleep until deadlines with
+    // clock_nanosleep() instead of bus_delay_us() (set before
+    // sched_start(), NULL = off):
+    const struct rt_config *rt;
+
+    atomic_int stop;
+};
+
+void sched_init(struct ism330dlc_sched *sched, long number_of_samples);
+
+// Add a started sensor. Sensors with the same bus share a thread:
+int sched_add(struct ism330dlc_sched *sched, struct ism330dlc_sensor *sensor);
+
+// Start one acquisition thread per bus:
+int sched_start(struct ism330dlc_sched *sched);
+
+// Ask the bus threads to wind down:
+void sched_stop(struct ism330dlc_sched *sched);
+
+// Merge what the sensors have produced into frames in timestamp order. A
+// frame is only handed out once every sensor still running has produced
+// something at least as new, except for sensors idle waiting on a motion
+// trigger. Returns the number of frames:
+size_t sched_pop(struct ism330dlc_sched *sched, struct ism330dlc_frame *frames,
+                 size_t max_frames);
+
+// Every sensor is done and everything it produced has been popped:
+int sched_finished(struct ism330dlc_sched *sched);
+
+// Wait for the bus threads. Returns 0 or the first error one of them hit:
+int sched_join(struct ism330dlc_sched *sched);
+
+#endif
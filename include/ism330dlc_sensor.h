@@ -0,0 +1,236 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_SENSOR_H
+#define ISM330DLC_SENSOR_H
+
+// Include C standard libraries:
+#include <stdio.h>     // C Standard I/O libary
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+#include "ism330dlc_calib.h"     // ISM330DLC bias calibration
+#include "ism330dlc_clock.h"     // ISM330DLC timestamp clock model
+#include "ism330dlc_adapt.h"     // ISM330DLC adaptive output data rate
+#include "ism330dlc_fifo.h"      // ISM330DLC FIFO streaming
+#include "ism330dlc_hub.h"       // ISM330DLC sensor hub
+#include "ism330dlc_irq.h"       // ISM330DLC interrupt acquisition
+#include "ism330dlc_motion.h"    // ISM330DLC motion triggered acquisition
+#include "ism330dlc_recovery.h"  // ISM330DLC bus recovery
+#include "ism330dlc_ring.h"      // ISM330DLC frame ring
+#include "ism330dlc_rt.h"        // ISM330DLC real-time acquisition
+#include "ism330dlc_shadow.h"    // ISM330DLC shadow registers
+
+// Handle for one ISM330DLC: the bus and address it sits on, how it is set up
+// and everything needed to take samples from it. Frames it produces carry its
+// ID and go into its own ring so any number of sensors can be run together
+// (see ism330dlc_sched.h).
+
+// Frames drained from the FIFO per service:
+#define SENSOR_BATCH_FRAMES (FIFO_WORDS / 6)
+
+// Give up on INT1 if no data-ready edge shows up for this long:
+#define SENSOR_INT1_TIMEOUT_MS 1000
+
+// Give the device this long to boot and answer at its address:
+#define SENSOR_BOOT_TIMEOUT_US 50000
+
+// Period between output register reads when not interrupt driven:
+#define SENSOR_POLL_PERIOD_NS 50000000ULL
+
+// Service an idle sensor waiting on INT1 this often anyway so the clock
+// model never goes long enough without a sync to lose count of wraps:
+#define SENSOR_IDLE_SYNC_NS 60000000000ULL
+
+struct sensor_config {
+    int accel_odr;      // ACCEL_*_HZ
+    int accel_fs;       // ACCEL_FS_*
+    int gyro_odr;       // GYRO_*_HZ
+    int gyro_fs;        // GYRO_FS_*
+    int gyro_lpf1;      // GYRO_FTYPE_* to narrow the bandwidth (0 = off)
+
+    // Stream through the FIFO instead of polling the output registers. The
+    // timestamp data set (fifo.dec_timestamp) stamps frames from the device
+    // timestamp counter:
+    int fifo_streaming;
+    struct fifo_config fifo;
+
+    // Route data-ready (or the FIFO watermark when streaming) to INT1:
+    int interrupt;
+
+    // Read the output registers at absolute deadlines this far apart instead
+    // of SENSOR_POLL_PERIOD_NS after the last read (polling only, 0 = off):
+    uint64_t period_ns;
+
+    // Magnetometer read by the sensor hub (hub.mag_addr 0 = none). Frames
+    // carry it from the output register read, or from the FIFO when
+    // fifo.dec_hub puts it in as the 3rd data set:
+    struct hub_config hub;
+
+    // Sit idle (accelerometer alone at motion.idle_odr, wake-up and
+    // free-fall on INT1) until an event, then stream with the pre-trigger
+    // history kept in the idle FIFO and go back to idle once still for
+    // motion.inactive_s. Needs fifo_streaming:
+    int motion_trigger;
+    struct motion_config motion;
+
+    // Follow the activity in the signal with the ODR, starting from
+    // accel_odr/gyro_odr (one of the adapt rates). The FIFO ODR follows and
+    // the watermark with it so drains stay as far apart. The first frame at
+    // a new rate carries FRAME_RATE. Needs fifo_streaming and not
+    // motion_trigger:
+    int adaptive;
+    struct adapt_config adapt;
+
+    // Read configuration registers back after writing them:
+    int verify;
+
+    // Probe WHO_AM_I at the address while the device boots and wait for the
+    // samples to settle, instead of scanning the bus and sleeping a second:
+    int fast_start;
+
+    // Read deadline and backoff (all zero = RETRY_POLICY_DEFAULT):
+    struct retry_policy retry;
+};
+
+struct ism330dlc_sensor {
+    int id;
+    struct ism330dlc_bus *bus;
+    int device_addr;
+
+    struct sensor_config config;
+    struct reg_shadow regs;
+    double fifo_odr;    // [Hz]
+    double watermark_s; // Time for the FIFO to fill to the watermark [s]
+
+    float accel_scale;  // [milli-g/LSB]
+    float gyro_scale;   // [milli-dps/LSB]
+
+    struct fifo_stream stream;
+    struct clock_model clock;
+
+    // Frames per second it should give and when it started and last gave
+    // any (CLOCK_MONOTONIC):
+    double rate_hz;
+    uint64_t started_ns;
+    uint64_t last_ns;
+
+    // INT1 edge source (0 = sleep between reads):
+    struct ism330dlc_irq *irq;
+    unsigned long missed_edges;
+
+    // Bounded reads. Set recovery.power (like irq, before sensor_start()) to
+    // have lockups power cycle the device, after which the sensor sets
+    // itself up again:
+    struct bus_recovery recovery;
+    unsigned int power_generation;
+    unsigned long missing;    // Samples given up on at their deadline
+    unsigned long recoveries; // Configuration restored after a power cycle
+
+    // Online bias calibration (sensor_calibrate()):
+    int calibrating;
+    struct calib calib;
+
+    // Motion trigger (idle is read by the consumer to merge around it):
+    atomic_int idle;
+    uint64_t motion_ns;        // Last wake-up seen while streaming
+    uint64_t window_ns;        // Start of the pre-trigger history to keep
+    uint64_t idle_since_ns;
+    uint64_t idle_ns;          // Time spent idle before idle_since_ns
+    unsigned long wakeups;
+    unsigned long free_falls;
+
+    // Adaptive ODR (rate_changed marks the next frame out):
+    struct adapt adapt;
+    int rate_changed;
+
+    // Frames on their way to the consumer:
+    struct frame_ring ring;
+
+    // When the samples were good to use (CLOCK_MONOTONIC):
+    uint64_t settled_ns;
+
+    // Scheduling:
+    uint64_t due_ns;    // Service by this time without an edge
+    uint64_t deadline_ns; // Next read with period_ns
+    struct rt_jitter jitter;
+    long taken;
+    atomic_int done;
+
+    // Scratch for a FIFO drain:
+    struct ism330dlc_frame frames[SENSOR_BATCH_FRAMES];
+    uint64_t ticks[SENSOR_BATCH_FRAMES];
+};
+
+// Check the device is there, reset it and write the configuration through
+// the register shadow. Runtime changes go through shadow_write() on
+// sensor->regs. The sensors still have to settle before sensor_start():
+int sensor_open(struct ism330dlc_sensor *sensor, int id,
+                struct ism330dlc_bus *bus, int device_addr,
+                const struct sensor_config *config);
+
+// Throw away the samples taken while the sensor settles (fast_start, nothing
+// otherwise) so the first frame out is a valid one:
+int sensor_settle(struct ism330dlc_sensor *sensor);
+
+// Calibrate online from here on, starting from profile (or NULL). Writes the
+// profile's accelerometer offsets straight away. The gyroscope bias is left
+// to the consumer (calib_gyro_bias() and convert_scale_bias()):
+int sensor_calibrate(struct ism330dlc_sensor *sensor,
+                     const struct calib_profile *profile);
+
+// Anchor the clock model, start the FIFO and allocate the frame ring:
+int sensor_start(struct ism330dlc_sensor *sensor, size_t ring_frames);
+
+// Take what is ready (one FIFO drain or one output register read, at most
+// max_frames), push it into the ring and set when the sensor is next due.
+// edge_ns is the INT1 edge time or 0. Bus errors do not stop the sensor:
+// reads that miss their deadline count as missing samples and a power cycled
+// device is set up again first. Returns the number of frames:
+int sensor_service(struct ism330dlc_sensor *sensor, uint64_t edge_ns,
+                   long max_frames);
+
+// Due without waiting for an edge: the FIFO is still at the watermark so
+// INT1 will not rise again, or the device was power cycled and INT1 is off
+// until it is set up again:
+static inline int sensor_pending(struct ism330dlc_sensor *sensor) {
+    return (sensor->config.fifo_streaming && sensor->stream.backlog) ||
+           (power_generation(sensor->recovery.power) !=
+            sensor->power_generation);
+}
+
+// Idle waiting for a motion trigger with nothing to give:
+static inline int sensor_idle(struct ism330dlc_sensor *sensor) {
+    return atomic_load(&sensor->idle);
+}
+
+// Print samples taken, achieved against configured rate, dropped frames and
+// FIFO, INT1 and clock statistics. Counters are read without stopping the
+// bus thread so they can be a transaction apart while running:
+void sensor_report(struct ism330dlc_sensor *sensor, FILE *out);
+
+void sensor_close(struct ism330dlc_sensor *sensor);
+
+#endif
@@ -0,0 +1,92 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_SHADOW_H
+#define ISM330DLC_SHADOW_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Host side copy of the configuration registers (FIFO_CTRL1 to INT2_CTRL,
+// CTRL1_XL to MASTER_CONFIG, TAP_CFG to MD2_CFG and the user offsets) so
+// options can be applied without reading the device first. Changes are
+// staged in the shadow and commit writes only the registers that changed,
+// as few auto-increment bursts as possible. Bursts run through unchanged
+// registers when that is cheaper than starting another transaction but
+// never through reserved or read-only ones.
+//
+// The shadow starts out at the register defaults so it is only right about
+// a device that was just powered up or reset (shadow_reset()).
+
+// Unchanged registers a burst is allowed to rewrite to reach the next changed
+// one (a byte costs less than a new transaction):
+#define SHADOW_MERGE_GAP 2
+
+struct reg_shadow {
+    struct ism330dlc_bus *bus;
+    int device_addr;
+
+    uint8_t shadowed[128]; // 1 = register is kept in the shadow
+    uint8_t value[128];    // What the device holds
+    uint8_t staged[128];   // What it will hold after the next commit
+
+    int verify;            // Read every burst back after writing it
+
+    // Statistics:
+    unsigned long bursts;
+    unsigned long bytes;
+};
+
+// Seed the shadow with the register defaults:
+void shadow_init(struct reg_shadow *shadow, struct ism330dlc_bus *bus,
+                 int device_addr);
+
+// Software reset the device (CTRL3_C SW_RESET) and re-seed the shadow so
+// both are back at the defaults:
+int shadow_reset(struct reg_shadow *shadow);
+
+// Reset the device like shadow_reset() but keep what was staged, so the next
+// commit writes the whole configuration back (after a power cycle):
+int shadow_restore(struct reg_shadow *shadow);
+
+// Apply options (same encoding as configure_device()) to a staged register:
+void shadow_stage(struct reg_shadow *shadow, int reg_addr, const int *configs,
+                  int num_configs);
+
+// Stage a whole register value:
+void shadow_set(struct reg_shadow *shadow, int reg_addr, int value);
+
+// Staged value of a register:
+int shadow_get(struct reg_shadow *shadow, int reg_addr);
+
+// Write everything staged since the last commit. Returns 0, a pi_i2c error or
+// -1 when verifying and a register did not read back as written:
+int shadow_commit(struct reg_shadow *shadow);
+
+// Stage options and commit straight away (one write, no reads):
+int shadow_write(struct reg_shadow *shadow, int reg_addr, const int *configs,
+                 int num_configs);
+
+#endif
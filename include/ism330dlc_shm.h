@@ -0,0 +1,146 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_SHM_H
+#define ISM330DLC_SHM_H
+
+// Include C standard libraries:
+#include <stddef.h>    // C Standard definitions
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+#include "ism330dlc.h"           // ISM330DLC driver
+
+// Live frames for other processes on the same host. The acquisition process
+// publishes every frame it writes out into a POSIX shared memory ring
+// (/dev/shm/<name>). Any number of readers map it read-only and follow it at
+// their own pace, straight out of the mapping, with no system calls per
+// frame. The publisher never waits for readers and does not know about them:
+// a reader that falls more than a ring behind loses the oldest frames. Every
+// slot carries the sequence number of the frame in it, so a reader can always
+// tell when that happened and how much it lost, even if it was overwritten
+// while the reader was looking at it.
+
+#define SHM_MAGIC "ISM330SH"
+#define SHM_VERSION 1
+
+// Default ring name and size (about 40 seconds at 1.66 kHz):
+#define SHM_DEFAULT_NAME "/ism330dlc"
+#define SHM_DEFAULT_FRAMES 65536
+
+#define SHM_CACHE_LINE 64
+
+struct shm_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t slot_size;
+    uint32_t capacity;       // Slots, a power of two
+    float accel_odr;         // [Hz]
+    float gyro_odr;          // [Hz]
+    float accel_scale;       // [milli-g/LSB]
+    float gyro_scale;        // [milli-dps/LSB]
+    float mag_scale;         // [milli-gauss/LSB], 0 without a magnetometer
+    uint32_t closed;         // Set once the publisher is done
+
+    // Frames published so far. Slots up to this are complete:
+    _Alignas(SHM_CACHE_LINE) atomic_uint_fast64_t head;
+};
+
+struct shm_slot {
+    // Sequence number of the frame in the slot plus one, 0 while it is being
+    // written:
+    atomic_uint_fast64_t seq;
+    struct ism330dlc_frame frame;
+};
+
+struct shm_publisher {
+    char name[64];
+    int fd;
+    struct shm_header *header;
+    struct shm_slot *slots;
+    size_t mapped;
+    uint64_t mask;
+    uint64_t head;
+};
+
+struct shm_reader {
+    int fd;
+    const struct shm_header *header;
+    const struct shm_slot *slots;
+    size_t mapped;
+    uint64_t mask;
+
+    // Sequence number of the next frame to read:
+    uint64_t next;
+
+    // Frames read and frames lost to the publisher lapping this reader:
+    uint64_t frames;
+    uint64_t overruns;
+};
+
+// Create (or take over) the ring called name with room for capacity frames,
+// rounded up to a power of two. info supplies the rates and scales. Every
+// page is touched before returning so publishing does not page fault:
+int shm_publish_open(struct shm_publisher *pub, const char *name,
+                     size_t capacity, const struct shm_header *info);
+
+void shm_publish(struct shm_publisher *pub,
+                 const struct ism330dlc_frame *frames, size_t num_frames);
+
+// Mark the ring closed and remove its name. Readers that have it mapped keep
+// it until they let go:
+void shm_publish_close(struct shm_publisher *pub);
+
+// Map the ring read-only, starting at the newest frame:
+int shm_reader_open(struct shm_reader *reader, const char *name);
+
+void shm_reader_close(struct shm_reader *reader);
+
+// Frames published that the reader has not got to (may be more than the ring
+// holds, the rest are lost):
+static inline uint64_t shm_reader_lag(const struct shm_reader *reader) {
+    return atomic_load_explicit(&reader->header->head,
+                                memory_order_acquire) - reader->next;
+}
+
+static inline int shm_reader_closed(const struct shm_reader *reader) {
+    return __atomic_load_n(&reader->header->closed, __ATOMIC_ACQUIRE);
+}
+
+// Point frame at the next frame in the mapping without copying it. Returns 1,
+// or 0 when the reader is caught up. Frames the reader fell too far behind to
+// see are skipped and counted in overruns first:
+int shm_reader_peek(struct shm_reader *reader,
+                    const struct ism330dlc_frame **frame);
+
+// Done with the frame from shm_reader_peek(). Returns 0, or -1 when the
+// publisher overwrote it in the meantime and what was read from it is not to
+// be trusted (it counts as an overrun):
+int shm_reader_release(struct shm_reader *reader);
+
+// Copy out up to max_frames frames. Returns how many:
+size_t shm_reader_read(struct shm_reader *reader,
+                       struct ism330dlc_frame *frames, size_t max_frames);
+
+#endif
@@ -0,0 +1,166 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_SIM_H
+#define ISM330DLC_SIM_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+// Include Linux headers:
+#include <linux/i2c.h>  // Linux I2C messages
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+#include "ism330dlc_irq.h"       // ISM330DLC interrupt acquisition
+#include "ism330dlc_recovery.h"  // ISM330DLC bus recovery
+
+// Simulated ISM330DLC register file. Models WHO_AM_I, the CTRL1_XL/CTRL2_G
+// output data rate and full-scale selections, the accelerometer user offsets,
+// the output registers, the FIFO, wake-up detection and the sensor hub with
+// a LIS2MDL on its auxiliary bus, and produces synthetic motion (with a
+// fixed zero-g offset and zero-rate level) at the configured ODR so the
+// driver can be exercised and benchmarked without a Pi or a sensor.
+
+// 4 kbyte FIFO (page 31):
+#define SIM_FIFO_WORDS 2048
+
+// Longest message or transfer sim_i2c_transfer() and sim_spi_transfer()
+// take (a full FIFO and the register address):
+#define SIM_XFER_MAX_BYTES (2 * SIM_FIFO_WORDS + 1)
+
+struct ism330dlc_sim_config {
+    int device_addr;           // Slave address the simulated device answers
+    int realtime;              // 1 = CLOCK_MONOTONIC, 0 = virtual clock
+    unsigned int latency_us;   // Fixed cost of every bus transaction
+    unsigned int byte_ns;      // Cost of every byte transferred
+    int error_code;            // Error returned every error_period transfers
+    unsigned int error_period; // 0 = never inject periodic errors
+    unsigned int seed;         // Seed for the synthetic sensor noise
+    int timer_ppm;             // Timestamp counter error against the host
+    unsigned int boot_us;      // NACK everything this long after power-on
+    unsigned int still_ms;     // Lie still this long before moving
+    unsigned int move_ms;      // Then move this long, still again, ...
+    int mag_addr;              // LIS2MDL on the sensor hub bus (0 = none)
+};
+
+struct ism330dlc_sim {
+    struct ism330dlc_sim_config config;
+
+    uint8_t regs[128];
+    uint8_t embedded[128];     // Embedded functions bank A
+    uint8_t mag_regs[128];     // LIS2MDL behind the sensor hub
+
+    // Time base:
+    uint64_t virtual_ns;
+    uint64_t epoch_ns;
+
+    // Output register sample generation:
+    uint64_t xl_start_ns;
+    uint64_t g_start_ns;
+    uint64_t xl_sample;
+    uint64_t g_sample;
+    uint32_t noise;
+
+    // Timestamp counter:
+    uint64_t timer_start_ns;
+    uint64_t read_ns;
+
+    // FIFO:
+    uint16_t fifo[SIM_FIFO_WORDS];
+    int fifo_head;
+    int fifo_count;
+    int fifo_out;              // Word latched by a FIFO_DATA_OUT_L read
+    int fifo_overrun;
+    uint64_t fifo_start_ns;
+    uint64_t fifo_tick;
+    uint64_t fifo_removed;     // Words popped or overwritten (for pattern)
+
+    // INT1 edge generation:
+    uint64_t irq_xl_sample;
+    uint64_t irq_g_sample;
+    int irq_fth_level;
+    int irq_wu_level;
+
+    // Error injection:
+    int pending_error;
+    int pending_count;
+    int locked_up;
+
+    // End of the boot window after power-on:
+    uint64_t booted_ns;
+
+    // Next device on the same bus (sim_share_bus()):
+    struct ism330dlc_sim *next;
+
+    // Bus statistics:
+    unsigned long transactions;
+    unsigned long bytes_read;
+    unsigned long bytes_written;
+    unsigned long errors;
+};
+
+void sim_init(struct ism330dlc_sim *sim,
+              const struct ism330dlc_sim_config *config);
+
+// Fill out a bus whose transactions land on the simulated device:
+void sim_bus(struct ism330dlc_sim *sim, struct ism330dlc_bus *bus);
+
+// Stand-in for a kernel I2C adapter (i2cdev_standin()): I2C_RDWR messages
+// land on the simulated device as combined register reads and writes.
+// Returns 0 or a negative errno like the ioctl would (EREMOTEIO on a NACK,
+// ETIMEDOUT on a locked up bus):
+int sim_i2c_transfer(void *ctx, struct i2c_msg *msgs, int num_msgs);
+
+// Stand-in for a spidev chip select (spidev_standin()): a transfer is the
+// register address (bit 7 set to read) and the data. Nothing NACKs on SPI,
+// so a device still booting reads back zeros and takes no writes. Other
+// bus errors come back as -EIO:
+int sim_spi_transfer(void *ctx, const uint8_t *tx, uint8_t *rx, int len);
+
+// Put other on the same bus as sim. Transactions on sim's bus addressed to
+// other land on it, one at a time like on a real shared bus:
+void sim_share_bus(struct ism330dlc_sim *sim, struct ism330dlc_sim *other);
+
+// Edge source that rises whenever INT1 would on the simulated device
+// (data-ready pulses and the FIFO watermark per INT1_CTRL, wake-up per
+// MD1_CFG):
+void sim_irq(struct ism330dlc_sim *sim, struct ism330dlc_irq *irq);
+
+// Fail the next count transactions with error (-ENACK, -EBUSLOCKUP, ...).
+// -EBUSLOCKUP is sticky until sim_power_cycle():
+void sim_inject_error(struct ism330dlc_sim *sim, int error, int count);
+
+// Registers back to their defaults, the bus released and the device booting
+// again for boot_us:
+void sim_power_cycle(struct ism330dlc_sim *sim);
+
+// Power switch that calls sim_power_cycle():
+void sim_power(struct ism330dlc_sim *sim, struct ism330dlc_power *power);
+
+// Current simulated time in nanoseconds:
+uint64_t sim_time_ns(struct ism330dlc_sim *sim);
+
+// Output data rate in Hz for an ODR_XL/ODR_G/ODR_FIFO register code:
+double sim_odr_hz(int odr_code);
+
+#endif
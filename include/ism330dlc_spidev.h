@@ -0,0 +1,86 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+#ifndef ISM330DLC_SPIDEV_H
+#define ISM330DLC_SPIDEV_H
+
+// Include C standard libraries:
+#include <stdint.h> // C Standard integer types
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// Register bus on a 4-wire SPI chip select through /dev/spidev<bus>.<cs>
+// (mode 3, up to 10 MHz). Every transaction is one full duplex
+// transfer with the chip select held low for it: the register address with
+// bit 7 set for a read, then the data. Bursts rely on IF_INC like over I2C,
+// and a FIFO drain longer than the spidev buffer (bufsiz, 4 kbyte by
+// default) goes out as several transfers that each start at
+// FIFO_DATA_OUT_L again.
+//
+// There is no addressing on SPI: every chip select is a bus of its own and
+// the device_addr of a read or write is ignored. A failed transfer comes
+// back as -EBUSUNKERR (-EBADXFR when it is too long).
+
+// Register address byte:
+#define SPI_READ 0x80
+
+// Fastest the ISM330DLC takes:
+#define SPIDEV_MAX_SPEED_HZ 10000000
+
+// Longest transfer without a bufsiz to go by:
+#define SPIDEV_MAX_BYTES 4096
+
+struct spidev {
+    int spi_bus;
+    int chip_select;
+    int fd;                    // -1 with a stand-in
+    uint32_t speed_hz;
+    int max_bytes;             // Longest transfer incl. the address byte
+
+    // Stand-in for the kernel: one transfer of len bytes out of tx and in
+    // to rx (NULL when nothing is read) with the chip select held low.
+    // Returns 0 or a negative errno (NULL = the device through fd):
+    int (*transfer)(void *ctx, const uint8_t *tx, uint8_t *rx, int len);
+    void *ctx;
+
+    // Statistics:
+    unsigned long transfers;
+};
+
+// Open /dev/spidev<spi_bus>.<chip_select> in mode 3 at speed_hz and fill
+// out bus to go through it:
+int spidev_open(struct spidev *dev, struct ism330dlc_bus *bus, int spi_bus,
+                int chip_select, uint32_t speed_hz);
+
+// Same as a chip select at speed_hz but every transfer goes to
+// transfer(ctx, ...) instead of the kernel (sim_spi_transfer() puts the
+// simulated device there):
+void spidev_standin(struct spidev *dev, struct ism330dlc_bus *bus,
+                    uint32_t speed_hz,
+                    int (*transfer)(void *ctx, const uint8_t *tx,
+                                    uint8_t *rx, int len),
+                    void *ctx);
+
+void spidev_close(struct spidev *dev);
+
+#endif
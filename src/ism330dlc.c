@@ -0,0 +1,517 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library!
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_recovery.h"  // ISM330DLC bus recovery
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Testing ISM330DLC "iNEMO inertial module: 3D accelerometer and 3D gyroscope
+// with digital output for industrial applications" per the datasheet:
+// (Can find under doc/ism330dlc.pdf)
+
+int i2c_error_handler(int errno) {
+    // An I2C error may be fatal or maybe something that we can recover from
+    // or even ignore all together:
+    switch (errno) {
+        case -ENACK:
+            PRINT_WARN("I2C Error! Encountered ENACK\n");
+            break;
+        case -EBADXFR:
+            PRINT_WARN("I2C Error! Encountered EBADXFR\n");
+            break;
+        case -EBADREGADDR:
+            PRINT_WARN("I2C Error! Encountered EBADREGADDR\n");
+            break;
+        case -ECLKTIMEOUT:
+            PRINT_WARN("I2C Error! Encountered ECLKTIMEOUT\n");
+            break;
+        case -ENACKRST:
+            PRINT_WARN("I2C Error! Encountered ENACKRST\n");
+            break;
+        case -EBUSLOCKUP:
+            PRINT_WARN("I2C Error! Encountered EBUSLOCKUP\n");
+            break;
+        case -EBUSUNKERR:
+            PRINT_WARN("I2C Error! Encountered EBUSUNKERR\n");
+            break;
+        case -EFAILSTCOND:
+            PRINT_WARN("I2C Error! Encountered EFAILSTCOND\n");
+            break;
+        case -EDEVICEHUNG:
+            PRINT_WARN("I2C Error! Encountered ESLAVEHUNG\n");
+            break;
+        default:
+            break;
+    }
+
+    return errno;
+}
+
+int scan_for_device(struct ism330dlc_bus *bus, int device_addr) {
+    // Address book passed to returned by the function:
+    int address_book[127];
+
+    int ret;
+
+    if ((ret = bus_scan(bus, address_book)) < 0) {
+        i2c_error_handler(ret);
+    }
+
+    // Check and see if LIS3MDL was detected on the bus (if not then we can't
+    // really continue with the test):
+    if (address_book[device_addr] != 1) {
+        PRINT_ERROR("Device was not detected at 0x%X\n", device_addr);
+        return -1;
+    }
+
+    PRINT_INFO("Device was detected at 0x%X\n", device_addr);
+
+    return 0;
+}
+
+
+int verify_device_id(struct ism330dlc_bus *bus, int device_addr) {
+    // The returned device ID will be stored into an array that we pass
+    // to the read function:
+    int device_id[1];
+
+    int ret;
+
+    PRINT_INFO("Verifying device 0x%X identity\n", device_addr);
+
+    if ((ret = bus_read(bus, device_addr, WHO_AM_I, device_id, 1)) < 0) {
+        i2c_error_handler(ret);
+    }
+
+    // Compare returned device ID and error out if it does not match expected
+    // (If it doesn't match I would suspect something has gone horribly wrong)
+    if (device_id[0] != WHO_AM_I_DEFAULT) {
+        PRINT_ERROR("Device identified as 0x%X but does not match expected 0x%X\n",
+                    device_id[0], WHO_AM_I_DEFAULT);
+        return -1;
+    }
+
+    PRINT_INFO("Device identified as 0x%X and matches expected 0x%X\n",
+                device_id[0], WHO_AM_I_DEFAULT);
+
+    return 0;
+}
+
+// Apply a register setting mask to a register value:
+int apply_config(int reg_value, int config) {
+    int mask;
+    int start_bit;
+    int stop_bit;
+
+    // AND the current value of the register with a mask to clear the bit of
+    // the option being sent then OR it with the option to arrive to the
+    // final value of the register:
+    stop_bit = config >> 12;
+    start_bit = 0x0F & (config >> 8);
+
+    mask = ~((2 * ((1 << (stop_bit - start_bit)) - 1) + 1) << start_bit);
+
+    return ((reg_value & mask) | ((config & 0xFF) << start_bit)) & 0xFF;
+}
+
+int probe_device(struct ism330dlc_bus *bus, int device_addr,
+                 unsigned int boot_timeout_us) {
+    int device_id[1];
+
+    unsigned int waited_us = 0;
+
+    int ret;
+
+    // The device does not answer until it has booted so keep asking at the
+    // address it should be at. Nothing NACKs on SPI, a device still booting
+    // reads back garbage instead:
+    while (((ret = bus_read(bus, device_addr, WHO_AM_I, device_id, 1)) < 0) ||
+           (bus->spi && (device_id[0] != WHO_AM_I_DEFAULT))) {
+        if (waited_us >= boot_timeout_us) {
+            break;
+        }
+
+        bus_delay_us(bus, PROBE_RETRY_US);
+        waited_us += PROBE_RETRY_US;
+    }
+
+    if (ret == 0) {
+        if (device_id[0] != WHO_AM_I_DEFAULT) {
+            PRINT_ERROR("Device at 0x%X identified as 0x%X but does not match "
+                        "expected 0x%X\n", device_addr, device_id[0],
+                        WHO_AM_I_DEFAULT);
+            return -1;
+        }
+
+        PRINT_INFO("Device at 0x%X identified as 0x%X after %u us\n",
+                   device_addr, device_id[0], waited_us);
+
+        return 0;
+    }
+
+    // Nothing answered so fall back to looking over the whole bus:
+    i2c_error_handler(ret);
+
+    PRINT_WARN("No answer from 0x%X, scanning the bus\n", device_addr);
+
+    if ((ret = scan_for_device(bus, device_addr)) < 0) {
+        return ret;
+    }
+
+    return verify_device_id(bus, device_addr);
+}
+
+// Samples to throw away after leaving power-down. The gyroscope needs about
+// 70 ms to settle whatever the ODR, the accelerometer only its first sample:
+static int settle_samples(int odr, double turn_on_s, int minimum) {
+    int samples = (int) (turn_on_s * odr_to_hz(odr) + 0.999);
+
+    return samples > minimum ? samples : minimum;
+}
+
+int settle_device(struct ism330dlc_bus *bus, int device_addr, int accel_odr,
+                  int gyro_odr) {
+    int reg_value[16];
+
+    int accel_wanted = 0;
+    int gyro_wanted = 0;
+    int accel_seen = 0;
+    int gyro_seen = 0;
+
+    float fastest;
+
+    unsigned int poll_us;
+    unsigned int waited_us = 0;
+    unsigned int timeout_us;
+
+    int ret;
+
+    if (odr_to_hz(accel_odr) > 0) {
+        accel_wanted = settle_samples(accel_odr, 0, 1);
+    }
+
+    if (odr_to_hz(gyro_odr) > 0) {
+        gyro_wanted = settle_samples(gyro_odr, GYRO_TURN_ON_S, 1);
+    }
+
+    fastest = odr_to_hz(accel_odr) > odr_to_hz(gyro_odr) ?
+              odr_to_hz(accel_odr) : odr_to_hz(gyro_odr);
+
+    if (fastest == 0) {
+        return 0;
+    }
+
+    // Poll about twice per sample and allow twice as long as it should take:
+    poll_us = 0.5e6 / fastest;
+    timeout_us = 2e6 * (accel_wanted > gyro_wanted ? accel_wanted :
+                        gyro_wanted) / fastest + 2 * GYRO_TURN_ON_S * 1e6;
+
+    PRINT_INFO("Discarding %d accelerometer and %d gyroscope samples\n",
+               accel_wanted, gyro_wanted);
+
+    // Status and output registers in one read, which also clears the
+    // new data flags:
+    while ((accel_seen < accel_wanted) || (gyro_seen < gyro_wanted)) {
+        if (waited_us >= timeout_us) {
+            PRINT_ERROR("Device 0x%X did not settle in %u us\n", device_addr,
+                        timeout_us);
+            return -1;
+        }
+
+        if ((ret = bus_read(bus, device_addr, STATUS_SPIAux, reg_value,
+                            16)) < 0) {
+            i2c_error_handler(ret);
+            return ret;
+        }
+
+        accel_seen += (reg_value[0] & STATUS_XLDA) != 0;
+        gyro_seen += (reg_value[0] & STATUS_GDA) != 0;
+
+        if ((accel_seen < accel_wanted) || (gyro_seen < gyro_wanted)) {
+            bus_delay_us(bus, poll_us);
+            waited_us += poll_us;
+        }
+    }
+
+    return 0;
+}
+
+// Set device configuration by writing to a register address
+int configure_device(struct ism330dlc_bus *bus, int device_addr, int reg_addr,
+                     int *configs, int num_configs) {
+    int reg_value[1] = {0};
+
+    int i;
+    int ret;
+
+    PRINT_INFO("Configuring device 0x%X\n", device_addr);
+
+    // Get current register value to apply the options to:
+    if ((ret = bus_read(bus, device_addr, reg_addr, reg_value, 1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    PRINT_DEBUG("Register 0x%X currently reads 0x%X\n", reg_addr, reg_value[0]);
+
+    // Go through all input options to come up with the final register value:
+    for (i = 0; i < num_configs; i++) {
+        reg_value[0] = apply_config(reg_value[0], configs[i]);
+    }
+
+    PRINT_INFO("Setting register 0x%X to 0x%X\n", reg_addr, (uint8_t) reg_value[0]);
+
+    if ((ret = bus_write(bus, device_addr, reg_addr, reg_value, 0x01)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    PRINT_INFO("Device configured\n");
+
+    return 0;
+}
+
+// Output data rate for the ODR setting (page 51 and 55):
+float odr_to_hz(int odr) {
+    static const float odr_table[16] = {
+        0, 12.5f, 26, 52, 104, 208, 416, 833, 1666, 3332, 6664, 1.6f,
+        0, 0, 0, 0
+    };
+
+    return odr_table[odr & 0x0F];
+}
+
+// milli-g/LSB by FS_XL bits of CTRL1_XL (page 22):
+static const float accel_sensitivity_table[4] = {
+    0.061f, 0.488f, 0.122f, 0.244f
+};
+
+// milli-dps/LSB by FS_G and FS_125 bits of CTRL2_G (page 22):
+static const float gyro_sensitivity_table[8] = {
+    8.75f, 4.375f, 17.5f, 4.375f, 35.0f, 4.375f, 70.0f, 4.375f
+};
+
+float accel_sensitivity(int sensitivity) {
+    return accel_sensitivity_table[(apply_config(0, sensitivity) >> 2) &
+                                   0x03];
+}
+
+float gyro_sensitivity(int sensitivity) {
+    return gyro_sensitivity_table[(apply_config(0, sensitivity) >> 1) &
+                                  0x07];
+}
+
+void unpack_frame(const int *raw, struct ism330dlc_frame *frame) {
+    int i;
+
+    frame->temperature = (int16_t) ((raw[1] << 8) | raw[0]);
+
+    for (i = 0; i < 3; i++) {
+        frame->gyro[i] = (int16_t) ((raw[2 * i + 3] << 8) | raw[2 * i + 2]);
+        frame->accel[i] = (int16_t) ((raw[2 * i + 9] << 8) | raw[2 * i + 8]);
+        frame->mag[i] = 0;
+    }
+
+    frame->flags = FRAME_TEMP | FRAME_GYRO | FRAME_ACCEL;
+}
+
+int get_frame(struct ism330dlc_bus *bus, int device_addr,
+              struct ism330dlc_frame *frame) {
+    int raw_frame_data[14];
+
+    int ret;
+
+    // OUT_TEMP_L (0x20) to OUTZ_H_XL (0x2D) are contiguous:
+    if ((ret = bus_read(bus, device_addr, OUT_TEMP_L, raw_frame_data,
+                        14)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    unpack_frame(raw_frame_data, frame);
+
+    return 0;
+}
+
+int get_frames(struct ism330dlc_bus *bus, int device_addr,
+               struct ism330dlc_frame *frames, int num_frames,
+               unsigned int poll_us) {
+    // Status register (0x1E), reserved (0x1F) then the 14 frame bytes:
+    int raw_frame_data[16];
+
+    uint64_t start_ns = metrics_now_ns();
+    uint64_t spent_us;
+
+    unsigned int waited_us = 0;
+
+    int ret;
+    int i = 0;
+
+    while (i < num_frames) {
+        if ((ret = bus_read(bus, device_addr, STATUS_SPIAux, raw_frame_data,
+                            16)) < 0) {
+            i2c_error_handler(ret);
+            return ret;
+        }
+
+        // Only keep the frame once both sensors have a new sample:
+        if ((raw_frame_data[0] & (STATUS_XLDA | STATUS_GDA)) !=
+            (STATUS_XLDA | STATUS_GDA)) {
+            // Count waits too in case the bus runs on a virtual clock:
+            spent_us = (metrics_now_ns() - start_ns) / 1000;
+
+            if (spent_us < waited_us) {
+                spent_us = waited_us;
+            }
+
+            if (spent_us + poll_us > FRAME_WAIT_US) {
+                PRINT_WARN("No new sample from device 0x%X for %d us\n",
+                           device_addr, FRAME_WAIT_US);
+                return i > 0 ? i : -EDEVICEHUNG;
+            }
+
+            bus_delay_us(bus, poll_us);
+            waited_us += poll_us;
+            continue;
+        }
+
+        unpack_frame(&raw_frame_data[2], &frames[i]);
+
+        start_ns = metrics_now_ns();
+        waited_us = 0;
+
+        i++;
+    }
+
+    return num_frames;
+}
+
+// Get acceleration data and return in mili-g:
+int get_accel(struct ism330dlc_bus *bus, int device_addr, int sensitivity,
+              float *accel_data) {
+    struct bus_recovery recovery;
+    struct retry_policy policy = RETRY_POLICY_DEFAULT;
+
+    int raw_accel_data[6] = {0, 0, 0, 0, 0, 0};
+
+    int16_t accel_x_raw = 0;
+    int16_t accel_y_raw = 0;
+    int16_t accel_z_raw = 0;
+
+    float scale;
+
+    int ret;
+
+    PRINT_DEBUG("Getting accelerometer data from device 0x%X\n", device_addr);
+
+    scale = accel_sensitivity(sensitivity);
+
+    // Get raw acceleration data, giving up at the deadline:
+    recovery_init(&recovery, &policy, NULL);
+
+    if ((ret = read_deadline(bus, &recovery, device_addr, OUTX_L_XL,
+                             raw_accel_data, 6)) < 0) {
+        return ret;
+    }
+
+    // Append MSB to LSB:
+    accel_x_raw = (raw_accel_data[1] << 8) | raw_accel_data[0];
+    accel_y_raw = (raw_accel_data[3] << 8) | raw_accel_data[2];
+    accel_z_raw = (raw_accel_data[5] << 8) | raw_accel_data[4];
+
+    PRINT_DEBUG("accel_x_raw = %d\n", accel_x_raw);
+    PRINT_DEBUG("accel_y_raw = %d\n", accel_y_raw);
+    PRINT_DEBUG("accel_z_raw = %d\n", accel_z_raw);
+
+    // Convert based on scalar:
+    accel_data[0] = scale * accel_x_raw; // [milli-g]
+    accel_data[1] = scale * accel_y_raw; // [milli-g]
+    accel_data[2] = scale * accel_z_raw; // [milli-g]
+
+    PRINT_DEBUG("accel_x_converted = %0.3f milli-g\n", accel_data[0]);
+    PRINT_DEBUG("accel_y_converted = %0.3f milli-g\n", accel_data[1]);
+    PRINT_DEBUG("accel_z_converted = %0.3f milli-g\n", accel_data[2]);
+
+    return 0;
+}
+
+// Get gyroscope data and return in milli degrees per second:
+int get_gyro(struct ism330dlc_bus *bus, int device_addr, int sensitivity,
+             float *gyro_data) {
+    struct bus_recovery recovery;
+    struct retry_policy policy = RETRY_POLICY_DEFAULT;
+
+    int raw_gyro_data[6] = {0, 0, 0, 0, 0, 0};
+
+    int16_t gyro_x_raw = 0;
+    int16_t gyro_y_raw = 0;
+    int16_t gyro_z_raw = 0;
+
+    float scale;
+
+    int ret;
+
+    PRINT_DEBUG("Getting gyroscope data from device 0x%X\n", device_addr);
+
+    scale = gyro_sensitivity(sensitivity);
+
+    PRINT_DEBUG("scale = %0.3f\n", scale);
+
+    // Get raw gyroscope data, giving up at the deadline. A still sensor can
+    // read exactly zero so every value is a good one:
+    recovery_init(&recovery, &policy, NULL);
+
+    if ((ret = read_deadline(bus, &recovery, device_addr, OUTX_L_G,
+                             raw_gyro_data, 6)) < 0) {
+        return ret;
+    }
+
+    // Append MSB to LSB:
+    gyro_x_raw = (raw_gyro_data[1] << 8) | raw_gyro_data[0];
+    gyro_y_raw = (raw_gyro_data[3] << 8) | raw_gyro_data[2];
+    gyro_z_raw = (raw_gyro_data[5] << 8) | raw_gyro_data[4];
+
+    PRINT_DEBUG("gyro_x_raw = %d\n", gyro_x_raw);
+    PRINT_DEBUG("gyro_y_raw = %d\n", gyro_y_raw);
+    PRINT_DEBUG("gyro_z_raw = %d\n", gyro_z_raw);
+
+    // Convert based on scalar:
+    gyro_data[0] = scale * gyro_x_raw; // [milli-dps]
+    gyro_data[1] = scale * gyro_y_raw; // [milli-dps]
+    gyro_data[2] = scale * gyro_z_raw; // [milli-dps]
+
+    PRINT_DEBUG("gyro_x_converted = %0.3f milli-dps\n", gyro_data[0]);
+    PRINT_DEBUG("gyro_y_converted = %0.3f milli-dps\n", gyro_data[1]);
+    PRINT_DEBUG("gyro_z_converted = %0.3f milli-dps\n", gyro_data[2]);
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+#include <math.h>   // C Standard math
+
+// Include user headers:
+#include "ism330dlc_adapt.h"     // ISM330DLC adaptive output data rate
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+static const int adapt_odrs[ADAPT_NUM_RATES][3] = {
+    {ACCEL_26_HZ, GYRO_26_HZ, FIFO_ODR_26_HZ},
+    {ACCEL_52_HZ, GYRO_52_HZ, FIFO_ODR_52_HZ},
+    {ACCEL_104_HZ, GYRO_104_HZ, FIFO_ODR_104_HZ},
+    {ACCEL_208_HZ, GYRO_208_HZ, FIFO_ODR_208_HZ},
+    {ACCEL_416_HZ, GYRO_416_HZ, FIFO_ODR_416_HZ},
+    {ACCEL_833_HZ, GYRO_833_HZ, FIFO_ODR_833_HZ},
+    {ACCEL_1_DOT_66_K_HZ, GYRO_1_DOT_66_K_HZ, FIFO_ODR_1_DOT_66_K_HZ}
+};
+
+void adapt_init(struct adapt *adapt, const struct adapt_config *config,
+                int rate, uint64_t now_ns) {
+    memset(adapt, 0, sizeof(*adapt));
+
+    adapt->config = *config;
+    adapt->rate = rate;
+    adapt->since_ns = now_ns;
+}
+
+int adapt_rate_index(int accel_odr) {
+    int i;
+
+    for (i = 0; i < ADAPT_NUM_RATES; i++) {
+        if (adapt_odrs[i][0] == accel_odr) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int adapt_accel_odr(int rate) {
+    return adapt_odrs[rate][0];
+}
+
+int adapt_gyro_odr(int rate) {
+    return adapt_odrs[rate][1];
+}
+
+int adapt_fifo_odr(int rate) {
+    return adapt_odrs[rate][2];
+}
+
+// Start a new measurement window:
+static void adapt_restart(struct adapt *adapt) {
+    memset(adapt->accel_sum, 0, sizeof(adapt->accel_sum));
+    memset(adapt->accel_sq, 0, sizeof(adapt->accel_sq));
+
+    adapt->gyro_sq = 0;
+    adapt->count = 0;
+    adapt->window_ns = 0;
+}
+
+int adapt_update(struct adapt *adapt, const struct ism330dlc_frame *frames,
+                 int num_frames, float accel_scale, float gyro_scale) {
+    const struct adapt_config *config = &adapt->config;
+
+    double accel_var = 0;
+
+    uint64_t now_ns = 0;
+
+    int axis;
+    int i;
+
+    for (i = 0; i < num_frames; i++) {
+        if ((frames[i].flags & (FRAME_GYRO | FRAME_ACCEL)) !=
+            (FRAME_GYRO | FRAME_ACCEL)) {
+            continue;
+        }
+
+        for (axis = 0; axis < 3; axis++) {
+            adapt->accel_sum[axis] += frames[i].accel[axis];
+            adapt->accel_sq[axis] += (double) frames[i].accel[axis] *
+                                     frames[i].accel[axis];
+            adapt->gyro_sq += (double) frames[i].gyro[axis] *
+                              frames[i].gyro[axis];
+        }
+
+        if (adapt->count++ == 0) {
+            adapt->window_ns = frames[i].timestamp_ns;
+        }
+
+        now_ns = frames[i].timestamp_ns;
+    }
+
+    // Not a full window yet (at 26 Hz a drain is only a frame or two):
+    if ((adapt->count < 2) ||
+        (now_ns - adapt->window_ns < (uint64_t) (1e9 * config->window_s))) {
+        return adapt->rate;
+    }
+
+    for (axis = 0; axis < 3; axis++) {
+        accel_var += adapt->accel_sq[axis] / adapt->count -
+                     (adapt->accel_sum[axis] / adapt->count) *
+                     (adapt->accel_sum[axis] / adapt->count);
+    }
+
+    adapt->accel_mg = accel_scale * sqrt(accel_var > 0 ? accel_var : 0);
+    adapt->gyro_dps = 1e-3 * gyro_scale * sqrt(adapt->gyro_sq / adapt->count);
+
+    adapt_restart(adapt);
+
+    if ((adapt->gyro_dps > config->busy_dps) ||
+        (adapt->accel_mg > config->busy_mg)) {
+        adapt->quiet_ns = 0;
+
+        return adapt->rate < config->max_rate ? adapt->rate + 1 : adapt->rate;
+    }
+
+    if ((adapt->gyro_dps >= config->quiet_dps) ||
+        (adapt->accel_mg >= config->quiet_mg)) {
+        adapt->quiet_ns = 0;
+
+        return adapt->rate;
+    }
+
+    if (adapt->quiet_ns == 0) {
+        adapt->quiet_ns = now_ns;
+    }
+
+    if ((now_ns - adapt->quiet_ns >= (uint64_t) (1e9 * config->hold_s)) &&
+        (adapt->rate > config->min_rate)) {
+        return adapt->rate - 1;
+    }
+
+    return adapt->rate;
+}
+
+void adapt_switched(struct adapt *adapt, int rate, uint64_t now_ns) {
+    adapt->rate_ns[adapt->rate] += now_ns - adapt->since_ns;
+
+    adapt->rate = rate;
+    adapt->since_ns = now_ns;
+    adapt->switches++;
+
+    // Frames from before the switch do not count towards the new rate:
+    adapt_restart(adapt);
+}
+
+void adapt_stage(struct reg_shadow *regs, int rate) {
+    int reg_config[1];
+
+    reg_config[0] = adapt_odrs[rate][0];
+    shadow_stage(regs, CTRL1_XL, reg_config, 1);
+
+    reg_config[0] = adapt_odrs[rate][1];
+    shadow_stage(regs, CTRL2_G, reg_config, 1);
+
+    reg_config[0] = rate > ADAPT_NORMAL_MODE_MAX ? G_HM_MODE_ENABLED :
+                                                   G_HM_MODE_DISABLED;
+    shadow_stage(regs, CTRL7_G, reg_config, 1);
+}
@@ -0,0 +1,57 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library!
+#include <pi_microsleep_hard.h>  // PI microsleep library!
+
+#include "ism330dlc_bus.h"       // ISM330DLC register bus
+
+// pi_i2c is configured globally through config_i2c() so there is no context
+// to carry around:
+static int pi_i2c_read(void *ctx, int device_addr, int reg_addr, int *data,
+                       int num_bytes) {
+    return read_i2c(device_addr, reg_addr, data, num_bytes);
+}
+
+static int pi_i2c_write(void *ctx, int device_addr, int reg_addr, int *data,
+                        int num_bytes) {
+    return write_i2c(device_addr, reg_addr, data, num_bytes);
+}
+
+static int pi_i2c_scan(void *ctx, int *address_book) {
+    return scan_bus_i2c(address_book);
+}
+
+static int pi_i2c_delay_us(void *ctx, unsigned int usec) {
+    return microsleep_hard(usec);
+}
+
+struct ism330dlc_bus pi_i2c_bus = {
+    .name = "pi_i2c",
+    .read = pi_i2c_read,
+    .write = pi_i2c_write,
+    .scan = pi_i2c_scan,
+    .delay_us = pi_i2c_delay_us,
+    .ctx = 0
+};
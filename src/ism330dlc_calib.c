@@ -0,0 +1,446 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <math.h>   // C Standard math
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc_calib.h"     // ISM330DLC bias calibration
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+#define GRAVITY_MG 1000.0f
+
+// Offsets in register LSBs, in the fine weight whenever they fit:
+static void calib_quantize(const float *offset, int *reg, int *coarse) {
+    float weight;
+    int axis;
+
+    *coarse = 0;
+
+    for (axis = 0; axis < 3; axis++) {
+        if (fabsf(offset[axis]) > 127 * CALIB_OFFSET_FINE_MG) {
+            *coarse = 1;
+        }
+    }
+
+    weight = *coarse ? CALIB_OFFSET_COARSE_MG : CALIB_OFFSET_FINE_MG;
+
+    for (axis = 0; axis < 3; axis++) {
+        reg[axis] = lroundf(offset[axis] / weight);
+
+        if (reg[axis] > 127) {
+            reg[axis] = 127;
+        } else if (reg[axis] < -127) {
+            reg[axis] = -127;
+        }
+    }
+}
+
+// Rewrite the registers once the estimate moved by at least an LSB:
+static void calib_check_offsets(struct calib *calib) {
+    int reg[3];
+    int coarse;
+
+    calib_quantize(calib->profile.accel_offset, reg, &coarse);
+
+    if ((coarse != calib->coarse) || (reg[0] != calib->offset_reg[0]) ||
+        (reg[1] != calib->offset_reg[1]) || (reg[2] != calib->offset_reg[2])) {
+        calib->offsets_due = 1;
+    }
+}
+
+static void calib_publish(struct calib *calib) {
+    int axis;
+
+    for (axis = 0; axis < 3; axis++) {
+        atomic_store_explicit(&calib->gyro_bias_udps[axis],
+                              lroundf(calib->profile.gyro_bias[axis] * 1e3f),
+                              memory_order_relaxed);
+    }
+}
+
+void calib_init(struct calib *calib, float accel_scale, float gyro_scale,
+                const struct calib_profile *profile) {
+    memset(calib, 0, sizeof(*calib));
+
+    calib->accel_scale = accel_scale;
+    calib->gyro_scale = gyro_scale;
+
+    if (profile != NULL) {
+        calib->profile = *profile;
+    }
+
+    // The device starts out with no offsets:
+    calib_check_offsets(calib);
+    calib_publish(calib);
+}
+
+// Solve the 4x4 normal equations by Gaussian elimination with partial
+// pivoting. Fails when the orientations do not pin the sphere down:
+static int calib_solve(const struct calib *calib, double *x) {
+    double a[4][5];
+    double factor;
+    double largest = 0;
+    int pivot;
+    int row;
+    int col;
+    int i;
+
+    for (row = 0; row < 4; row++) {
+        for (col = 0; col < 4; col++) {
+            a[row][col] = calib->ata[row][col];
+        }
+
+        a[row][4] = calib->atb[row];
+
+        if (fabs(a[row][row]) > largest) {
+            largest = fabs(a[row][row]);
+        }
+    }
+
+    for (col = 0; col < 4; col++) {
+        pivot = col;
+
+        for (row = col + 1; row < 4; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+
+        if (fabs(a[pivot][col]) < 1e-9 * largest) {
+            return -1;
+        }
+
+        for (i = 0; i < 5; i++) {
+            factor = a[col][i];
+            a[col][i] = a[pivot][i];
+            a[pivot][i] = factor;
+        }
+
+        for (row = col + 1; row < 4; row++) {
+            factor = a[row][col] / a[col][col];
+
+            for (i = col; i < 5; i++) {
+                a[row][i] -= factor * a[col][i];
+            }
+        }
+    }
+
+    for (row = 3; row >= 0; row--) {
+        x[row] = a[row][4];
+
+        for (col = row + 1; col < 4; col++) {
+            x[row] -= a[row][col] * x[col];
+        }
+
+        x[row] /= a[row][row];
+    }
+
+    return 0;
+}
+
+// Accelerometer mean of a still window before the device offsets (m) onto
+// the sphere |m - offset| = r, i.e. |m|^2 = 2 m.offset + (r^2 - |offset|^2):
+static void calib_fit_accel(struct calib *calib, const float *m) {
+    float *offset = calib->profile.accel_offset;
+
+    double row[4] = {2.0 * m[0], 2.0 * m[1], 2.0 * m[2], 1.0};
+    double target = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    double x[4];
+    double radius;
+
+    float norm = sqrtf(target);
+    float u[3] = {m[0] / norm, m[1] / norm, m[2] / norm};
+    float along;
+
+    int axis;
+    int i;
+    int j;
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < 4; j++) {
+            calib->ata[i][j] += row[i] * row[j];
+        }
+
+        calib->atb[i] += row[i] * target;
+    }
+
+    for (i = 0; i < calib->orientations; i++) {
+        if (u[0] * calib->orientation[i][0] + u[1] * calib->orientation[i][1] +
+            u[2] * calib->orientation[i][2] > CALIB_SAME_ORIENTATION_COS) {
+            break;
+        }
+    }
+
+    if ((i == calib->orientations) &&
+        (calib->orientations < CALIB_MAX_ORIENTATIONS)) {
+        memcpy(calib->orientation[calib->orientations++], u, sizeof(u));
+
+        PRINT_DEBUG("Calibration: still in orientation %d (%.2f %.2f %.2f)\n",
+                    calib->orientations, u[0], u[1], u[2]);
+    }
+
+    if ((calib->orientations >= CALIB_FIT_ORIENTATIONS) &&
+        (calib_solve(calib, x) == 0)) {
+        radius = sqrt(x[3] + x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+
+        if (fabs(radius - GRAVITY_MG) < CALIB_GRAVITY_TOLERANCE_MG) {
+            for (axis = 0; axis < 3; axis++) {
+                offset[axis] = x[axis];
+            }
+
+            return;
+        }
+    }
+
+    // One orientation only shows the error along gravity so leave the rest
+    // of the offset as it is:
+    along = -GRAVITY_MG;
+
+    for (axis = 0; axis < 3; axis++) {
+        along += (m[axis] - offset[axis]) * u[axis];
+    }
+
+    for (axis = 0; axis < 3; axis++) {
+        offset[axis] += along * u[axis];
+    }
+}
+
+static void calib_window(struct calib *calib) {
+    struct calib_profile *profile = &calib->profile;
+
+    float mean[6];
+    float sigma[6];
+    float m[3];
+    float magnitude = 0;
+    float scale;
+
+    double mu;
+
+    int axis;
+
+    if (calib->count < CALIB_WINDOW_MIN_SAMPLES) {
+        return;
+    }
+
+    if (calib->skip) {
+        calib->skip--;
+        return;
+    }
+
+    for (axis = 0; axis < 6; axis++) {
+        scale = axis < 3 ? calib->gyro_scale : calib->accel_scale;
+
+        mu = calib->sum[axis] / calib->count;
+
+        mean[axis] = scale * mu;
+        sigma[axis] = scale * sqrt(fmax(calib->sum_sq[axis] / calib->count -
+                                        mu * mu, 0.0));
+
+        if (axis >= 3) {
+            magnitude += mean[axis] * mean[axis];
+        }
+    }
+
+    for (axis = 0; axis < 3; axis++) {
+        if ((sigma[axis] > CALIB_GYRO_STILL_MDPS) ||
+            (sigma[axis + 3] > CALIB_ACCEL_STILL_MG)) {
+            break;
+        }
+    }
+
+    if ((axis < 3) ||
+        (fabsf(sqrtf(magnitude) - GRAVITY_MG) > CALIB_GRAVITY_TOLERANCE_MG)) {
+        calib->moving++;
+        return;
+    }
+
+    calib->still++;
+
+    for (axis = 0; axis < 3; axis++) {
+        if (profile->windows == 0) {
+            profile->gyro_bias[axis] = mean[axis];
+        } else {
+            profile->gyro_bias[axis] += CALIB_GYRO_ALPHA *
+                (mean[axis] - profile->gyro_bias[axis]);
+        }
+
+        // Undo what the device took off:
+        m[axis] = mean[axis + 3] + calib->applied[axis];
+    }
+
+    profile->windows++;
+
+    calib_fit_accel(calib, m);
+    calib_check_offsets(calib);
+    calib_publish(calib);
+
+    PRINT_DEBUG("Calibration: gyro bias %.1f %.1f %.1f mdps, accel offset "
+                "%.1f %.1f %.1f mg\n", profile->gyro_bias[0],
+                profile->gyro_bias[1], profile->gyro_bias[2],
+                profile->accel_offset[0], profile->accel_offset[1],
+                profile->accel_offset[2]);
+}
+
+int calib_feed(struct calib *calib, const struct ism330dlc_frame *frames,
+               int num_frames) {
+    const struct ism330dlc_frame *frame;
+
+    int axis;
+    int i;
+
+    for (i = 0; i < num_frames; i++) {
+        frame = &frames[i];
+
+        // Start over on the first frame and if time went backwards:
+        if ((calib->count == 0) || (frame->timestamp_ns < calib->window_ns)) {
+            memset(calib->sum, 0, sizeof(calib->sum));
+            memset(calib->sum_sq, 0, sizeof(calib->sum_sq));
+            calib->count = 0;
+            calib->window_ns = frame->timestamp_ns;
+        }
+
+        for (axis = 0; axis < 3; axis++) {
+            calib->sum[axis] += frame->gyro[axis];
+            calib->sum_sq[axis] += frame->gyro[axis] * frame->gyro[axis];
+            calib->sum[axis + 3] += frame->accel[axis];
+            calib->sum_sq[axis + 3] += frame->accel[axis] * frame->accel[axis];
+        }
+
+        calib->count++;
+
+        if (frame->timestamp_ns - calib->window_ns >= CALIB_WINDOW_NS) {
+            calib_window(calib);
+            calib->count = 0;
+        }
+    }
+
+    return calib->offsets_due;
+}
+
+void calib_offset_registers(const struct calib *calib, int *offsets,
+                            int *weight) {
+    int reg[3];
+    int coarse;
+    int axis;
+
+    calib_quantize(calib->profile.accel_offset, reg, &coarse);
+
+    // Two's complement:
+    for (axis = 0; axis < 3; axis++) {
+        offsets[axis] = reg[axis] & 0xFF;
+    }
+
+    *weight = coarse ? USR_OFF_W_2_POW_6_G : USR_OFF_W_2_POW_10_G;
+}
+
+void calib_offsets_written(struct calib *calib) {
+    float weight;
+    int axis;
+
+    calib_quantize(calib->profile.accel_offset, calib->offset_reg,
+                   &calib->coarse);
+
+    weight = calib->coarse ? CALIB_OFFSET_COARSE_MG : CALIB_OFFSET_FINE_MG;
+
+    for (axis = 0; axis < 3; axis++) {
+        calib->applied[axis] = calib->offset_reg[axis] * weight;
+    }
+
+    calib->offsets_due = 0;
+
+    // Samples still in the FIFO were taken with the old offsets:
+    calib->count = 0;
+    calib->skip = 1;
+}
+
+void calib_gyro_bias(struct calib *calib, float *gyro_bias) {
+    int axis;
+
+    for (axis = 0; axis < 3; axis++) {
+        gyro_bias[axis] = 1e-3f *
+            atomic_load_explicit(&calib->gyro_bias_udps[axis],
+                                 memory_order_relaxed);
+    }
+}
+
+int calib_load(struct calib_profile *profile, const char *path) {
+    char line[128];
+    char name[32];
+    float v[3];
+    int found = 0;
+
+    FILE *fpt = fopen(path, "r");
+
+    if (fpt == NULL) {
+        return -1;
+    }
+
+    memset(profile, 0, sizeof(*profile));
+
+    while (fgets(line, sizeof(line), fpt) != NULL) {
+        if (sscanf(line, "%31s %f %f %f", name, &v[0], &v[1], &v[2]) == 4) {
+            if (strcmp(name, "accel_offset_mg") == 0) {
+                memcpy(profile->accel_offset, v, sizeof(v));
+                found |= 0x01;
+            } else if (strcmp(name, "gyro_bias_mdps") == 0) {
+                memcpy(profile->gyro_bias, v, sizeof(v));
+                found |= 0x02;
+            }
+        } else if (sscanf(line, "windows %lu", &profile->windows) == 1) {
+            found |= 0x04;
+        }
+    }
+
+    fclose(fpt);
+
+    if (found != 0x07) {
+        PRINT_WARN("Calibration profile %s is incomplete\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int calib_save(const struct calib_profile *profile, const char *path) {
+    FILE *fpt = fopen(path, "w");
+
+    if (fpt == NULL) {
+        PRINT_WARN("Failed to write calibration profile %s\n", path);
+        return -1;
+    }
+
+    fprintf(fpt, "accel_offset_mg %.3f %.3f %.3f\n", profile->accel_offset[0],
+            profile->accel_offset[1], profile->accel_offset[2]);
+    fprintf(fpt, "gyro_bias_mdps %.3f %.3f %.3f\n", profile->gyro_bias[0],
+            profile->gyro_bias[1], profile->gyro_bias[2]);
+    fprintf(fpt, "windows %lu\n", profile->windows);
+
+    fclose(fpt);
+
+    return 0;
+}
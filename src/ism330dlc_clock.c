@@ -0,0 +1,212 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <string.h> // C Standard string manipulation
+#include <time.h>   // C Standard date and time manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_clock.h"     // ISM330DLC timestamp clock model
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Weight kept by older observations on every new one (about the last 200
+// observations count):
+#define CLOCK_FORGET 0.995
+
+// 24 bit counter:
+#define CLOCK_COUNTER_MASK 0xFFFFFF
+#define CLOCK_COUNTER_HALF 0x800000
+
+static uint64_t clock_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void clock_model_init(struct clock_model *model, double tick_ns) {
+    memset(model, 0, sizeof(*model));
+
+    model->tick_ns = tick_ns;
+    model->forget = CLOCK_FORGET;
+    model->rate = tick_ns;
+}
+
+uint64_t clock_model_unwrap(struct clock_model *model, uint32_t raw) {
+    int32_t diff;
+
+    raw &= CLOCK_COUNTER_MASK;
+
+    if (!model->started) {
+        model->started = 1;
+        model->last_raw = raw;
+        model->ticks = raw;
+
+        return model->ticks;
+    }
+
+    // Signed distance from the last reading so slightly older readings go
+    // back a little instead of forward a whole wrap:
+    diff = (int32_t) ((raw - model->last_raw + CLOCK_COUNTER_HALF) &
+                      CLOCK_COUNTER_MASK) - CLOCK_COUNTER_HALF;
+
+    if ((diff > 0) && (raw < model->last_raw)) {
+        model->wraps++;
+    }
+
+    if ((diff < 0) && (model->ticks < (uint64_t) -diff)) {
+        return 0;
+    }
+
+    model->ticks += diff;
+    model->last_raw = raw;
+
+    return model->ticks;
+}
+
+void clock_model_observe(struct clock_model *model, uint64_t ticks,
+                         uint64_t host_ns) {
+    double x;
+    double y;
+    double dx;
+    double dy;
+    double w;
+
+    if (model->observations == 0) {
+        model->origin_ticks = ticks;
+        model->origin_ns = host_ns;
+    }
+
+    // Work about the first observation so doubles keep ns precision:
+    x = (double) ticks - (double) model->origin_ticks;
+    y = (double) host_ns - (double) model->origin_ns;
+
+    // Exponentially weighted running means, variance and covariance:
+    model->weight = model->forget * model->weight + 1.0;
+    w = 1.0 / model->weight;
+
+    dx = x - model->mean_x;
+    dy = y - model->mean_y;
+
+    model->mean_x += w * dx;
+    model->mean_y += w * dy;
+
+    model->var_x = model->forget * model->var_x + dx * (x - model->mean_x);
+    model->cov_xy = model->forget * model->cov_xy + dx * (y - model->mean_y);
+
+    model->observations++;
+
+    // Keep the nominal rate until the observations span enough ticks to
+    // say anything about drift:
+    if (model->var_x > 1.0) {
+        model->rate = model->cov_xy / model->var_x;
+    }
+
+    model->offset_ns = model->mean_y - model->rate * model->mean_x;
+}
+
+uint64_t clock_model_host_ns(struct clock_model *model, uint64_t ticks) {
+    double x = (double) ticks - (double) model->origin_ticks;
+
+    return model->origin_ns + (int64_t) (model->offset_ns + model->rate * x);
+}
+
+double clock_model_drift_ppm(struct clock_model *model) {
+    return (model->rate / model->tick_ns - 1.0) * 1e6;
+}
+
+int enable_device_timer(struct ism330dlc_bus *bus, int device_addr) {
+    int config[1];
+    int ret;
+
+    config[0] = TIMER_HR_25_US;
+
+    if ((ret = configure_device(bus, device_addr, WAKE_UP_DUR, config,
+                                1)) < 0) {
+        return ret;
+    }
+
+    config[0] = TIMER_EN_ENABLED;
+
+    if ((ret = configure_device(bus, device_addr, CTRL10_C, config, 1)) < 0) {
+        return ret;
+    }
+
+    return reset_device_timer(bus, device_addr);
+}
+
+int reset_device_timer(struct ism330dlc_bus *bus, int device_addr) {
+    int reg_value[1];
+    int ret;
+
+    reg_value[0] = TIMESTAMP_RESET;
+
+    if ((ret = bus_write(bus, device_addr, TIMESTAMP2_REG, reg_value,
+                         1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+int get_device_time(struct ism330dlc_bus *bus, int device_addr,
+                    uint32_t *device_time) {
+    int raw_time_data[3];
+    int ret;
+
+    if ((ret = bus_read(bus, device_addr, TIMESTAMP0_REG, raw_time_data,
+                        3)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    *device_time = (raw_time_data[2] << 16) | (raw_time_data[1] << 8) |
+                   raw_time_data[0];
+
+    return 0;
+}
+
+int clock_model_sync(struct clock_model *model, struct ism330dlc_bus *bus,
+                     int device_addr) {
+    uint32_t device_time;
+    uint64_t before;
+    uint64_t after;
+    int ret;
+
+    before = clock_now_ns();
+
+    if ((ret = get_device_time(bus, device_addr, &device_time)) < 0) {
+        return ret;
+    }
+
+    after = clock_now_ns();
+
+    clock_model_observe(model, clock_model_unwrap(model, device_time),
+                        before + (after - before) / 2);
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <math.h>   // C Standard math
+#include <stddef.h> // C Standard definitions
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+#if !defined(ISM330DLC_NO_SIMD) && defined(__ARM_NEON)
+#define CONVERT_NEON
+#include <arm_neon.h>   // Arm NEON intrinsics
+#elif !defined(ISM330DLC_NO_SIMD) && defined(__SSE2__)
+#define CONVERT_SSE2
+#include <emmintrin.h>  // x86 SSE2 intrinsics
+#endif
+
+// Include user headers:
+#include "ism330dlc_convert.h"   // ISM330DLC unit conversion
+
+#define PI 3.14159265358979
+
+// The frame keeps gyro[3] and accel[3] next to each other so one 8 lane
+// load takes both (and mag[0..1] after them, which are ignored):
+_Static_assert(offsetof(struct ism330dlc_frame, accel) ==
+               offsetof(struct ism330dlc_frame, gyro) + 6,
+               "gyro and accel must be contiguous");
+_Static_assert(offsetof(struct ism330dlc_frame, gyro) + 16 <=
+               sizeof(struct ism330dlc_frame),
+               "8 lane load must stay inside the frame");
+
+void convert_scale_init(struct convert_scale *scale, int accel_fs,
+                        int gyro_fs, int units) {
+    double accel = accel_sensitivity(accel_fs); // [milli-g/LSB]
+    double gyro = gyro_sensitivity(gyro_fs);    // [milli-dps/LSB]
+    double unit = 1.0;
+
+    if (units == CONVERT_SI) {
+        accel *= 1e-3 * GRAVITY_CONSTANT;      // [m/s^2/LSB]
+        gyro *= 1e-3 * PI / 180.0;              // [rad/s/LSB]
+        unit = 1e-3 * PI / 180.0;
+    }
+
+    memset(scale, 0, sizeof(*scale));
+
+    scale->gyro_unit = unit;
+    scale->accel = accel;
+    scale->gyro = gyro;
+    scale->accel_q = llround(accel * 4294967296.0);
+    scale->gyro_q = llround(gyro * 4294967296.0);
+}
+
+void convert_scale_bias(struct convert_scale *scale, const float *gyro_bias) {
+    int axis;
+
+    for (axis = 0; axis < 3; axis++) {
+        scale->gyro_bias[axis] = gyro_bias[axis] * scale->gyro_unit;
+        scale->gyro_bias_q[axis] = (int32_t)
+            lroundf(scale->gyro_bias[axis] * 65536.0f);
+    }
+}
+
+#if defined(CONVERT_NEON)
+
+void convert_frames(const struct convert_scale *scales,
+                    const struct ism330dlc_frame *frames, size_t num_frames,
+                    struct convert_sample *out) {
+    const struct convert_scale *scale;
+
+    int16x8_t raw;
+    float32x4_t low;
+    float32x4_t high;
+
+    size_t i;
+
+    for (i = 0; i < num_frames; i++) {
+        scale = &scales[frames[i].sensor];
+
+        // gyro[0..2] accel[0] and accel[1..2] (mag[0..1]):
+        raw = vld1q_s16(frames[i].gyro);
+
+        low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(raw)));
+        high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(raw)));
+
+        low = vmulq_f32(low, vsetq_lane_f32(scale->accel,
+                                            vdupq_n_f32(scale->gyro), 3));
+        low = vsubq_f32(low, vld1q_f32(scale->gyro_bias));
+        high = vmulq_n_f32(high, scale->accel);
+
+        vst1q_f32(out[i].gyro, low);
+        vst1_f32(&out[i].accel[1], vget_low_f32(high));
+    }
+}
+
+#elif defined(CONVERT_SSE2)
+
+void convert_frames(const struct convert_scale *scales,
+                    const struct ism330dlc_frame *frames, size_t num_frames,
+                    struct convert_sample *out) {
+    const struct convert_scale *scale;
+
+    __m128i raw;
+    __m128 low;
+    __m128 high;
+
+    size_t i;
+
+    for (i = 0; i < num_frames; i++) {
+        scale = &scales[frames[i].sensor];
+
+        // gyro[0..2] accel[0] and accel[1..2] (mag[0..1]):
+        raw = _mm_loadu_si128((const __m128i *) frames[i].gyro);
+
+        // Sign extend by putting every word in the top half then shifting:
+        low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw),
+                                             16));
+        high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(raw, raw),
+                                              16));
+
+        low = _mm_mul_ps(low, _mm_set_ps(scale->accel, scale->gyro,
+                                         scale->gyro, scale->gyro));
+        low = _mm_sub_ps(low, _mm_loadu_ps(scale->gyro_bias));
+        high = _mm_mul_ps(high, _mm_set1_ps(scale->accel));
+
+        _mm_storeu_ps(out[i].gyro, low);
+        _mm_storel_pi((__m64 *) &out[i].accel[1], high);
+    }
+}
+
+#else
+
+void convert_frames(const struct convert_scale *scales,
+                    const struct ism330dlc_frame *frames, size_t num_frames,
+                    struct convert_sample *out) {
+    const struct convert_scale *scale;
+
+    size_t i;
+    int axis;
+
+    for (i = 0; i < num_frames; i++) {
+        scale = &scales[frames[i].sensor];
+
+        for (axis = 0; axis < 3; axis++) {
+            out[i].gyro[axis] = scale->gyro * frames[i].gyro[axis] -
+                                scale->gyro_bias[axis];
+            out[i].accel[axis] = scale->accel * frames[i].accel[axis];
+        }
+    }
+}
+
+#endif
+
+// Q32 factor times a 16 bit sample leaves 16 fractional bits after the
+// shift. 64 bit products so this stays a plain loop:
+void convert_frames_q(const struct convert_scale *scales,
+                      const struct ism330dlc_frame *frames,
+                      size_t num_frames, struct convert_sample_q *out) {
+    const struct convert_scale *scale;
+
+    size_t i;
+    int axis;
+
+    for (i = 0; i < num_frames; i++) {
+        scale = &scales[frames[i].sensor];
+
+        for (axis = 0; axis < 3; axis++) {
+            out[i].gyro[axis] = (int32_t)
+                ((scale->gyro_q * frames[i].gyro[axis]) >> 16) -
+                scale->gyro_bias_q[axis];
+            out[i].accel[axis] = (int32_t)
+                ((scale->accel_q * frames[i].accel[axis]) >> 16);
+        }
+    }
+}
+
+const char *convert_kernel(void) {
+#if defined(CONVERT_NEON)
+    return "neon";
+#elif defined(CONVERT_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
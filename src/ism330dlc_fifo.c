@@ -0,0 +1,393 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc_fifo.h"      // ISM330DLC FIFO streaming
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// DEC_FIFO_GYRO/DEC_FIFO_XL code to decimation factor (page 53):
+static const int fifo_decimation[8] = {0, 1, 2, 3, 4, 8, 16, 32};
+
+#define FIFO_DATA_SETS 4
+
+// Lay out which data set and axis every word of the FIFO pattern holds. Data
+// sets are stored in order (gyroscope, accelerometer, the sensor hub as the
+// 3rd and the timestamp as the 4th data set) on every FIFO tick they are not
+// decimated away (page 33). Returns the pattern length or -1 if it does not
+// fit FIFO_PATTERN_MAX:
+static int build_fifo_pattern(struct fifo_stream *stream,
+                              const int *decimation) {
+    int period = 1;
+    int step;
+    int words = 0;
+    int tick;
+    int axis;
+    int set;
+    int n = 0;
+
+    int flag[FIFO_DATA_SETS] = {
+        FRAME_GYRO, FRAME_ACCEL, FRAME_MAG, FRAME_TIMESTAMP
+    };
+
+    // Pattern repeats once every decimated data set lines up again (the
+    // least common multiple of the decimations):
+    for (set = 0; set < FIFO_DATA_SETS; set++) {
+        if (decimation[set]) {
+            step = period;
+
+            while (period % decimation[set]) {
+                period += step;
+            }
+        }
+    }
+
+    for (set = 0; set < FIFO_DATA_SETS; set++) {
+        if (decimation[set]) {
+            words += 3 * period / decimation[set];
+        }
+    }
+
+    if (words > FIFO_PATTERN_MAX) {
+        return -1;
+    }
+
+    for (tick = 0; tick < period; tick++) {
+        for (set = 0; set < FIFO_DATA_SETS; set++) {
+            if (!decimation[set] || (tick % decimation[set])) {
+                continue;
+            }
+
+            for (axis = 0; axis < 3; axis++) {
+                stream->pattern_set[n] = flag[set];
+                stream->pattern_axis[n] = axis;
+                stream->pattern_last[n] = 0;
+                n++;
+            }
+        }
+
+        if (n) {
+            stream->pattern_last[n - 1] = 1;
+        }
+    }
+
+    stream->pattern_len = n;
+
+    return n;
+}
+
+int init_fifo_stream(struct ism330dlc_bus *bus, int device_addr,
+                     const struct fifo_config *config,
+                     struct fifo_stream *stream) {
+    int decimation[FIFO_DATA_SETS] = {
+        fifo_decimation[(config->dec_gyro) & 0x07],
+        fifo_decimation[(config->dec_accel) & 0x07],
+        fifo_decimation[(config->dec_hub) & 0x07],
+        fifo_decimation[(config->dec_timestamp) & 0x07]
+    };
+
+    int ret;
+
+    memset(stream, 0, sizeof(*stream));
+
+    stream->bus = bus;
+    stream->device_addr = device_addr;
+
+    if ((ret = build_fifo_pattern(stream, decimation)) < 0) {
+        PRINT_ERROR("FIFO pattern is longer than %d words\n",
+                    FIFO_PATTERN_MAX);
+        return -1;
+    }
+
+    if (ret == 0) {
+        PRINT_ERROR("No data sets selected for the FIFO\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int restart_fifo_stream(const struct fifo_config *config,
+                        struct fifo_stream *stream) {
+    unsigned long bursts = stream->bursts;
+    unsigned long words = stream->words;
+    unsigned long frames = stream->frames;
+    unsigned long overruns = stream->overruns;
+    unsigned long dropped = stream->dropped;
+
+    int ret;
+
+    if ((ret = init_fifo_stream(stream->bus, stream->device_addr, config,
+                                stream)) < 0) {
+        return ret;
+    }
+
+    stream->bursts = bursts;
+    stream->words = words;
+    stream->frames = frames;
+    stream->overruns = overruns;
+    stream->dropped = dropped;
+
+    return 0;
+}
+
+int fifo_timestamp_enabled(const struct fifo_config *config) {
+    return fifo_decimation[(config->dec_timestamp) & 0x07] != 0;
+}
+
+void fifo_registers(const struct fifo_config *config, int *reg_value) {
+    reg_value[0] = config->watermark & 0xFF;
+    reg_value[1] = FIFO_CTRL2_DEFAULT | ((config->watermark >> 8) & 0x07);
+    reg_value[2] = apply_config(apply_config(FIFO_CTRL3_DEFAULT,
+                                             config->dec_gyro),
+                                config->dec_accel);
+    reg_value[3] = apply_config(FIFO_CTRL4_DEFAULT, config->dec_hub);
+
+    // Timestamp goes in as the 4th data set (page 52):
+    if (fifo_timestamp_enabled(config)) {
+        reg_value[1] = apply_config(reg_value[1], TIMER_PEDO_FIFO_EN_ENABLED);
+        reg_value[3] = apply_config(reg_value[3], config->dec_timestamp);
+    }
+
+    reg_value[4] = apply_config(apply_config(FIFO_CTRL5_DEFAULT, config->odr),
+                                config->mode);
+}
+
+int configure_fifo(struct ism330dlc_bus *bus, int device_addr,
+                   const struct fifo_config *config,
+                   struct fifo_stream *stream) {
+    int reg_value[5];
+    int ret;
+
+    PRINT_INFO("Configuring FIFO on device 0x%X\n", device_addr);
+
+    if ((ret = init_fifo_stream(bus, device_addr, config, stream)) < 0) {
+        return ret;
+    }
+
+    // Going through bypass mode empties the FIFO so the stream starts at the
+    // beginning of the pattern:
+    reg_value[0] = apply_config(FIFO_CTRL5_DEFAULT, FIFO_BYPASS_MODE);
+
+    if ((ret = bus_write(bus, device_addr, FIFO_CTRL5, reg_value, 1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    // FIFO_CTRL1 to FIFO_CTRL5 are contiguous so write them in one burst:
+    fifo_registers(config, reg_value);
+
+    PRINT_INFO("Setting FIFO_CTRL1 to FIFO_CTRL5 to 0x%X 0x%X 0x%X 0x%X 0x%X\n",
+               reg_value[0], reg_value[1], reg_value[2], reg_value[3],
+               reg_value[4]);
+
+    if ((ret = bus_write(bus, device_addr, FIFO_CTRL1, reg_value, 5)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    PRINT_INFO("FIFO configured with a %d word pattern\n", stream->pattern_len);
+
+    return 0;
+}
+
+int get_fifo_status(struct ism330dlc_bus *bus, int device_addr,
+                    struct fifo_status *status) {
+    int reg_value[4];
+    int ret;
+
+    if ((ret = bus_read(bus, device_addr, FIFO_STATUS1, reg_value, 4)) < 0) {
+        return ret;
+    }
+
+    status->unread = ((reg_value[1] & FIFO_STATUS2_DIFF_FIFO) << 8) |
+                     reg_value[0];
+    status->pattern = ((reg_value[3] & 0x03) << 8) | reg_value[2];
+    status->watermark = (reg_value[1] & FIFO_STATUS2_WATERM) != 0;
+    status->overrun = (reg_value[1] & FIFO_STATUS2_OVER_RUN) != 0;
+    status->full = (reg_value[1] & FIFO_STATUS2_FIFO_FULL_SMART) != 0;
+    status->empty = (reg_value[1] & FIFO_STATUS2_FIFO_EMPTY) != 0;
+
+    return 0;
+}
+
+// Timestamp data set bytes: TIMESTAMP[15:8] and TIMESTAMP[23:16], then a
+// spare byte and TIMESTAMP[7:0], then the step counter (page 33):
+static void unpack_fifo_timestamp(struct ism330dlc_frame *frame, int word,
+                                  const int *raw) {
+    if (word == 0) {
+        frame->device_time = (frame->device_time & 0x0000FF) |
+                             ((raw[1] & 0xFF) << 16) | ((raw[0] & 0xFF) << 8);
+    } else if (word == 1) {
+        frame->device_time = (frame->device_time & 0xFFFF00) |
+                             (raw[1] & 0xFF);
+    }
+}
+
+static int drain_fifo_burst(struct fifo_stream *stream,
+                            struct ism330dlc_frame *frames, int max_frames) {
+    struct fifo_status status;
+
+    int num_frames = 0;
+    int words = 0;
+    int skipping;
+    int index;
+    int ret;
+    int i;
+
+    int16_t word;
+
+    if ((ret = get_fifo_status(stream->bus, stream->device_addr,
+                               &status)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    // Words were lost so line the stream back up with the pattern index the
+    // device reports:
+    if (status.overrun) {
+        stream->overruns++;
+        stream->synced = 0;
+    }
+
+    if (!stream->synced) {
+        stream->pattern_index = status.pattern % stream->pattern_len;
+
+        // Throw away the rest of a FIFO tick we came in half way through:
+        stream->skipping = (stream->pattern_index != 0) &&
+            !stream->pattern_last[stream->pattern_index - 1];
+
+        memset(&stream->frame, 0, sizeof(stream->frame));
+
+        stream->synced = 1;
+    }
+
+    // Only read as many words as it takes to fill the frames asked for:
+    index = stream->pattern_index;
+    skipping = stream->skipping;
+
+    while ((words < status.unread) && (num_frames < max_frames)) {
+        if (stream->pattern_last[index]) {
+            if (!skipping) {
+                num_frames++;
+            }
+
+            skipping = 0;
+        }
+
+        index = (index + 1) % stream->pattern_len;
+        words++;
+    }
+
+    if (words == 0) {
+        return 0;
+    }
+
+    // FIFO_DATA_OUT_H rolls back to FIFO_DATA_OUT_L so this is one burst:
+    if ((ret = bus_read(stream->bus, stream->device_addr, FIFO_DATA_OUT_L,
+                        stream->buffer, 2 * words)) < 0) {
+        i2c_error_handler(ret);
+        stream->synced = 0;
+        return ret;
+    }
+
+    num_frames = 0;
+
+    for (i = 0; i < words; i++) {
+        index = stream->pattern_index;
+
+        word = (int16_t) ((stream->buffer[2 * i + 1] << 8) |
+                          stream->buffer[2 * i]);
+
+        if (!stream->skipping) {
+            if (stream->pattern_set[index] == FRAME_GYRO) {
+                stream->frame.gyro[stream->pattern_axis[index]] = word;
+            } else if (stream->pattern_set[index] == FRAME_ACCEL) {
+                stream->frame.accel[stream->pattern_axis[index]] = word;
+            } else if (stream->pattern_set[index] == FRAME_MAG) {
+                stream->frame.mag[stream->pattern_axis[index]] = word;
+            } else {
+                unpack_fifo_timestamp(&stream->frame,
+                                      stream->pattern_axis[index],
+                                      &stream->buffer[2 * i]);
+            }
+
+            stream->frame.flags |= stream->pattern_set[index];
+        }
+
+        if (stream->pattern_last[index]) {
+            if (!stream->skipping) {
+                frames[num_frames++] = stream->frame;
+            }
+
+            stream->skipping = 0;
+            stream->frame.flags = 0;
+        }
+
+        stream->pattern_index = (index + 1) % stream->pattern_len;
+    }
+
+    // The FIFO kept filling while the burst was read out. If it wrapped, the
+    // words read no longer follow the pattern (and OVER_RUN was cleared by
+    // the reads that followed) so throw the burst away rather than hand out
+    // frames made from mismatched words:
+    if ((ret = get_fifo_status(stream->bus, stream->device_addr,
+                               &status)) < 0) {
+        i2c_error_handler(ret);
+        stream->synced = 0;
+        return ret;
+    }
+
+    if (status.pattern % stream->pattern_len != stream->pattern_index) {
+        stream->overruns++;
+        stream->dropped += num_frames;
+        stream->synced = 0;
+        num_frames = 0;
+    }
+
+    // Still at the watermark means INT1 will not see a new edge:
+    stream->backlog = status.watermark;
+
+    stream->bursts++;
+    stream->words += words;
+    stream->frames += num_frames;
+
+    return num_frames;
+}
+
+int drain_fifo(struct fifo_stream *stream, struct ism330dlc_frame *frames,
+               int max_frames) {
+    uint64_t start_ns = metrics_now_ns();
+
+    int ret = drain_fifo_burst(stream, frames, max_frames);
+
+    metrics_record(METRIC_FIFO_DRAIN, start_ns, ret);
+
+    return ret;
+}
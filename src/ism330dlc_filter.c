@@ -0,0 +1,222 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <math.h>   // C Standard math
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc_filter.h"    // ISM330DLC decimation filters
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+
+#define PI 3.14159265358979
+
+// Taps per output sample period (more taps, sharper transition):
+#define FILTER_TAPS_PER_FACTOR 8
+
+// Cutoff as a fraction of the output Nyquist frequency:
+#define FILTER_CUTOFF 0.8
+
+// Blackman windowed sinc, normalised for unity gain at DC:
+static void filter_design(struct filter_stream *stream) {
+    int n = FILTER_TAPS_PER_FACTOR * stream->factor + 1;
+    double cutoff = FILTER_CUTOFF * 0.5 / stream->factor; // [cycles/sample]
+    double sum = 0;
+    double x;
+    int i;
+
+    if (n > FILTER_MAX_TAPS) {
+        n = FILTER_MAX_TAPS;
+    }
+
+    for (i = 0; i < n; i++) {
+        x = i - (n - 1) / 2.0;
+
+        stream->taps[i] = (x == 0 ? 2 * cutoff :
+                           sin(2 * PI * cutoff * x) / (PI * x)) *
+                          (0.42 - 0.5 * cos(2 * PI * i / (n - 1)) +
+                           0.08 * cos(4 * PI * i / (n - 1)));
+        sum += stream->taps[i];
+    }
+
+    for (i = 0; i < n; i++) {
+        stream->taps[i] /= sum;
+    }
+
+    stream->num_taps = n;
+    stream->delay = (n - 1) / 2;
+}
+
+int filter_stream_init(struct filter_stream *stream, int type, int factor) {
+    int i;
+
+    memset(stream, 0, sizeof(*stream));
+
+    if ((factor < 2) || (factor > FILTER_MAX_FACTOR)) {
+        PRINT_ERROR("Decimation factor %d is not between 2 and %d\n", factor,
+                    FILTER_MAX_FACTOR);
+        return -1;
+    }
+
+    stream->type = type;
+    stream->factor = factor;
+
+    if (type == FILTER_FIR) {
+        filter_design(stream);
+    } else {
+        stream->cic_gain = 1;
+
+        for (i = 0; i < FILTER_CIC_ORDER; i++) {
+            stream->cic_gain *= factor;
+        }
+
+        stream->delay = FILTER_CIC_ORDER * (factor - 1) / 2;
+    }
+
+    return 0;
+}
+
+static int16_t filter_saturate(double value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    } else if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+
+    return (int16_t) lrint(value);
+}
+
+// Only the window ending at the kept frame is ever summed:
+static double filter_fir(const struct filter_stream *stream,
+                         const float *window) {
+    double sum = 0;
+    int i;
+
+    for (i = 0; i < stream->num_taps; i++) {
+        sum += stream->taps[i] * window[i];
+    }
+
+    return sum;
+}
+
+static double filter_cic_comb(const struct filter_stream *stream,
+                              struct decimator *dec, int channel) {
+    uint64_t value = dec->integrator[channel][FILTER_CIC_ORDER - 1];
+    uint64_t previous;
+    int stage;
+
+    for (stage = 0; stage < FILTER_CIC_ORDER; stage++) {
+        previous = value;
+        value -= dec->comb[channel][stage];
+        dec->comb[channel][stage] = previous;
+    }
+
+    return (double) (int64_t) value / stream->cic_gain;
+}
+
+size_t filter_stream_run(struct filter_stream *stream,
+                         const struct ism330dlc_frame *frames,
+                         size_t num_frames, struct ism330dlc_frame *out) {
+    const struct ism330dlc_frame *frame;
+
+    struct decimator *dec;
+
+    int16_t value[FILTER_CHANNELS];
+    double result;
+
+    size_t num_out = 0;
+    size_t i;
+
+    int newest;
+    int channel;
+    int stage;
+
+    for (i = 0; i < num_frames; i++) {
+        frame = &frames[i];
+
+        if ((frame->sensor < 0) || (frame->sensor >= FILTER_MAX_SENSORS)) {
+            continue;
+        }
+
+        dec = &stream->sensors[frame->sensor];
+
+        for (channel = 0; channel < 3; channel++) {
+            value[channel] = frame->gyro[channel];
+            value[channel + 3] = frame->accel[channel];
+        }
+
+        for (channel = 0; channel < FILTER_CHANNELS; channel++) {
+            dec->history[channel][dec->head] = value[channel];
+            dec->history[channel][dec->head + FILTER_HISTORY] =
+                value[channel];
+
+            if (stream->type == FILTER_CIC) {
+                dec->integrator[channel][0] += (int64_t) value[channel];
+
+                for (stage = 1; stage < FILTER_CIC_ORDER; stage++) {
+                    dec->integrator[channel][stage] +=
+                        dec->integrator[channel][stage - 1];
+                }
+            }
+        }
+
+        dec->stamps[dec->head] = frame->timestamp_ns;
+        dec->stamps[dec->head + FILTER_HISTORY] = frame->timestamp_ns;
+        dec->head = (dec->head + 1) % FILTER_HISTORY;
+
+        if (++dec->phase < stream->factor) {
+            continue;
+        }
+
+        dec->phase = 0;
+
+        // Copy the frame before writing over it (out may be frames):
+        newest = dec->head + FILTER_HISTORY - 1;
+
+        out[num_out] = *frame;
+        out[num_out].timestamp_ns = dec->stamps[newest - stream->delay];
+
+        for (channel = 0; channel < FILTER_CHANNELS; channel++) {
+            if (stream->type == FILTER_FIR) {
+                result = filter_fir(stream, &dec->history[channel]
+                                    [newest + 1 - stream->num_taps]);
+            } else {
+                result = filter_cic_comb(stream, dec, channel);
+            }
+
+            if (channel < 3) {
+                out[num_out].gyro[channel] = filter_saturate(result);
+            } else {
+                out[num_out].accel[channel - 3] = filter_saturate(result);
+            }
+        }
+
+        num_out++;
+    }
+
+    stream->frames_in += num_frames;
+    stream->frames_out += num_out;
+
+    return num_out;
+}
@@ -0,0 +1,402 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <math.h>   // C Standard math
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc_fusion.h"    // ISM330DLC attitude estimation
+
+// Samples converted at a time by fusion_frames():
+#define FUSION_CHUNK 64
+
+// Fixed-point formats:
+#define Q30_ONE (1 << 30)
+#define Q16_ONE (1 << 16)
+
+#define QMUL30(a, b) ((int32_t) (((int64_t) (a) * (b)) >> 30))
+
+static void normalize(float *v, int n) {
+    float norm = 0.0f;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        norm += v[i] * v[i];
+    }
+
+    if (norm > 0.0f) {
+        norm = 1.0f / sqrtf(norm);
+
+        for (i = 0; i < n; i++) {
+            v[i] *= norm;
+        }
+    }
+}
+
+void fusion_init(struct fusion *fusion, int filter) {
+    memset(fusion, 0, sizeof(*fusion));
+
+    fusion->filter = filter;
+    fusion->beta = FUSION_MADGWICK_BETA;
+    fusion->kp = FUSION_MAHONY_KP;
+    fusion->ki = FUSION_MAHONY_KI;
+
+    fusion->kp_q = (int32_t) lroundf(fusion->kp * Q16_ONE);
+    fusion->ki_q = (int32_t) lroundf(fusion->ki * Q16_ONE);
+
+    fusion->q[0] = 1.0f;
+    fusion->q_q[0] = Q30_ONE;
+}
+
+// Start level with gravity (yaw is unobservable without a magnetometer so it
+// starts at zero):
+static void fusion_align(struct fusion *fusion, const float *accel) {
+    float roll = atan2f(accel[1], accel[2]) * 0.5f;
+    float pitch = atan2f(-accel[0], sqrtf(accel[1] * accel[1] +
+                                          accel[2] * accel[2])) * 0.5f;
+    int i;
+
+    fusion->q[0] = cosf(roll) * cosf(pitch);
+    fusion->q[1] = sinf(roll) * cosf(pitch);
+    fusion->q[2] = cosf(roll) * sinf(pitch);
+    fusion->q[3] = -sinf(roll) * sinf(pitch);
+
+    for (i = 0; i < 4; i++) {
+        fusion->q_q[i] = (int32_t) lroundf(fusion->q[i] * Q30_ONE);
+    }
+}
+
+// Time to integrate over since the sensor's previous sample. 0 for the first
+// sample and after gaps (nothing to integrate):
+static int64_t fusion_dt_ns(struct fusion *fusion, uint64_t timestamp_ns) {
+    int64_t dt_ns = (int64_t) (timestamp_ns - fusion->last_ns);
+
+    fusion->last_ns = timestamp_ns;
+    fusion->updates++;
+
+    if ((dt_ns <= 0) || (dt_ns > (int64_t) (FUSION_MAX_DT_S * 1e9f))) {
+        fusion->restarts++;
+        return 0;
+    }
+
+    return dt_ns;
+}
+
+// Madgwick's IMU update (gradient descent towards the measured gravity
+// direction, then gyroscope integration):
+static void madgwick_update(struct fusion *fusion, const float *g,
+                            const float *accel, float dt) {
+    float *q = fusion->q;
+    float a[3] = {accel[0], accel[1], accel[2]};
+    float s[4];
+    float q_dot[4];
+    int i;
+
+    q_dot[0] = 0.5f * (-q[1] * g[0] - q[2] * g[1] - q[3] * g[2]);
+    q_dot[1] = 0.5f * (q[0] * g[0] + q[2] * g[2] - q[3] * g[1]);
+    q_dot[2] = 0.5f * (q[0] * g[1] - q[1] * g[2] + q[3] * g[0]);
+    q_dot[3] = 0.5f * (q[0] * g[2] + q[1] * g[1] - q[2] * g[0]);
+
+    if ((a[0] != 0.0f) || (a[1] != 0.0f) || (a[2] != 0.0f)) {
+        normalize(a, 3);
+
+        s[0] = 4.0f * q[0] * q[2] * q[2] + 2.0f * q[2] * a[0] +
+               4.0f * q[0] * q[1] * q[1] - 2.0f * q[1] * a[1];
+        s[1] = 4.0f * q[1] * q[3] * q[3] - 2.0f * q[3] * a[0] +
+               4.0f * q[0] * q[0] * q[1] - 2.0f * q[0] * a[1] - 4.0f * q[1] +
+               8.0f * q[1] * q[1] * q[1] + 8.0f * q[1] * q[2] * q[2] +
+               4.0f * q[1] * a[2];
+        s[2] = 4.0f * q[0] * q[0] * q[2] + 2.0f * q[0] * a[0] +
+               4.0f * q[2] * q[3] * q[3] - 2.0f * q[3] * a[1] - 4.0f * q[2] +
+               8.0f * q[2] * q[1] * q[1] + 8.0f * q[2] * q[2] * q[2] +
+               4.0f * q[2] * a[2];
+        s[3] = 4.0f * q[1] * q[1] * q[3] - 2.0f * q[1] * a[0] +
+               4.0f * q[2] * q[2] * q[3] - 2.0f * q[2] * a[1];
+
+        normalize(s, 4);
+
+        for (i = 0; i < 4; i++) {
+            q_dot[i] -= fusion->beta * s[i];
+        }
+    }
+
+    for (i = 0; i < 4; i++) {
+        q[i] += q_dot[i] * dt;
+    }
+
+    normalize(q, 4);
+}
+
+// Mahony's update (PI feedback on the angle between measured and estimated
+// gravity added to the gyroscope rate, then integration):
+static void mahony_update(struct fusion *fusion, const float *gyro,
+                          const float *accel, float dt) {
+    float *q = fusion->q;
+    float a[3] = {accel[0], accel[1], accel[2]};
+    float g[3] = {gyro[0], gyro[1], gyro[2]};
+    float v[3];
+    float e[3];
+    float q_prev[4];
+    int i;
+
+    if ((a[0] != 0.0f) || (a[1] != 0.0f) || (a[2] != 0.0f)) {
+        normalize(a, 3);
+
+        // Gravity direction in the sensor frame:
+        v[0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+        v[1] = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+        v[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+
+        e[0] = a[1] * v[2] - a[2] * v[1];
+        e[1] = a[2] * v[0] - a[0] * v[2];
+        e[2] = a[0] * v[1] - a[1] * v[0];
+
+        for (i = 0; i < 3; i++) {
+            fusion->integral[i] += fusion->ki * e[i] * dt;
+            g[i] += fusion->kp * e[i] + fusion->integral[i];
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        g[i] *= 0.5f * dt;
+    }
+
+    memcpy(q_prev, q, sizeof(q_prev));
+
+    q[0] += -q_prev[1] * g[0] - q_prev[2] * g[1] - q_prev[3] * g[2];
+    q[1] += q_prev[0] * g[0] + q_prev[2] * g[2] - q_prev[3] * g[1];
+    q[2] += q_prev[0] * g[1] - q_prev[1] * g[2] + q_prev[3] * g[0];
+    q[3] += q_prev[0] * g[2] + q_prev[1] * g[1] - q_prev[2] * g[0];
+
+    normalize(q, 4);
+}
+
+void fusion_update(struct fusion *fusion, const struct convert_sample *sample,
+                   uint64_t timestamp_ns) {
+    int64_t dt_ns;
+
+    if (!fusion->started) {
+        fusion_align(fusion, sample->accel);
+        fusion->started = 1;
+        fusion->last_ns = timestamp_ns;
+        return;
+    }
+
+    if ((dt_ns = fusion_dt_ns(fusion, timestamp_ns)) == 0) {
+        return;
+    }
+
+    if (fusion->filter == FUSION_MADGWICK) {
+        madgwick_update(fusion, sample->gyro, sample->accel, dt_ns * 1e-9f);
+    } else {
+        mahony_update(fusion, sample->gyro, sample->accel, dt_ns * 1e-9f);
+    }
+}
+
+static uint32_t isqrt64(uint64_t x) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return (uint32_t) root;
+}
+
+// Mahony in fixed-point. Unit vectors and the quaternion are Q30, rates and
+// gains Q16.16 and dt Q30 seconds (FUSION_MAX_DT_S keeps every product inside
+// 64 bits). The quaternion is brought back to unit length with one Newton
+// step of 1/sqrt around 1, which is all the drift of one update needs:
+void fusion_update_q(struct fusion *fusion,
+                     const struct convert_sample_q *sample,
+                     uint64_t timestamp_ns) {
+    int32_t *q = fusion->q_q;
+    int32_t a[3];
+    int32_t v[3];
+    int32_t e;
+    int32_t h[3];
+    int32_t q_prev[4];
+    int64_t g[3];
+    int64_t dt_q;
+    int64_t norm;
+    int64_t scale;
+    float accel[3];
+    int i;
+
+    if (!fusion->started) {
+        for (i = 0; i < 3; i++) {
+            accel[i] = sample->accel[i] / (float) Q16_ONE;
+        }
+
+        fusion_align(fusion, accel);
+        fusion->started = 1;
+        fusion->last_ns = timestamp_ns;
+        return;
+    }
+
+    if ((dt_q = fusion_dt_ns(fusion, timestamp_ns)) == 0) {
+        return;
+    }
+
+    dt_q = (dt_q << 30) / 1000000000;
+
+    for (i = 0; i < 3; i++) {
+        g[i] = sample->gyro[i];
+    }
+
+    norm = 0;
+
+    for (i = 0; i < 3; i++) {
+        norm += (int64_t) sample->accel[i] * sample->accel[i];
+    }
+
+    if ((norm = isqrt64(norm)) > 0) {
+        for (i = 0; i < 3; i++) {
+            a[i] = (int32_t) (((int64_t) sample->accel[i] << 30) / norm);
+        }
+
+        v[0] = 2 * (QMUL30(q[1], q[3]) - QMUL30(q[0], q[2]));
+        v[1] = 2 * (QMUL30(q[0], q[1]) + QMUL30(q[2], q[3]));
+        v[2] = QMUL30(q[0], q[0]) - QMUL30(q[1], q[1]) -
+               QMUL30(q[2], q[2]) + QMUL30(q[3], q[3]);
+
+        for (i = 0; i < 3; i++) {
+            // Cross product a x v, in Q16.16:
+            e = (QMUL30(a[(i + 1) % 3], v[(i + 2) % 3]) -
+                 QMUL30(a[(i + 2) % 3], v[(i + 1) % 3])) >> 14;
+
+            fusion->integral_q[i] += (int32_t)
+                ((((int64_t) fusion->ki_q * e >> 16) * dt_q) >> 30);
+            g[i] += ((int64_t) fusion->kp_q * e >> 16) +
+                    fusion->integral_q[i];
+        }
+    }
+
+    // Half the rotation over dt, Q16.16 * Q30 down to Q30:
+    for (i = 0; i < 3; i++) {
+        h[i] = (int32_t) ((g[i] * dt_q + (1 << 16)) >> 17);
+    }
+
+    memcpy(q_prev, q, sizeof(q_prev));
+
+    q[0] += -QMUL30(q_prev[1], h[0]) - QMUL30(q_prev[2], h[1]) -
+            QMUL30(q_prev[3], h[2]);
+    q[1] += QMUL30(q_prev[0], h[0]) + QMUL30(q_prev[2], h[2]) -
+            QMUL30(q_prev[3], h[1]);
+    q[2] += QMUL30(q_prev[0], h[1]) - QMUL30(q_prev[1], h[2]) +
+            QMUL30(q_prev[3], h[0]);
+    q[3] += QMUL30(q_prev[0], h[2]) + QMUL30(q_prev[1], h[1]) -
+            QMUL30(q_prev[2], h[0]);
+
+    norm = 0;
+
+    for (i = 0; i < 4; i++) {
+        norm += QMUL30(q[i], q[i]);
+    }
+
+    scale = (3LL * Q30_ONE - norm) >> 1;
+
+    for (i = 0; i < 4; i++) {
+        q[i] = (int32_t) ((q[i] * scale) >> 30);
+    }
+}
+
+void fusion_frames(struct fusion *fusions, const struct convert_scale *scales,
+                   const struct ism330dlc_frame *frames, size_t num_frames,
+                   struct fusion_attitude *out) {
+#ifdef ISM330DLC_FUSION_FIXED
+    struct convert_sample_q samples[FUSION_CHUNK];
+#else
+    struct convert_sample samples[FUSION_CHUNK];
+#endif
+    struct fusion *fusion;
+
+    size_t chunk;
+    size_t i;
+    int j;
+
+    while (num_frames > 0) {
+        chunk = num_frames < FUSION_CHUNK ? num_frames : FUSION_CHUNK;
+
+#ifdef ISM330DLC_FUSION_FIXED
+        convert_frames_q(scales, frames, chunk, samples);
+#else
+        convert_frames(scales, frames, chunk, samples);
+#endif
+
+        for (i = 0; i < chunk; i++) {
+            fusion = &fusions[frames[i].sensor];
+
+#ifdef ISM330DLC_FUSION_FIXED
+            fusion_update_q(fusion, &samples[i], frames[i].timestamp_ns);
+
+            for (j = 0; j < 4; j++) {
+                out[i].q[j] = fusion->q_q[j] / (float) Q30_ONE;
+            }
+#else
+            fusion_update(fusion, &samples[i], frames[i].timestamp_ns);
+
+            for (j = 0; j < 4; j++) {
+                out[i].q[j] = fusion->q[j];
+            }
+#endif
+
+            out[i].timestamp_ns = frames[i].timestamp_ns;
+            out[i].sensor = frames[i].sensor;
+        }
+
+        frames += chunk;
+        out += chunk;
+        num_frames -= chunk;
+    }
+}
+
+void fusion_euler(const float *q, float *euler) {
+    float sin_pitch = 2.0f * (q[0] * q[2] - q[3] * q[1]);
+
+    if (sin_pitch > 1.0f) {
+        sin_pitch = 1.0f;
+    } else if (sin_pitch < -1.0f) {
+        sin_pitch = -1.0f;
+    }
+
+    euler[0] = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                      1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]));
+    euler[1] = asinf(sin_pitch);
+    euler[2] = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                      1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]));
+}
@@ -0,0 +1,199 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_hub.h"       // ISM330DLC sensor hub
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Point slave 0 at a register of the magnetometer: reading num_bytes from
+// it, or writing data to it with num_bytes 0. The slave registers sit in
+// embedded functions bank A so switch over and always back again:
+static int hub_slave(struct reg_shadow *regs, int slave_addr, int reg_addr,
+                     int num_bytes, int data) {
+    int reg_value[4];
+    int ret;
+    int err;
+
+    reg_value[0] = apply_config(FUNC_CFG_ACCESS_DEFAULT, FUNC_CFG_EN_ENABLED);
+
+    if ((ret = bus_write(regs->bus, regs->device_addr, FUNC_CFG_ACCESS,
+                         reg_value, 1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    reg_value[0] = (slave_addr << 1) | (num_bytes ? SLV0_ADD_READ : 0);
+    reg_value[1] = reg_addr;
+    reg_value[2] = apply_config(0, SLAVE0_NUMOP_FIELD | num_bytes);
+
+    ret = bus_write(regs->bus, regs->device_addr, SLV0_ADD, reg_value, 3);
+
+    if ((ret == 0) && (num_bytes == 0)) {
+        reg_value[0] = data;
+        ret = bus_write(regs->bus, regs->device_addr,
+                        DATAWRITE_SRC_MODE_SUB_SLV0, reg_value, 1);
+    }
+
+    reg_value[0] = FUNC_CFG_ACCESS_DEFAULT;
+
+    if ((err = bus_write(regs->bus, regs->device_addr, FUNC_CFG_ACCESS,
+                         reg_value, 1)) < 0) {
+        ret = err;
+    }
+
+    if (ret < 0) {
+        i2c_error_handler(ret);
+    }
+
+    return ret;
+}
+
+// Turn the master on for one sensor hub cycle (started by the next
+// accelerometer sample) and wait for it to finish:
+static int hub_cycle(struct reg_shadow *regs) {
+    unsigned int waited_us = 0;
+
+    int reg_config[1];
+    int reg_value[1];
+    int done = 0;
+    int ret;
+
+    // FUNC_SRC1 clears on read so a finished cycle from before is gone:
+    if ((ret = bus_read(regs->bus, regs->device_addr, FUNC_SRC1, reg_value,
+                        1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    reg_config[0] = MASTER_ON_ENABLED;
+
+    if ((ret = shadow_write(regs, MASTER_CONFIG, reg_config, 1)) < 0) {
+        return ret;
+    }
+
+    while (!done && (waited_us < HUB_TIMEOUT_US)) {
+        bus_delay_us(regs->bus, HUB_POLL_US);
+        waited_us += HUB_POLL_US;
+
+        if ((ret = bus_read(regs->bus, regs->device_addr, FUNC_SRC1,
+                            reg_value, 1)) < 0) {
+            i2c_error_handler(ret);
+            return ret;
+        }
+
+        done = reg_value[0] & FUNC_SRC1_SENSORHUB_END_OP;
+    }
+
+    reg_config[0] = MASTER_ON_DISABLED;
+
+    if ((ret = shadow_write(regs, MASTER_CONFIG, reg_config, 1)) < 0) {
+        return ret;
+    }
+
+    if (!done) {
+        PRINT_ERROR("Sensor hub cycle did not finish in %d us\n",
+                    HUB_TIMEOUT_US);
+        return -1;
+    }
+
+    return 0;
+}
+
+int hub_open(struct reg_shadow *regs, const struct hub_config *config) {
+    // LIS2MDL registers to set up, one per sensor hub cycle:
+    static const int setup[][2] = {
+        {LIS2MDL_CFG_REG_A, LIS2MDL_CFG_REG_A_100_HZ},
+        {LIS2MDL_CFG_REG_C, LIS2MDL_CFG_REG_C_BDU}
+    };
+
+    int reg_config[2];
+    int reg_value[1];
+    int ret;
+    unsigned int i;
+
+    PRINT_INFO("Opening magnetometer 0x%X on the sensor hub of device 0x%X\n",
+               config->mag_addr, regs->device_addr);
+
+    // Embedded functions on and the master held off while slave 0 is set up:
+    reg_config[0] = FUNC_EN_ENABLED;
+    shadow_stage(regs, CTRL10_C, reg_config, 1);
+
+    reg_config[0] = MASTER_ON_DISABLED;
+    reg_config[1] = config->pull_up ? PULL_UP_EN_ENABLED : PULL_UP_EN_DISABLED;
+    shadow_stage(regs, MASTER_CONFIG, reg_config, 2);
+
+    if ((ret = shadow_commit(regs)) < 0) {
+        return ret;
+    }
+
+    // Check the magnetometer is there before writing to it:
+    if (((ret = hub_slave(regs, config->mag_addr, LIS2MDL_WHO_AM_I, 1,
+                          0)) < 0) ||
+        ((ret = hub_cycle(regs)) < 0)) {
+        return ret;
+    }
+
+    if ((ret = bus_read(regs->bus, regs->device_addr, SENSORHUB1_REG,
+                        reg_value, 1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    if (reg_value[0] != LIS2MDL_ID) {
+        PRINT_ERROR("Magnetometer 0x%X gave ID 0x%X, expected 0x%X\n",
+                    config->mag_addr, reg_value[0], LIS2MDL_ID);
+        return -1;
+    }
+
+    for (i = 0; i < sizeof(setup) / sizeof(setup[0]); i++) {
+        if (((ret = hub_slave(regs, config->mag_addr, setup[i][0], 0,
+                              setup[i][1])) < 0) ||
+            ((ret = hub_cycle(regs)) < 0)) {
+            return ret;
+        }
+    }
+
+    // Leave slave 0 reading the output registers every cycle:
+    if ((ret = hub_slave(regs, config->mag_addr, LIS2MDL_OUTX_L_REG,
+                         HUB_MAG_BYTES, 0)) < 0) {
+        return ret;
+    }
+
+    reg_config[0] = MASTER_ON_ENABLED;
+
+    return shadow_write(regs, MASTER_CONFIG, reg_config, 1);
+}
+
+void hub_unpack(const int *raw, int16_t *mag) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        mag[i] = (int16_t) ((raw[2 * i + 1] << 8) | raw[2 * i]);
+    }
+}
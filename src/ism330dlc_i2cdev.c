@@ -0,0 +1,388 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <errno.h>  // C Standard error numbers
+#include <time.h>   // C Standard date and time manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include POSIX and Linux headers:
+#include <fcntl.h>          // POSIX file control
+#include <unistd.h>         // POSIX read/close
+#include <sys/ioctl.h>      // ioctl
+#include <linux/i2c-dev.h>  // Linux I2C character device
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library! (error codes)
+
+#include "ism330dlc_i2cdev.h"    // ISM330DLC Linux i2c-dev bus
+
+static int i2cdev_error(int error) {
+    switch (error) {
+        case ENXIO:
+        case EREMOTEIO:
+            return -ENACK;
+        case ETIMEDOUT:
+            return -EBUSLOCKUP;
+        case EAGAIN:
+            return -EFAILSTCOND;
+        default:
+            return -EBUSUNKERR;
+    }
+}
+
+static int i2cdev_transfer(struct i2cdev *dev, struct i2c_msg *msgs,
+                           int num_msgs) {
+    struct i2c_rdwr_ioctl_data rdwr;
+
+    int ret;
+
+    dev->transfers++;
+
+    if (dev->transfer != NULL) {
+        ret = dev->transfer(dev->ctx, msgs, num_msgs);
+
+        return ret < 0 ? i2cdev_error(-ret) : 0;
+    }
+
+    rdwr.msgs = msgs;
+    rdwr.nmsgs = num_msgs;
+
+    if (ioctl(dev->fd, I2C_RDWR, &rdwr) < 0) {
+        return i2cdev_error(errno);
+    }
+
+    return 0;
+}
+
+static int i2cdev_smbus(struct i2cdev *dev, int device_addr, char read_write,
+                        int command, int size, union i2c_smbus_data *data) {
+    struct i2c_smbus_ioctl_data args;
+
+    if (device_addr != dev->slave_addr) {
+        if (ioctl(dev->fd, I2C_SLAVE, device_addr) < 0) {
+            return i2cdev_error(errno);
+        }
+
+        dev->slave_addr = device_addr;
+    }
+
+    dev->transfers++;
+
+    args.read_write = read_write;
+    args.command = command;
+    args.size = size;
+    args.data = data;
+
+    if (ioctl(dev->fd, I2C_SMBUS, &args) < 0) {
+        return i2cdev_error(errno);
+    }
+
+    return 0;
+}
+
+static int i2cdev_smbus_read(struct i2cdev *dev, int device_addr,
+                             int reg_addr, int *data, int num_bytes) {
+    union i2c_smbus_data block;
+
+    int chunk;
+    int ret;
+    int i;
+
+    while (num_bytes > 0) {
+        chunk = num_bytes < I2CDEV_BLOCK_BYTES ? num_bytes :
+                                                 I2CDEV_BLOCK_BYTES;
+        block.block[0] = chunk;
+
+        if ((ret = i2cdev_smbus(dev, device_addr, I2C_SMBUS_READ, reg_addr,
+                                I2C_SMBUS_I2C_BLOCK_DATA, &block)) < 0) {
+            return ret;
+        }
+
+        for (i = 0; i < chunk; i++) {
+            data[i] = block.block[i + 1];
+        }
+
+        reg_addr = bus_burst_next(reg_addr, chunk);
+        data += chunk;
+        num_bytes -= chunk;
+    }
+
+    return 0;
+}
+
+static int i2cdev_smbus_write(struct i2cdev *dev, int device_addr,
+                              int reg_addr, int *data, int num_bytes) {
+    union i2c_smbus_data block;
+
+    int chunk;
+    int ret;
+    int i;
+
+    while (num_bytes > 0) {
+        chunk = num_bytes < I2CDEV_BLOCK_BYTES ? num_bytes :
+                                                 I2CDEV_BLOCK_BYTES;
+        block.block[0] = chunk;
+
+        for (i = 0; i < chunk; i++) {
+            block.block[i + 1] = data[i];
+        }
+
+        if ((ret = i2cdev_smbus(dev, device_addr, I2C_SMBUS_WRITE, reg_addr,
+                                I2C_SMBUS_I2C_BLOCK_DATA, &block)) < 0) {
+            return ret;
+        }
+
+        reg_addr = bus_burst_next(reg_addr, chunk);
+        data += chunk;
+        num_bytes -= chunk;
+    }
+
+    return 0;
+}
+
+static int i2cdev_read(void *ctx, int device_addr, int reg_addr, int *data,
+                       int num_bytes) {
+    struct i2cdev *dev = ctx;
+    struct i2c_msg msgs[2];
+
+    uint8_t addr = reg_addr;
+    uint8_t buffer[I2CDEV_MAX_BYTES];
+
+    int ret;
+    int i;
+
+    if ((num_bytes <= 0) || (num_bytes > I2CDEV_MAX_BYTES)) {
+        return -EBADXFR;
+    }
+
+    if (!(dev->funcs & I2C_FUNC_I2C)) {
+        return i2cdev_smbus_read(dev, device_addr, reg_addr, data, num_bytes);
+    }
+
+    // Register address, repeated start, data:
+    msgs[0].addr = device_addr;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &addr;
+
+    msgs[1].addr = device_addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = num_bytes;
+    msgs[1].buf = buffer;
+
+    if ((ret = i2cdev_transfer(dev, msgs, 2)) < 0) {
+        return ret;
+    }
+
+    for (i = 0; i < num_bytes; i++) {
+        data[i] = buffer[i];
+    }
+
+    return 0;
+}
+
+static int i2cdev_write(void *ctx, int device_addr, int reg_addr, int *data,
+                        int num_bytes) {
+    struct i2cdev *dev = ctx;
+    struct i2c_msg msg;
+
+    uint8_t buffer[I2CDEV_MAX_BYTES + 1];
+
+    int i;
+
+    if ((num_bytes <= 0) || (num_bytes > I2CDEV_MAX_BYTES)) {
+        return -EBADXFR;
+    }
+
+    if (!(dev->funcs & I2C_FUNC_I2C)) {
+        return i2cdev_smbus_write(dev, device_addr, reg_addr, data,
+                                  num_bytes);
+    }
+
+    // Register address and data in one message:
+    buffer[0] = reg_addr;
+
+    for (i = 0; i < num_bytes; i++) {
+        buffer[i + 1] = data[i];
+    }
+
+    msg.addr = device_addr;
+    msg.flags = 0;
+    msg.len = num_bytes + 1;
+    msg.buf = buffer;
+
+    return i2cdev_transfer(dev, &msg, 1);
+}
+
+// A one byte read at every address like i2cdetect -r (a read is harmless
+// to the ISM330DLC where a quick write is not understood by every adapter):
+static int i2cdev_scan(void *ctx, int *address_book) {
+    struct i2cdev *dev = ctx;
+    struct i2c_msg msg;
+    union i2c_smbus_data byte;
+
+    uint8_t buffer[1];
+
+    int ret;
+    int i;
+
+    for (i = 0; i < 127; i++) {
+        address_book[i] = 0;
+    }
+
+    // 0x00 to 0x07 and 0x78 up are reserved:
+    for (i = 0x08; i < 0x78; i++) {
+        if (dev->funcs & I2C_FUNC_I2C) {
+            msg.addr = i;
+            msg.flags = I2C_M_RD;
+            msg.len = 1;
+            msg.buf = buffer;
+
+            ret = i2cdev_transfer(dev, &msg, 1);
+        } else {
+            ret = i2cdev_smbus(dev, i, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE,
+                               &byte);
+        }
+
+        if (ret == 0) {
+            address_book[i] = 1;
+        } else if (ret != -ENACK) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int i2cdev_delay_us(void *ctx, unsigned int usec) {
+    struct timespec delay;
+
+    delay.tv_sec = usec / 1000000;
+    delay.tv_nsec = (usec % 1000000) * 1000L;
+
+    while (nanosleep(&delay, &delay) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void i2cdev_fill_bus(struct i2cdev *dev, struct ism330dlc_bus *bus) {
+    bus->name = "i2c-dev";
+    bus->read = i2cdev_read;
+    bus->write = i2cdev_write;
+    bus->scan = i2cdev_scan;
+    bus->delay_us = i2cdev_delay_us;
+    bus->ctx = dev;
+}
+
+// clock-frequency of the adapter's device tree node (a big endian cell):
+static unsigned int i2cdev_clock_hz(int adapter) {
+    char path[96];
+    uint8_t cell[4];
+
+    FILE *fpt;
+    size_t num_read;
+
+    snprintf(path, sizeof(path),
+             "/sys/class/i2c-adapter/i2c-%d/of_node/clock-frequency",
+             adapter);
+
+    if ((fpt = fopen(path, "r")) == NULL) {
+        return 0;
+    }
+
+    num_read = fread(cell, 1, sizeof(cell), fpt);
+    fclose(fpt);
+
+    if (num_read != sizeof(cell)) {
+        return 0;
+    }
+
+    return ((unsigned int) cell[0] << 24) | (cell[1] << 16) |
+           (cell[2] << 8) | cell[3];
+}
+
+int i2cdev_open(struct i2cdev *dev, struct ism330dlc_bus *bus, int adapter) {
+    char path[32];
+
+    memset(dev, 0, sizeof(*dev));
+
+    dev->adapter = adapter;
+    dev->slave_addr = -1;
+
+    snprintf(path, sizeof(path), "/dev/i2c-%d", adapter);
+
+    if ((dev->fd = open(path, O_RDWR)) < 0) {
+        perror(path);
+        return -1;
+    }
+
+    if (ioctl(dev->fd, I2C_FUNCS, &dev->funcs) < 0) {
+        perror("I2C_FUNCS");
+        close(dev->fd);
+        return -1;
+    }
+
+    if (!(dev->funcs & (I2C_FUNC_I2C | I2C_FUNC_SMBUS_I2C_BLOCK))) {
+        printf("%s does neither I2C transfers nor SMBus I2C block "
+               "transfers\n", path);
+        close(dev->fd);
+        return -1;
+    }
+
+    dev->clock_hz = i2cdev_clock_hz(adapter);
+
+    i2cdev_fill_bus(dev, bus);
+
+    return 0;
+}
+
+void i2cdev_standin(struct i2cdev *dev, struct ism330dlc_bus *bus,
+                    int (*transfer)(void *ctx, struct i2c_msg *msgs,
+                                    int num_msgs),
+                    void *ctx) {
+    memset(dev, 0, sizeof(*dev));
+
+    dev->adapter = -1;
+    dev->fd = -1;
+    dev->funcs = I2C_FUNC_I2C;
+    dev->slave_addr = -1;
+    dev->transfer = transfer;
+    dev->ctx = ctx;
+
+    i2cdev_fill_bus(dev, bus);
+}
+
+void i2cdev_close(struct i2cdev *dev) {
+    if (dev->fd >= 0) {
+        close(dev->fd);
+    }
+
+    dev->fd = -1;
+}
@@ -0,0 +1,148 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+#include <time.h>   // C Standard date and time manipulation
+
+// Include POSIX and Linux headers:
+#include <errno.h>      // POSIX error numbers
+#include <fcntl.h>      // POSIX file control
+#include <poll.h>       // POSIX poll
+#include <unistd.h>     // POSIX read/close
+#include <sys/ioctl.h>  // ioctl
+#include <linux/gpio.h> // Linux gpiochip character device
+
+// Include user headers:
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_irq.h"       // ISM330DLC interrupt acquisition
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+int route_int1(struct ism330dlc_bus *bus, int device_addr, int *configs,
+               int num_configs) {
+    int config[1];
+    int ret;
+
+    // Pulse data-ready for 75 us instead of latching it until the output
+    // registers are read (page 45):
+    config[0] = DRDY_PULSED_ENABLED;
+
+    if ((ret = configure_device(bus, device_addr, DRDY_PULSE_CFG, config,
+                                1)) < 0) {
+        return ret;
+    }
+
+    return configure_device(bus, device_addr, INT1_CTRL, configs,
+                            num_configs);
+}
+
+static uint64_t irq_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int gpio_irq_wait(void *ctx, int timeout_ms, uint64_t *timestamp_ns) {
+    struct gpio_irq *gpio = ctx;
+    struct gpioevent_data event;
+    struct pollfd pfd;
+
+    uint64_t deadline_ns = irq_now_ns() + (uint64_t) timeout_ms * 1000000;
+    uint64_t now;
+
+    int ret;
+
+    pfd.fd = gpio->event_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    // A signal (SIGUSR1 for the metrics, say) only cuts the wait short, so
+    // wait again for whatever is left of the timeout:
+    while ((ret = poll(&pfd, 1, timeout_ms)) < 0) {
+        if (errno != EINTR) {
+            perror("poll");
+            return -1;
+        }
+
+        if (timeout_ms > 0) {
+            now = irq_now_ns();
+            timeout_ms = deadline_ns > now ?
+                         (deadline_ns - now + 999999) / 1000000 : 0;
+        }
+    }
+
+    if (ret == 0) {
+        return 1;
+    }
+
+    if (read(gpio->event_fd, &event, sizeof(event)) != sizeof(event)) {
+        perror("read");
+        return -1;
+    }
+
+    // Kernel stamps the edge when it happens, not when we get to it:
+    *timestamp_ns = event.timestamp;
+
+    return 0;
+}
+
+int gpio_irq_open(struct gpio_irq *gpio, struct ism330dlc_irq *irq,
+                  const char *chip_path, int line) {
+    struct gpioevent_request request;
+
+    if ((gpio->chip_fd = open(chip_path, O_RDONLY)) < 0) {
+        perror(chip_path);
+        return -1;
+    }
+
+    memset(&request, 0, sizeof(request));
+
+    request.lineoffset = line;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    request.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+    strncpy(request.consumer_label, "ism330dlc_int1",
+            sizeof(request.consumer_label) - 1);
+
+    if (ioctl(gpio->chip_fd, GPIO_GET_LINEEVENT_IOCTL, &request) < 0) {
+        perror("GPIO_GET_LINEEVENT_IOCTL");
+        close(gpio->chip_fd);
+        return -1;
+    }
+
+    gpio->event_fd = request.fd;
+
+    irq->name = "gpiochip";
+    irq->wait = gpio_irq_wait;
+    irq->ctx = gpio;
+
+    return 0;
+}
+
+void gpio_irq_close(struct gpio_irq *gpio) {
+    close(gpio->event_fd);
+    close(gpio->chip_fd);
+}
@@ -0,0 +1,229 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include POSIX headers:
+#include <fcntl.h>     // POSIX file control
+#include <unistd.h>    // POSIX ftruncate/close
+#include <sys/mman.h>  // POSIX memory mapping
+#include <sys/stat.h>  // POSIX file status
+
+// Include user headers:
+#include "ism330dlc_log.h"       // ISM330DLC binary log
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+
+// Grow the file and the mapping to hold at least bytes:
+static int log_grow(struct log_writer *log, size_t bytes) {
+    size_t size = log->mapped;
+
+    while (size < bytes) {
+        size += LOG_CHUNK_BYTES;
+    }
+
+    if (log->map) {
+        munmap(log->map, log->mapped);
+        log->map = NULL;
+    }
+
+    if (ftruncate(log->fd, size) < 0) {
+        perror("ftruncate");
+        return -1;
+    }
+
+    log->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd,
+                    0);
+
+    if (log->map == MAP_FAILED) {
+        perror("mmap");
+        log->map = NULL;
+        return -1;
+    }
+
+    log->mapped = size;
+
+    return 0;
+}
+
+int log_open(struct log_writer *log, const char *path,
+             const struct log_header *info) {
+    struct log_header *header;
+
+    memset(log, 0, sizeof(*log));
+
+    if ((log->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+        perror(path);
+        return -1;
+    }
+
+    if (log_grow(log, LOG_CHUNK_BYTES) < 0) {
+        close(log->fd);
+        return -1;
+    }
+
+    header = (struct log_header *) log->map;
+
+    *header = *info;
+
+    memcpy(header->magic, LOG_MAGIC, sizeof(header->magic));
+    header->version = LOG_VERSION;
+    header->header_size = sizeof(struct log_header);
+    header->record_size = sizeof(struct log_record);
+    header->records = 0;
+
+    return 0;
+}
+
+int log_append(struct log_writer *log, const struct ism330dlc_frame *frames,
+               size_t num_frames) {
+    struct log_record *record;
+    size_t end;
+    size_t i;
+
+    end = sizeof(struct log_header) +
+          (log->records + num_frames) * sizeof(struct log_record);
+
+    if ((end > log->mapped) && (log_grow(log, end) < 0)) {
+        return -1;
+    }
+
+    record = (struct log_record *) (log->map + sizeof(struct log_header)) +
+             log->records;
+
+    for (i = 0; i < num_frames; i++) {
+        record[i].timestamp_ns = frames[i].timestamp_ns;
+        memcpy(record[i].gyro, frames[i].gyro, sizeof(record[i].gyro));
+        memcpy(record[i].accel, frames[i].accel, sizeof(record[i].accel));
+        record[i].temperature = frames[i].temperature;
+        record[i].flags = frames[i].flags;
+        record[i].sensor = frames[i].sensor;
+    }
+
+    log->records += num_frames;
+
+    // Commit the batch once its records are in place:
+    __atomic_store_n(&((struct log_header *) log->map)->records,
+                     log->records, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+int log_close(struct log_writer *log) {
+    size_t size = sizeof(struct log_header) +
+                  log->records * sizeof(struct log_record);
+    int ret = 0;
+
+    if (log->map) {
+        msync(log->map, size, MS_SYNC);
+        munmap(log->map, log->mapped);
+    }
+
+    if (ftruncate(log->fd, size) < 0) {
+        perror("ftruncate");
+        ret = -1;
+    }
+
+    close(log->fd);
+
+    return ret;
+}
+
+int log_map(struct log_view *view, const char *path) {
+    struct stat st;
+    uint64_t capacity;
+    uint64_t n;
+
+    memset(view, 0, sizeof(*view));
+
+    if ((view->fd = open(path, O_RDONLY)) < 0) {
+        perror(path);
+        return -1;
+    }
+
+    if ((fstat(view->fd, &st) < 0) ||
+        (st.st_size < (off_t) sizeof(struct log_header))) {
+        PRINT_ERROR("%s is too short to be a log\n", path);
+        close(view->fd);
+        return -1;
+    }
+
+    view->mapped = st.st_size;
+    view->map = mmap(NULL, view->mapped, PROT_READ, MAP_SHARED, view->fd, 0);
+
+    if (view->map == MAP_FAILED) {
+        perror("mmap");
+        close(view->fd);
+        return -1;
+    }
+
+    view->header = (const struct log_header *) view->map;
+
+    if ((memcmp(view->header->magic, LOG_MAGIC, 8) != 0) ||
+        (view->header->version != LOG_VERSION) ||
+        (view->header->record_size != sizeof(struct log_record))) {
+        PRINT_ERROR("%s is not a version %d log\n", path, LOG_VERSION);
+        log_unmap(view);
+        return -1;
+    }
+
+    // Records start after the header and inside the file:
+    if ((view->header->header_size < sizeof(struct log_header)) ||
+        (view->header->header_size > view->mapped)) {
+        PRINT_ERROR("%s has a corrupt header\n", path);
+        log_unmap(view);
+        return -1;
+    }
+
+    view->records = (const struct log_record *)
+                    (view->map + view->header->header_size);
+
+    capacity = (view->mapped - view->header->header_size) /
+               sizeof(struct log_record);
+
+    n = view->header->records;
+
+    if (n > capacity) {
+        n = capacity;
+    }
+
+    // A crash between writing a batch and committing it leaves records past
+    // the count. The rest of the chunk is zero filled so stop at the first
+    // record without a timestamp or going back in time:
+    while ((n < capacity) && view->records[n].timestamp_ns &&
+           ((n == 0) || (view->records[n].timestamp_ns >=
+                         view->records[n - 1].timestamp_ns))) {
+        n++;
+    }
+
+    view->num_records = n;
+
+    return 0;
+}
+
+void log_unmap(struct log_view *view) {
+    munmap((void *) view->map, view->mapped);
+    close(view->fd);
+}
@@ -0,0 +1,202 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>     // C Standard I/O libary
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library! (error codes)
+
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+
+struct ism330dlc_metrics bus_metrics;
+
+static const char *metrics_op_names[METRIC_OPS] = {
+    "read", "write", "FIFO drain"
+};
+
+static const char *metrics_error_names[METRICS_ERRORS] = {
+    [ENACK] = "ENACK",
+    [EBADXFR] = "EBADXFR",
+    [EBADREGADDR] = "EBADREGADDR",
+    [ECLKTIMEOUT] = "ECLKTIMEOUT",
+    [ENACKRST] = "ENACKRST",
+    [EBUSLOCKUP] = "EBUSLOCKUP",
+    [EBUSUNKERR] = "EBUSUNKERR",
+    [EFAILSTCOND] = "EFAILSTCOND",
+    [EDEVICEHUNG] = "EDEVICEHUNG"
+};
+
+static int metrics_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+
+    while (us && (bucket < METRICS_BUCKETS - 1)) {
+        us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void metrics_hist_record(struct metrics_hist *hist, uint64_t ns) {
+    uint64_t max_ns;
+
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->total_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->buckets[metrics_bucket(ns)], 1,
+                              memory_order_relaxed);
+
+    max_ns = atomic_load_explicit(&hist->max_ns, memory_order_relaxed);
+
+    while ((ns > max_ns) &&
+           !atomic_compare_exchange_weak_explicit(&hist->max_ns, &max_ns, ns,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void metrics_record(int op, uint64_t start_ns, int ret) {
+    struct metrics_hist *hist = &bus_metrics.ops[op];
+
+    metrics_hist_record(hist, metrics_now_ns() - start_ns);
+
+    if (ret < 0) {
+        atomic_fetch_add_explicit(&hist->errors, 1, memory_order_relaxed);
+
+        // Anything that is not a pi_i2c code goes in slot 0:
+        atomic_fetch_add_explicit(&bus_metrics.errors[-ret < METRICS_ERRORS ?
+                                                      -ret : 0], 1,
+                                  memory_order_relaxed);
+    }
+}
+
+void metrics_reset(void) {
+    int op;
+    int i;
+
+    for (op = 0; op < METRIC_OPS; op++) {
+        atomic_store(&bus_metrics.ops[op].count, 0);
+        atomic_store(&bus_metrics.ops[op].errors, 0);
+        atomic_store(&bus_metrics.ops[op].total_ns, 0);
+        atomic_store(&bus_metrics.ops[op].max_ns, 0);
+
+        for (i = 0; i < METRICS_BUCKETS; i++) {
+            atomic_store(&bus_metrics.ops[op].buckets[i], 0);
+        }
+    }
+
+    for (i = 0; i < METRICS_ERRORS; i++) {
+        atomic_store(&bus_metrics.errors[i], 0);
+    }
+
+    atomic_store(&bus_metrics.retries, 0);
+}
+
+unsigned long metrics_hist_percentile(struct metrics_hist *hist,
+                                      double fraction) {
+    unsigned long count = atomic_load(&hist->count);
+    unsigned long seen = 0;
+    int i;
+
+    for (i = 0; i < METRICS_BUCKETS - 1; i++) {
+        seen += atomic_load(&hist->buckets[i]);
+
+        if (seen >= fraction * count) {
+            break;
+        }
+    }
+
+    return 1UL << i;
+}
+
+void metrics_hist_dump(struct metrics_hist *hist, const char *prefix,
+                       FILE *out) {
+    unsigned long bucket;
+
+    int i;
+
+    for (i = 0; i < METRICS_BUCKETS; i++) {
+        if ((bucket = atomic_load(&hist->buckets[i])) == 0) {
+            continue;
+        }
+
+        if (i == 0) {
+            fprintf(out, "%s< 1 us: %lu\n", prefix, bucket);
+        } else if (i == METRICS_BUCKETS - 1) {
+            fprintf(out, "%s>= %lu us: %lu\n", prefix, 1UL << (i - 1),
+                    bucket);
+        } else {
+            fprintf(out, "%s%lu to %lu us: %lu\n", prefix, 1UL << (i - 1),
+                    1UL << i, bucket);
+        }
+    }
+}
+
+void metrics_dump(FILE *out) {
+    struct metrics_hist *hist;
+
+    unsigned long count;
+    unsigned long errors;
+
+    int op;
+    int i;
+
+    fprintf(out, "Bus metrics:\n");
+
+    for (op = 0; op < METRIC_OPS; op++) {
+        hist = &bus_metrics.ops[op];
+
+        if ((count = atomic_load(&hist->count)) == 0) {
+            continue;
+        }
+
+        fprintf(out, "  %s: %lu ops (%lu failed), mean %.1f us, max %.1f us, "
+                "p50 < %lu us, p99 < %lu us\n", metrics_op_names[op], count,
+                atomic_load(&hist->errors),
+                atomic_load(&hist->total_ns) * 1e-3 / count,
+                atomic_load(&hist->max_ns) * 1e-3,
+                metrics_hist_percentile(hist, 0.5),
+                metrics_hist_percentile(hist, 0.99));
+
+        metrics_hist_dump(hist, "    ", out);
+    }
+
+    for (i = 0; i < METRICS_ERRORS; i++) {
+        if ((errors = atomic_load(&bus_metrics.errors[i])) == 0) {
+            continue;
+        }
+
+        if (metrics_error_names[i]) {
+            fprintf(out, "  %s: %lu\n", metrics_error_names[i], errors);
+        } else if (i) {
+            fprintf(out, "  error -%d: %lu\n", i, errors);
+        } else {
+            fprintf(out, "  other errors: %lu\n", errors);
+        }
+    }
+
+    fprintf(out, "  retries: %lu\n", atomic_load(&bus_metrics.retries));
+}
@@ -0,0 +1,125 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <math.h>   // C Standard math
+
+// Include user headers:
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_motion.h"    // ISM330DLC motion triggered acquisition
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Full-scale by FS_XL bits of CTRL1_XL [milli-g] (page 22):
+static const float motion_full_scale_mg[4] = {2000, 16000, 4000, 8000};
+
+// FF_THS code to free-fall threshold [milli-g] (page 83):
+static const float motion_free_fall_mg[8] = {
+    156, 219, 250, 312, 344, 406, 469, 500
+};
+
+static int motion_clamp(int value, int minimum, int maximum) {
+    if (value < minimum) {
+        return minimum;
+    }
+
+    return value > maximum ? maximum : value;
+}
+
+void motion_stage(struct reg_shadow *regs, const struct motion_config *config,
+                  int accel_fs) {
+    float full_scale_mg = motion_full_scale_mg[(apply_config(0, accel_fs) >>
+                                                2) & 0x03];
+
+    int reg_config[3];
+    int wake_threshold;
+    int threshold;
+    int duration;
+
+    // Wake-up on the high-pass filtered data so gravity and slow tilting do
+    // not count, latched until read:
+    reg_config[0] = INTERRUPTS_ENABLE_ENABLED;
+    reg_config[1] = SLOPE_FDS_HIGH_PASS;
+    reg_config[2] = LIR_ENABLED;
+    shadow_stage(regs, TAP_CFG, reg_config, 3);
+
+    // WK_THS is in full-scale/64 steps (page 82):
+    wake_threshold = motion_clamp(lrintf(config->wake_mg * 64 /
+                                         full_scale_mg), 1, 0x3F);
+    reg_config[0] = WK_THS_FIELD | wake_threshold;
+    shadow_stage(regs, WAKE_UP_THS, reg_config, 1);
+
+    duration = motion_clamp(config->wake_samples - 1, 0, 3);
+    reg_config[0] = WAKE_DUR_FIELD | duration;
+
+    // FF_DUR is 6 bits with the top one in WAKE_UP_DUR:
+    duration = motion_clamp(config->free_fall_samples, 1, 0x3F);
+    reg_config[1] = FF_DUR5_FIELD | (duration >> 5);
+    shadow_stage(regs, WAKE_UP_DUR, reg_config, 2);
+
+    for (threshold = 7; threshold > 0; threshold--) {
+        if (motion_free_fall_mg[threshold] <= config->free_fall_mg) {
+            break;
+        }
+    }
+
+    reg_config[0] = FF_THS_FIELD | threshold;
+    reg_config[1] = FF_DUR_FIELD | (duration & 0x1F);
+    shadow_stage(regs, FREE_FALL, reg_config, 2);
+
+    PRINT_INFO("Wake-up over %.1f mg for %d samples, free-fall under %.0f mg "
+               "for %d samples\n", wake_threshold * full_scale_mg / 64,
+               config->wake_samples, motion_free_fall_mg[threshold],
+               duration);
+}
+
+void motion_route(struct reg_shadow *regs, const struct motion_config *config,
+                  int enabled) {
+    int reg_config[2];
+
+    reg_config[0] = enabled ? INT1_WU_ENABLED : INT1_WU_DISABLED;
+    reg_config[1] = (enabled && (config->free_fall_mg > 0)) ?
+                    INT1_FF_ENABLED : INT1_FF_DISABLED;
+    shadow_stage(regs, MD1_CFG, reg_config, 2);
+}
+
+int motion_events(struct ism330dlc_bus *bus, int device_addr) {
+    int reg_value[1];
+    int events = 0;
+    int ret;
+
+    if ((ret = bus_read(bus, device_addr, WAKE_UP_SRC, reg_value, 1)) < 0) {
+        return ret;
+    }
+
+    if (reg_value[0] & WAKE_UP_SRC_WU_IA) {
+        events |= MOTION_WAKE_UP;
+    }
+
+    if (reg_value[0] & WAKE_UP_SRC_FF_IA) {
+        events |= MOTION_FREE_FALL;
+    }
+
+    return events;
+}
@@ -0,0 +1,131 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library! (error codes)
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_recovery.h"  // ISM330DLC bus recovery
+
+void recovery_init(struct bus_recovery *recovery,
+                   const struct retry_policy *policy,
+                   struct ism330dlc_power *power) {
+    struct retry_policy defaults = RETRY_POLICY_DEFAULT;
+
+    recovery->policy = policy->deadline_us ? *policy : defaults;
+    recovery->power = power;
+    recovery->lockups = 0;
+    recovery->misses = 0;
+}
+
+int power_cycle(struct ism330dlc_power *power) {
+    int ret;
+
+    PRINT_WARN("Power cycling through %s\n", power->name);
+
+    ret = power->cycle(power->ctx);
+
+    atomic_fetch_add(&power->generation, 1);
+
+    return ret;
+}
+
+int recovery_failed(struct bus_recovery *recovery, int error) {
+    if ((error != -EBUSLOCKUP) && (error != -EDEVICEHUNG)) {
+        recovery->lockups = 0;
+        return 0;
+    }
+
+    recovery->lockups++;
+
+    if ((recovery->power == NULL) ||
+        (recovery->lockups < recovery->policy.lockups_to_power_cycle)) {
+        return 0;
+    }
+
+    recovery->lockups = 0;
+
+    power_cycle(recovery->power);
+
+    return 1;
+}
+
+int read_deadline(struct ism330dlc_bus *bus, struct bus_recovery *recovery,
+                  int device_addr, int reg_addr, int *data, int num_bytes) {
+    const struct retry_policy *policy = &recovery->policy;
+
+    uint64_t start_ns = metrics_now_ns();
+    uint64_t spent_us;
+
+    unsigned int backoff_us = policy->backoff_us;
+    unsigned int waited_us = 0;
+
+    int ret;
+
+    while ((ret = bus_read(bus, device_addr, reg_addr, data,
+                           num_bytes)) < 0) {
+        i2c_error_handler(ret);
+
+        // A device that was just power cycled has to be set up again first:
+        if (recovery_failed(recovery, ret)) {
+            break;
+        }
+
+        // Count waits too in case the bus runs on a virtual clock:
+        spent_us = (metrics_now_ns() - start_ns) / 1000;
+
+        if (spent_us < waited_us) {
+            spent_us = waited_us;
+        }
+
+        if (spent_us + backoff_us > policy->deadline_us) {
+            break;
+        }
+
+        metrics_retry();
+
+        bus_delay_us(bus, backoff_us);
+        waited_us += backoff_us;
+
+        backoff_us *= 2;
+
+        if (backoff_us > policy->backoff_max_us) {
+            backoff_us = policy->backoff_max_us;
+        }
+    }
+
+    if (ret < 0) {
+        recovery->misses++;
+        return ret;
+    }
+
+    recovery_succeeded(recovery);
+
+    return 0;
+}
@@ -0,0 +1,424 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <stdlib.h> // C Standard library
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+#include <math.h>   // C Standard math
+#include <time.h>   // C Standard date and time manipulation
+
+// Include user headers:
+#include "ism330dlc_replay.h"    // ISM330DLC session replay
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+
+// Longest CSV line (timestamp, sensor, nine axes and the rate change):
+#define REPLAY_LINE 256
+
+// Header names of the values in a CSV line, in replay->columns order:
+static const char *replay_names[REPLAY_NUM_VALUES] = {
+    "Sample Timestamp", "Sensor",
+    "Acceleration X", "Acceleration Y", "Acceleration Z",
+    "Gyroscope X", "Gyroscope Y", "Gyroscope Z",
+    "Magnetic X", "Magnetic Y", "Magnetic Z", "Rate Change"
+};
+
+// Until a header says otherwise the original layout: the timestamp and the
+// six axes of one sensor:
+static const int replay_default_columns[REPLAY_NUM_VALUES] = {
+    0, -1, 1, 2, 3, 4, 5, 6, -1, -1, -1, -1
+};
+
+// Take the column layout from a header line. A header without all the
+// accelerometer and gyroscope axes leaves no layout, so the lines after it
+// are skipped. Magnetometer columns only count if all three are there.
+// Returns 0 if the line is not a header:
+static int replay_csv_header(struct replay *replay, char *line) {
+    int columns[REPLAY_NUM_VALUES];
+
+    char *name;
+    char *end;
+    int column;
+    int i;
+
+    for (i = 0; i < REPLAY_NUM_VALUES; i++) {
+        columns[i] = -1;
+    }
+
+    for (column = 0, name = strtok(line, ","); name != NULL;
+         column++, name = strtok(NULL, ",")) {
+        name += strspn(name, " \t");
+        end = name + strlen(name);
+
+        while ((end > name) && ((end[-1] == ' ') || (end[-1] == '\n') ||
+                                (end[-1] == '\r'))) {
+            *--end = '\0';
+        }
+
+        for (i = 0; i < REPLAY_NUM_VALUES; i++) {
+            if (strcmp(name, replay_names[i]) == 0) {
+                columns[i] = column;
+            }
+        }
+    }
+
+    if (columns[REPLAY_TIME] < 0) {
+        return 0;
+    }
+
+    for (i = REPLAY_ACCEL_X; i <= REPLAY_GYRO_Z; i++) {
+        if (columns[i] < 0) {
+            PRINT_ERROR("CSV header has no %s column, skipping the samples "
+                        "after it\n", replay_names[i]);
+            columns[REPLAY_TIME] = -1;
+            break;
+        }
+    }
+
+    if ((columns[REPLAY_MAG_X] < 0) || (columns[REPLAY_MAG_X + 1] < 0) ||
+        (columns[REPLAY_MAG_Z] < 0)) {
+        for (i = REPLAY_MAG_X; i <= REPLAY_MAG_Z; i++) {
+            columns[i] = -1;
+        }
+    }
+
+    memcpy(replay->columns, columns, sizeof(replay->columns));
+
+    return 1;
+}
+
+int replay_open(struct replay *replay, const char *path, double speed,
+                const struct convert_scale *scales, int num_sensors,
+                float mag_scale) {
+    char magic[sizeof(LOG_MAGIC) - 1] = {0};
+    char line[REPLAY_LINE];
+
+    FILE *file;
+
+    memset(replay, 0, sizeof(*replay));
+
+    replay->speed = speed;
+    replay->scales = scales;
+    replay->num_sensors = num_sensors;
+    replay->mag_scale = mag_scale;
+
+    memcpy(replay->columns, replay_default_columns,
+           sizeof(replay->columns));
+
+    if ((file = fopen(path, "r")) == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    if ((fread(magic, 1, sizeof(magic), file) == sizeof(magic)) &&
+        (memcmp(magic, LOG_MAGIC, sizeof(magic)) == 0)) {
+        fclose(file);
+
+        replay->format = REPLAY_LOG;
+
+        if (log_map(&replay->view, path) < 0) {
+            return -1;
+        }
+
+        PRINT_INFO("Replaying %llu records from %s\n",
+                   (unsigned long long) replay->view.num_records, path);
+
+        return 0;
+    }
+
+    rewind(file);
+
+    replay->format = REPLAY_CSV;
+    replay->csv = file;
+
+    // The header says which columns there are before the first frame:
+    if ((fgets(line, sizeof(line), file) == NULL) ||
+        !replay_csv_header(replay, line)) {
+        rewind(file);
+    }
+
+    PRINT_INFO("Replaying CSV samples from %s\n", path);
+
+    return 0;
+}
+
+// Converted value back to the nearest register value:
+static int16_t replay_raw(double value, float scale) {
+    double raw = value / scale;
+
+    if (raw > INT16_MAX) {
+        return INT16_MAX;
+    } else if (raw < INT16_MIN) {
+        return INT16_MIN;
+    }
+
+    return (int16_t) lround(raw);
+}
+
+// Values of a sample line, where every field is a number. Returns how many
+// or -1 if it is not one:
+static int replay_csv_values(const char *line, double *value) {
+    const char *field = line;
+    char *end;
+
+    int num_values = 0;
+
+    while (num_values < REPLAY_MAX_COLUMNS) {
+        value[num_values++] = strtod(field, &end);
+
+        if (end == field) {
+            return -1;
+        }
+
+        end += strspn(end, " \t\r\n");
+
+        if (*end == '\0') {
+            return num_values;
+        } else if (*end != ',') {
+            return -1;
+        }
+
+        field = end + 1;
+    }
+
+    return -1;
+}
+
+// Next sample line of a CSV file, skipping anything that does not parse or
+// comes from a sensor there is no scale for. The layout comes from the
+// header. Returns 0 at the end of the file:
+static int replay_csv_frame(struct replay *replay,
+                            struct ism330dlc_frame *frame) {
+    const struct convert_scale *scale;
+    const int *columns = replay->columns;
+
+    char line[REPLAY_LINE];
+    double value[REPLAY_MAX_COLUMNS];
+    int num_values;
+    int sensor;
+    int axis;
+    int i;
+
+    while (fgets(line, sizeof(line), replay->csv) != NULL) {
+        if ((num_values = replay_csv_values(line, value)) < 0) {
+            if (!replay_csv_header(replay, line)) {
+                replay->skipped++;
+            }
+
+            continue;
+        }
+
+        // Timestamp, accelerometer and gyroscope are all needed:
+        for (i = REPLAY_TIME; i <= REPLAY_GYRO_Z; i++) {
+            if ((i != REPLAY_SENSOR) &&
+                ((columns[i] < 0) || (columns[i] >= num_values))) {
+                break;
+            }
+        }
+
+        sensor = columns[REPLAY_SENSOR] < 0 ? 0 :
+                 (columns[REPLAY_SENSOR] < num_values ?
+                  (int) value[columns[REPLAY_SENSOR]] : -1);
+
+        if ((i <= REPLAY_GYRO_Z) || (sensor < 0) ||
+            (sensor >= replay->num_sensors)) {
+            replay->skipped++;
+            continue;
+        }
+
+        scale = &replay->scales[sensor];
+
+        memset(frame, 0, sizeof(*frame));
+
+        frame->timestamp_ns = llround(value[columns[REPLAY_TIME]] * 1e9);
+        frame->sensor = sensor;
+        frame->flags = FRAME_GYRO | FRAME_ACCEL;
+
+        for (axis = 0; axis < 3; axis++) {
+            frame->accel[axis] = replay_raw(
+                value[columns[REPLAY_ACCEL_X + axis]], scale->accel);
+            frame->gyro[axis] = replay_raw(
+                value[columns[REPLAY_GYRO_X + axis]], scale->gyro);
+        }
+
+        if ((columns[REPLAY_MAG_X] >= 0) &&
+            (columns[REPLAY_MAG_X] < num_values) &&
+            (columns[REPLAY_MAG_X + 1] < num_values) &&
+            (columns[REPLAY_MAG_Z] < num_values) && replay->mag_scale) {
+            frame->flags |= FRAME_MAG;
+
+            for (axis = 0; axis < 3; axis++) {
+                frame->mag[axis] = replay_raw(
+                    value[columns[REPLAY_MAG_X + axis]], replay->mag_scale);
+            }
+        }
+
+        if ((columns[REPLAY_RATE] >= 0) &&
+            (columns[REPLAY_RATE] < num_values) &&
+            value[columns[REPLAY_RATE]]) {
+            frame->flags |= FRAME_RATE;
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static int replay_log_frame(struct replay *replay,
+                            struct ism330dlc_frame *frame) {
+    const struct log_record *record;
+
+    // Records of a sensor there is no scale for are left out:
+    do {
+        if (replay->next == replay->view.num_records) {
+            return 0;
+        }
+
+        record = &replay->view.records[replay->next++];
+
+        if (record->sensor >= replay->num_sensors) {
+            replay->skipped++;
+        }
+    } while (record->sensor >= replay->num_sensors);
+
+    memset(frame, 0, sizeof(*frame));
+
+    frame->timestamp_ns = record->timestamp_ns;
+    memcpy(frame->gyro, record->gyro, sizeof(frame->gyro));
+    memcpy(frame->accel, record->accel, sizeof(frame->accel));
+    frame->temperature = record->temperature;
+    frame->flags = record->flags;
+    frame->sensor = record->sensor;
+
+    return 1;
+}
+
+// Host time a frame recorded at timestamp_ns is due at the replay speed:
+static uint64_t replay_due_ns(struct replay *replay, uint64_t timestamp_ns) {
+    if (timestamp_ns <= replay->first_ns) {
+        return replay->start_ns;
+    }
+
+    return replay->start_ns +
+           (uint64_t) ((timestamp_ns - replay->first_ns) / replay->speed);
+}
+
+size_t replay_read(struct replay *replay, struct ism330dlc_frame *frames,
+                   size_t max_frames) {
+    struct ism330dlc_frame *frame;
+    struct timespec due;
+
+    uint64_t due_ns;
+    size_t count = 0;
+    int ret;
+
+    while (count < max_frames) {
+        frame = &frames[count];
+
+        // A frame held back by the last call comes first:
+        if (replay->pending) {
+            *frame = replay->held;
+            replay->pending = 0;
+        } else {
+            if (replay->format == REPLAY_LOG) {
+                ret = replay_log_frame(replay, frame);
+            } else {
+                ret = replay_csv_frame(replay, frame);
+            }
+
+            if (ret == 0) {
+                break;
+            }
+
+            if (replay->frames++ == 0) {
+                replay->first_ns = frame->timestamp_ns;
+                replay->start_ns = metrics_now_ns();
+            }
+
+            replay->last_ns = frame->timestamp_ns;
+        }
+
+        if (replay->speed > 0) {
+            due_ns = replay_due_ns(replay, frame->timestamp_ns);
+
+            // Hand over what is already due before waiting on this one:
+            if ((due_ns > metrics_now_ns()) && (count > 0)) {
+                replay->held = *frame;
+                replay->pending = 1;
+                break;
+            } else if (due_ns > metrics_now_ns()) {
+                due.tv_sec = due_ns / 1000000000ULL;
+                due.tv_nsec = due_ns % 1000000000ULL;
+
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+            }
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+int replay_multi_sensor(struct replay *replay) {
+    uint64_t i;
+
+    if (replay->format == REPLAY_CSV) {
+        return replay->columns[REPLAY_SENSOR] >= 0;
+    }
+
+    for (i = 0; i < replay->view.num_records; i++) {
+        if (replay->view.records[i].sensor != 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int replay_rate_changes(struct replay *replay) {
+    uint64_t i;
+
+    if (replay->format == REPLAY_CSV) {
+        return replay->columns[REPLAY_RATE] >= 0;
+    }
+
+    for (i = 0; i < replay->view.num_records; i++) {
+        if (replay->view.records[i].flags & FRAME_RATE) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void replay_close(struct replay *replay) {
+    if (replay->format == REPLAY_LOG) {
+        log_unmap(&replay->view);
+    } else {
+        fclose(replay->csv);
+    }
+}
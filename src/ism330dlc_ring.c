@@ -0,0 +1,106 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdlib.h>    // C Standard library
+#include <string.h>    // C Standard string manipulation
+#include <stdatomic.h> // C Standard atomics
+
+// Include user headers:
+#include "ism330dlc_ring.h"      // ISM330DLC frame ring
+
+int ring_init(struct frame_ring *ring, size_t capacity) {
+    size_t size = 1;
+    size_t bytes;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    // aligned_alloc() wants a multiple of the alignment:
+    bytes = size * sizeof(struct ism330dlc_frame);
+    bytes = (bytes + RING_CACHE_LINE - 1) & ~(size_t) (RING_CACHE_LINE - 1);
+
+    if ((ring->slots = aligned_alloc(RING_CACHE_LINE, bytes)) == NULL) {
+        return -1;
+    }
+
+    // Touch every slot now so the first lap does not page fault:
+    memset(ring->slots, 0, bytes);
+
+    ring->mask = size - 1;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overruns, 0);
+
+    return 0;
+}
+
+void ring_free(struct frame_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+int ring_push(struct frame_ring *ring, const struct ism330dlc_frame *frame) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail > ring->mask) {
+        atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+        return -1;
+    }
+
+    ring->slots[head & ring->mask] = *frame;
+
+    // Publish the slot before moving the head past it:
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return 0;
+}
+
+size_t ring_pop(struct frame_ring *ring, struct ism330dlc_frame *frames,
+                size_t max_frames) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = head - tail;
+    size_t i;
+
+    if (count > max_frames) {
+        count = max_frames;
+    }
+
+    for (i = 0; i < count; i++) {
+        frames[i] = ring->slots[(tail + i) & ring->mask];
+    }
+
+    // Hand the slots back to the producer once they are copied out:
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+
+    return count;
+}
+
+size_t ring_count(struct frame_ring *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire) -
+           atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
@@ -0,0 +1,139 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// pthread_setaffinity_np() and the CPU_* macros:
+#define _GNU_SOURCE
+
+// Include C standard libraries:
+#include <stdio.h>     // C Standard I/O libary
+#include <string.h>    // C Standard string manipulation
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+#include <errno.h>     // C Standard error numbers
+#include <time.h>      // C Standard date and time manipulation
+#include <malloc.h>    // GNU malloc tuning
+
+// Include POSIX headers:
+#include <pthread.h>   // POSIX threads
+#include <sched.h>     // POSIX scheduling
+#include <sys/mman.h>  // POSIX memory locking
+
+// Include user headers:
+#include "ism330dlc_rt.h"        // ISM330DLC real-time acquisition
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+
+int rt_lock_memory(void) {
+    // Freed memory stays with the process and large blocks come out of the
+    // (locked) heap instead of new mappings:
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        perror("mlockall");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Touch a stack's worth of pages so they are there before the first sample:
+static void rt_prefault_stack(void) {
+    volatile unsigned char stack[RT_STACK_PREFAULT_BYTES];
+
+    size_t i;
+
+    for (i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+int rt_enter(const struct rt_config *config) {
+    struct sched_param param = {
+        .sched_priority = config->priority
+    };
+
+    cpu_set_t cpus;
+
+    int ret;
+
+    if (config->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(config->cpu, &cpus);
+
+        if ((ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus),
+                                          &cpus)) != 0) {
+            PRINT_ERROR("Failed to pin to CPU %d: %s\n", config->cpu,
+                        strerror(ret));
+            return -1;
+        }
+    }
+
+    if ((ret = pthread_setschedparam(pthread_self(), SCHED_FIFO,
+                                     &param)) != 0) {
+        PRINT_ERROR("Failed to set SCHED_FIFO priority %d: %s\n",
+                    config->priority, strerror(ret));
+        return -1;
+    }
+
+    rt_prefault_stack();
+
+    return 0;
+}
+
+void rt_sleep_until(uint64_t deadline_ns) {
+    struct timespec deadline = {
+        .tv_sec = deadline_ns / 1000000000ULL,
+        .tv_nsec = deadline_ns % 1000000000ULL
+    };
+
+    // Absolute so a signal in between does not stretch the wait:
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                           NULL) == EINTR) {
+    }
+}
+
+void rt_jitter_record(struct rt_jitter *jitter, uint64_t late_ns) {
+    metrics_hist_record(&jitter->hist, late_ns);
+}
+
+void rt_jitter_dump(struct rt_jitter *jitter, const char *prefix, FILE *out) {
+    struct metrics_hist *hist = &jitter->hist;
+
+    unsigned long count = atomic_load(&hist->count);
+
+    char indent[64];
+
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out, "%sstart jitter mean %.1f us, max %.1f us, p99 < %lu us "
+            "(%lu deadlines skipped)\n", prefix,
+            atomic_load(&hist->total_ns) * 1e-3 / count,
+            atomic_load(&hist->max_ns) * 1e-3,
+            metrics_hist_percentile(hist, 0.99),
+            atomic_load(&jitter->skipped));
+
+    snprintf(indent, sizeof(indent), "%s  ", prefix);
+    metrics_hist_dump(hist, indent, out);
+}
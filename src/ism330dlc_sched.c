@@ -0,0 +1,348 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <time.h>   // C Standard date and time manipulation
+#include <stdint.h> // C Standard integer types
+#include <signal.h> // C Standard signal handling
+
+// Include user headers:
+#include "ism330dlc_sched.h"     // ISM330DLC multi-sensor scheduler
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+
+static uint64_t sched_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void sched_init(struct ism330dlc_sched *sched, long number_of_samples) {
+    memset(sched, 0, sizeof(*sched));
+
+    sched->number_of_samples = number_of_samples;
+    atomic_init(&sched->stop, 0);
+}
+
+int sched_add(struct ism330dlc_sched *sched, struct ism330dlc_sensor *sensor) {
+    struct sched_bus *bus = NULL;
+
+    int i;
+
+    if (sched->num_sensors == SCHED_MAX_SENSORS) {
+        PRINT_ERROR("Can not schedule more than %d sensors\n",
+                    SCHED_MAX_SENSORS);
+        return -1;
+    }
+
+    for (i = 0; i < sched->num_buses; i++) {
+        if (sched->buses[i].bus == sensor->bus) {
+            bus = &sched->buses[i];
+        }
+    }
+
+    if (bus == NULL) {
+        bus = &sched->buses[sched->num_buses++];
+        bus->sched = sched;
+        bus->bus = sensor->bus;
+    }
+
+    bus->sensors[bus->num_sensors++] = sensor;
+    sched->sensors[sched->num_sensors++] = sensor;
+
+    atomic_store(&sensor->done, 0);
+
+    return 0;
+}
+
+// Sensor on the bus that falls due first or NULL once they are all done:
+static struct ism330dlc_sensor *sched_next(struct sched_bus *bus) {
+    struct ism330dlc_sensor *next = NULL;
+    struct ism330dlc_sensor *sensor;
+
+    int i;
+
+    if (atomic_load(&bus->sched->stop)) {
+        return NULL;
+    }
+
+    for (i = 0; i < bus->num_sensors; i++) {
+        sensor = bus->sensors[i];
+
+        if (atomic_load(&sensor->done)) {
+            continue;
+        }
+
+        if ((next == NULL) || (sensor->due_ns < next->due_ns)) {
+            next = sensor;
+        }
+    }
+
+    return next;
+}
+
+static int sched_service(struct sched_bus *bus,
+                         struct ism330dlc_sensor *sensor, uint64_t edge_ns) {
+    long number_of_samples = bus->sched->number_of_samples;
+    long wanted = SENSOR_BATCH_FRAMES;
+
+    int ret;
+
+    if (number_of_samples &&
+        (number_of_samples - sensor->taken < wanted)) {
+        wanted = number_of_samples - sensor->taken;
+    }
+
+    if ((ret = sensor_service(sensor, edge_ns, wanted)) < 0) {
+        bus->status = ret;
+        return ret;
+    }
+
+    if (number_of_samples && (sensor->taken >= number_of_samples)) {
+        atomic_store(&sensor->done, 1);
+    }
+
+    return 0;
+}
+
+// Acquisition thread of one bus. Sensors take turns in the order they fall
+// due. Blocking on the INT1 of the next one due and then picking up the
+// edges the others saw in the meantime keeps every transaction on the bus
+// in this one thread:
+static void *sched_bus_run(void *arg) {
+    struct sched_bus *bus = arg;
+    struct ism330dlc_sensor *sensor;
+    struct ism330dlc_sensor *other;
+
+    uint64_t edge_ns;
+    uint64_t now;
+
+    sigset_t signals;
+
+    int timeout_ms;
+    int pending;
+    int ret;
+    int i;
+
+    // Signals (Ctrl-C, SIGUSR1 for the metrics) go to the thread that started
+    // the scheduler instead of cutting a transfer or INT1 wait short:
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    // Without the privileges for it the thread still keeps to absolute
+    // deadlines:
+    if (bus->sched->rt && (rt_enter(bus->sched->rt) < 0)) {
+        PRINT_WARN("Running %s without real-time scheduling\n",
+                   bus->bus->name);
+    }
+
+    while ((sensor = sched_next(bus)) != NULL) {
+        now = sched_now_ns();
+        edge_ns = 0;
+
+        timeout_ms = sensor->due_ns > now ?
+                     (sensor->due_ns - now + 999999) / 1000000 : 0;
+
+        // No edge to wait for when the FIFO is still at the watermark or the
+        // device has to be set up again:
+        pending = sensor_pending(sensor);
+
+        if (sensor->irq && !pending) {
+            ret = irq_wait(sensor->irq, timeout_ms, &edge_ns);
+
+            if (ret < 0) {
+                PRINT_ERROR("Failed waiting on INT1 of sensor %d\n",
+                            sensor->id);
+                bus->status = ret;
+                break;
+            } else if (ret > 0) {
+                // A watermark edge can be lost to a drain that did not get
+                // the FIFO back under it so drain anyway. Data-ready should
+                // never stop:
+                if (!sensor->config.fifo_streaming) {
+                    PRINT_ERROR("No data-ready on INT1 of sensor %d\n",
+                                sensor->id);
+                    bus->status = -1;
+                    break;
+                }
+
+                // An idle sensor was only due for a clock sync:
+                if (!sensor_idle(sensor)) {
+                    sensor->missed_edges++;
+                }
+
+                edge_ns = 0;
+            }
+        } else if ((timeout_ms > 0) && bus->sched->rt) {
+            rt_sleep_until(sensor->due_ns);
+        } else if (timeout_ms > 0) {
+            bus_delay_us(bus->bus, (sensor->due_ns - now) / 1000);
+        }
+
+        if (sched_service(bus, sensor, edge_ns) < 0) {
+            break;
+        }
+
+        for (i = 0; i < bus->num_sensors; i++) {
+            other = bus->sensors[i];
+
+            if ((other == sensor) || (other->irq == NULL) ||
+                atomic_load(&other->done) ||
+                (irq_wait(other->irq, 0, &edge_ns) != 0)) {
+                continue;
+            }
+
+            if (sched_service(bus, other, edge_ns) < 0) {
+                break;
+            }
+        }
+
+        if (bus->status < 0) {
+            break;
+        }
+    }
+
+    // Let the consumer know nothing more is coming from this bus:
+    for (i = 0; i < bus->num_sensors; i++) {
+        atomic_store(&bus->sensors[i]->done, 1);
+    }
+
+    return NULL;
+}
+
+int sched_start(struct ism330dlc_sched *sched) {
+    int ret;
+    int i;
+
+    for (i = 0; i < sched->num_buses; i++) {
+        PRINT_INFO("Running %d sensor(s) on %s\n", sched->buses[i].num_sensors,
+                   sched->buses[i].bus->name);
+
+        if ((ret = pthread_create(&sched->buses[i].thread, NULL,
+                                  sched_bus_run, &sched->buses[i])) != 0) {
+            PRINT_ERROR("Failed to start the thread for %s\n",
+                        sched->buses[i].bus->name);
+
+            sched_stop(sched);
+            sched->num_buses = i;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void sched_stop(struct ism330dlc_sched *sched) {
+    atomic_store(&sched->stop, 1);
+}
+
+size_t sched_pop(struct ism330dlc_sched *sched, struct ism330dlc_frame *frames,
+                 size_t max_frames) {
+    struct ism330dlc_sensor *sensor;
+    struct sched_source *source;
+    struct sched_source *oldest;
+
+    size_t num_frames = 0;
+
+    int done;
+    int idle;
+    int i;
+
+    while (num_frames < max_frames) {
+        oldest = NULL;
+
+        for (i = 0; i < sched->num_sensors; i++) {
+            sensor = sched->sensors[i];
+            source = &sched->sources[i];
+
+            if (source->next == source->count) {
+                // Check done first so an empty ring after it really is the
+                // end of that sensor:
+                done = atomic_load(&sensor->done);
+                idle = sensor_idle(sensor);
+
+                source->count = ring_pop(&sensor->ring, source->frames,
+                                         SCHED_MERGE_BATCH);
+                source->next = 0;
+
+                if (source->count == 0) {
+                    // Nothing comes from an idle sensor until an event (and
+                    // its pre-trigger history then merges in late):
+                    if (!done && !idle) {
+                        // Can not tell what goes next until it has caught
+                        // up:
+                        return num_frames;
+                    }
+
+                    continue;
+                }
+            }
+
+            if ((oldest == NULL) ||
+                (source->frames[source->next].timestamp_ns <
+                 oldest->frames[oldest->next].timestamp_ns)) {
+                oldest = source;
+            }
+        }
+
+        if (oldest == NULL) {
+            break;
+        }
+
+        frames[num_frames++] = oldest->frames[oldest->next++];
+    }
+
+    return num_frames;
+}
+
+int sched_finished(struct ism330dlc_sched *sched) {
+    int i;
+
+    for (i = 0; i < sched->num_sensors; i++) {
+        if (!atomic_load(&sched->sensors[i]->done) ||
+            (ring_count(&sched->sensors[i]->ring) != 0) ||
+            (sched->sources[i].next != sched->sources[i].count)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int sched_join(struct ism330dlc_sched *sched) {
+    int status = 0;
+    int i;
+
+    for (i = 0; i < sched->num_buses; i++) {
+        pthread_join(sched->buses[i].thread, NULL);
+
+        if ((status == 0) && (sched->buses[i].status < 0)) {
+            status = sched->buses[i].status;
+        }
+    }
+
+    return status;
+}
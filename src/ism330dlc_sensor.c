@@ -0,0 +1,1062 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <time.h>   // C Standard date and time manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library! (error codes)
+
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_calib.h"     // ISM330DLC bias calibration
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_motion.h"    // ISM330DLC motion triggered acquisition
+#include "ism330dlc_recovery.h"  // ISM330DLC bus recovery
+#include "ism330dlc_sensor.h"    // ISM330DLC sensor handle
+#include "ism330dlc_shadow.h"    // ISM330DLC shadow registers
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+static uint64_t sensor_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int sensor_open(struct ism330dlc_sensor *sensor, int id,
+                struct ism330dlc_bus *bus, int device_addr,
+                const struct sensor_config *config) {
+    int reg_config[2];
+    int ret;
+
+    memset(sensor, 0, sizeof(*sensor));
+
+    sensor->id = id;
+    sensor->bus = bus;
+    sensor->device_addr = device_addr;
+    sensor->config = *config;
+
+    recovery_init(&sensor->recovery, &config->retry, NULL);
+    atomic_init(&sensor->idle, 0);
+
+    // The pre-trigger history is the idle FIFO:
+    if (config->motion_trigger && !config->fifo_streaming) {
+        PRINT_ERROR("Motion triggered acquisition needs FIFO streaming\n");
+        return -1;
+    }
+
+    PRINT_INFO("Opening sensor %d at 0x%X on %s\n", id, device_addr, bus->name);
+
+    // There is no bus to scan on SPI, only the device to wait for:
+    if (config->fast_start || bus->spi) {
+        // Ask the device straight away and only scan if it never answers:
+        if ((ret = probe_device(bus, device_addr,
+                                SENSOR_BOOT_TIMEOUT_US)) < 0) {
+            return ret;
+        }
+    } else {
+        // Check to see if the device is present prior to interacting with
+        // device:
+        if ((ret = scan_for_device(bus, device_addr)) < 0) {
+            return ret;
+        }
+
+        // Check to see if the device ID matches what's expected prior to
+        // continuing:
+        if ((ret = verify_device_id(bus, device_addr)) < 0) {
+            return ret;
+        }
+    }
+
+    // Start from the defaults so the shadow knows what the device holds and
+    // the whole configuration goes out in a few bursts with no reads:
+    shadow_init(&sensor->regs, bus, device_addr);
+    sensor->regs.verify = config->verify;
+
+    if ((ret = shadow_reset(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    // Configure common control:
+    // - Block data update so both halves of an axis come from one sample
+    // - Register address auto-increment for burst reads
+    // (FIFO stays in bypass mode until sensor_start())
+    reg_config[0] = BDU_ENABLED; reg_config[1] = IF_INC_ENABLED;
+    shadow_stage(&sensor->regs, CTRL3_C, reg_config, 2);
+
+    // Configure accelerometer and gyroscope sampling rate and full-scale:
+    reg_config[0] = config->accel_odr; reg_config[1] = config->accel_fs;
+    shadow_stage(&sensor->regs, CTRL1_XL, reg_config, 2);
+
+    reg_config[0] = config->gyro_odr; reg_config[1] = config->gyro_fs;
+    shadow_stage(&sensor->regs, CTRL2_G, reg_config, 2);
+
+    // SPI only, so nothing on the wire is taken for an I2C start:
+    if (bus->spi) {
+        reg_config[0] = I2C_DISABLE_ENABLED;
+        shadow_stage(&sensor->regs, CTRL4_C, reg_config, 1);
+    }
+
+    // Gyroscope LPF1 ahead of any decimation on the host:
+    if (config->gyro_lpf1) {
+        reg_config[0] = LPF1_SEL_G_ENABLED;
+        shadow_stage(&sensor->regs, CTRL4_C, reg_config, 1);
+
+        reg_config[0] = config->gyro_lpf1;
+        shadow_stage(&sensor->regs, CTRL6_C, reg_config, 1);
+    }
+
+    // Route data-ready (pulsed so every sample gives its own edge) or the
+    // FIFO watermark when streaming to INT1:
+    if (config->interrupt) {
+        if (config->fifo_streaming) {
+            reg_config[0] = INT1_FTH_ENABLED;
+        } else {
+            reg_config[0] = INT1_DRDY_XL_ENABLED;
+        }
+
+        shadow_stage(&sensor->regs, INT1_CTRL, reg_config, 1);
+
+        reg_config[0] = DRDY_PULSED_ENABLED;
+        shadow_stage(&sensor->regs, DRDY_PULSE_CFG, reg_config, 1);
+    }
+
+    // Timestamp counter at 25 us/LSB (restarted in sensor_start()):
+    if (config->fifo_streaming && fifo_timestamp_enabled(&config->fifo)) {
+        reg_config[0] = TIMER_HR_25_US;
+        shadow_stage(&sensor->regs, WAKE_UP_DUR, reg_config, 1);
+
+        reg_config[0] = TIMER_EN_ENABLED;
+        shadow_stage(&sensor->regs, CTRL10_C, reg_config, 1);
+    }
+
+    // Wake-up and free-fall detection (routed to INT1 only while idle):
+    if (config->motion_trigger) {
+        motion_stage(&sensor->regs, &config->motion, config->accel_fs);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    // The accelerometer is running now so it can drive the sensor hub:
+    if (config->hub.mag_addr &&
+        ((ret = hub_open(&sensor->regs, &config->hub)) < 0)) {
+        return ret;
+    }
+
+    sensor->accel_scale = accel_sensitivity(config->accel_fs);
+    sensor->gyro_scale = gyro_sensitivity(config->gyro_fs);
+
+    return 0;
+}
+
+int sensor_settle(struct ism330dlc_sensor *sensor) {
+    int ret;
+
+    if (sensor->config.fast_start) {
+        if ((ret = settle_device(sensor->bus, sensor->device_addr,
+                                 sensor->config.accel_odr,
+                                 sensor->config.gyro_odr)) < 0) {
+            return ret;
+        }
+    }
+
+    sensor->settled_ns = sensor_now_ns();
+
+    return 0;
+}
+
+// Accelerometer offsets go through the shadow so a power cycled device gets
+// them back with the rest of its configuration:
+static int sensor_write_offsets(struct ism330dlc_sensor *sensor) {
+    int offsets[3];
+    int weight;
+    int ret;
+    int i;
+
+    calib_offset_registers(&sensor->calib, offsets, &weight);
+
+    shadow_stage(&sensor->regs, CTRL6_C, &weight, 1);
+
+    for (i = 0; i < 3; i++) {
+        shadow_set(&sensor->regs, X_OFS_USR + i, offsets[i]);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    calib_offsets_written(&sensor->calib);
+
+    return 0;
+}
+
+int sensor_calibrate(struct ism330dlc_sensor *sensor,
+                     const struct calib_profile *profile) {
+    calib_init(&sensor->calib, sensor->accel_scale, sensor->gyro_scale,
+               profile);
+
+    sensor->calibrating = 1;
+
+    if (sensor->calib.offsets_due) {
+        return sensor_write_offsets(sensor);
+    }
+
+    return 0;
+}
+
+// Update the bias estimate and move the device offsets along with it. A
+// failed write stays due and goes out with the next frames:
+static void sensor_calibrate_frames(struct ism330dlc_sensor *sensor,
+                                    const struct ism330dlc_frame *frames,
+                                    int num_frames) {
+    int ret;
+
+    if (!sensor->calibrating ||
+        !calib_feed(&sensor->calib, frames, num_frames)) {
+        return;
+    }
+
+    if ((ret = sensor_write_offsets(sensor)) < 0) {
+        recovery_failed(&sensor->recovery, ret);
+    }
+}
+
+// An idle sensor waiting on INT1 only has to keep the clock model in step,
+// one without it polls WAKE_UP_SRC for events:
+static uint64_t sensor_idle_period_ns(struct ism330dlc_sensor *sensor) {
+    return sensor->irq ? SENSOR_IDLE_SYNC_NS : SENSOR_POLL_PERIOD_NS;
+}
+
+// Go idle: the gyroscope powered down, the accelerometer alone at the idle
+// ODR into the FIFO (left in continuous mode as the pre-trigger history) and
+// INT1 on wake-up and free-fall instead of the watermark:
+static int sensor_sleep(struct ism330dlc_sensor *sensor) {
+    struct sensor_config *config = &sensor->config;
+    struct fifo_config fifo = config->fifo;
+
+    int reg_config[1];
+    int reg_value[5];
+    int ret;
+    int i;
+
+    fifo.odr = FIFO_ODR_DISABLED | (config->motion.idle_odr & 0x0F);
+    fifo.dec_gyro = DEC_FIFO_GYRO_NOT_IN_FIFO;
+    fifo.dec_accel = DEC_FIFO_XL_NO_DECIMATION;
+    fifo.mode = FIFO_CONTINUOUS_MODE;
+
+    // Empty the FIFO through bypass mode before the data sets change:
+    shadow_set(&sensor->regs, FIFO_CTRL5, FIFO_CTRL5_DEFAULT);
+
+    reg_config[0] = config->motion.idle_odr;
+    shadow_stage(&sensor->regs, CTRL1_XL, reg_config, 1);
+
+    reg_config[0] = GYRO_POWER_DOWN;
+    shadow_stage(&sensor->regs, CTRL2_G, reg_config, 1);
+
+    if (config->interrupt) {
+        reg_config[0] = INT1_FTH_DISABLED;
+        shadow_stage(&sensor->regs, INT1_CTRL, reg_config, 1);
+
+        motion_route(&sensor->regs, &config->motion, 1);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    if ((ret = restart_fifo_stream(&fifo, &sensor->stream)) < 0) {
+        return ret;
+    }
+
+    fifo_registers(&fifo, reg_value);
+
+    for (i = 0; i < 5; i++) {
+        shadow_set(&sensor->regs, FIFO_CTRL1 + i, reg_value[i]);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    // Clear what latched while streaming so INT1 can rise on the next one:
+    if ((ret = motion_events(sensor->bus, sensor->device_addr)) < 0) {
+        return ret;
+    }
+
+    PRINT_INFO("Sensor %d idle at %.1f Hz\n", sensor->id,
+               odr_to_hz(config->motion.idle_odr));
+
+    sensor->fifo_odr = odr_to_hz(fifo.odr);
+    sensor->idle_since_ns = sensor_now_ns();
+    atomic_store(&sensor->idle, 1);
+
+    return 0;
+}
+
+// Time for the FIFO to fill to a watermark [words] with the stream's
+// pattern at the current FIFO ODR:
+static double sensor_watermark_s(struct ism330dlc_sensor *sensor,
+                                 int watermark) {
+    int frames = 0;
+    int i;
+
+    // Every frame of the pattern is a FIFO tick:
+    for (i = 0; i < sensor->stream.pattern_len; i++) {
+        frames += sensor->stream.pattern_last[i];
+    }
+
+    return (double) watermark * frames / sensor->stream.pattern_len /
+           sensor->fifo_odr;
+}
+
+int sensor_start(struct ism330dlc_sensor *sensor, size_t ring_frames) {
+    struct sensor_config *config = &sensor->config;
+
+    int reg_value[5];
+    int ret;
+    int i;
+
+    if (config->fifo_streaming) {
+        sensor->fifo_odr = odr_to_hz(config->fifo.odr);
+
+        // Restart the timestamp counter and anchor the clock model on it:
+        if (fifo_timestamp_enabled(&config->fifo)) {
+            if ((ret = reset_device_timer(sensor->bus,
+                                          sensor->device_addr)) < 0) {
+                return ret;
+            }
+
+            clock_model_init(&sensor->clock, CLOCK_TICK_NS);
+
+            if ((ret = clock_model_sync(&sensor->clock, sensor->bus,
+                                        sensor->device_addr)) < 0) {
+                return ret;
+            }
+        }
+
+        // FIFO_CTRL1 to FIFO_CTRL5 go out in one burst. The FIFO has been
+        // in bypass mode since sensor_open() so it starts out empty:
+        if ((ret = init_fifo_stream(sensor->bus, sensor->device_addr,
+                                    &config->fifo, &sensor->stream)) < 0) {
+            return ret;
+        }
+
+        // A motion triggered sensor starts out idle instead:
+        if (!config->motion_trigger) {
+            fifo_registers(&config->fifo, reg_value);
+
+            for (i = 0; i < 5; i++) {
+                shadow_set(&sensor->regs, FIFO_CTRL1 + i, reg_value[i]);
+            }
+
+            if ((ret = shadow_commit(&sensor->regs)) < 0) {
+                return ret;
+            }
+        }
+
+        sensor->watermark_s = sensor_watermark_s(sensor,
+                                                 config->fifo.watermark);
+    }
+
+    if (config->adaptive) {
+        adapt_init(&sensor->adapt, &config->adapt,
+                   adapt_rate_index(config->accel_odr), sensor_now_ns());
+    }
+
+    if (config->fifo_streaming) {
+        sensor->rate_hz = sensor->fifo_odr;
+    } else if (config->interrupt) {
+        sensor->rate_hz = odr_to_hz(config->accel_odr);
+    } else if (config->period_ns) {
+        sensor->rate_hz = 1e9 / config->period_ns;
+    } else {
+        sensor->rate_hz = 1e9 / SENSOR_POLL_PERIOD_NS;
+    }
+
+    if (ring_init(&sensor->ring, ring_frames) < 0) {
+        PRINT_ERROR("Failed to allocate the ring for sensor %d\n", sensor->id);
+        return -1;
+    }
+
+    sensor->power_generation = power_generation(sensor->recovery.power);
+    sensor->started_ns = sensor_now_ns();
+
+    // The FIFO needs a watermark's worth of samples before the first drain:
+    sensor->due_ns = sensor->started_ns +
+                     (uint64_t) (1e9 * sensor->watermark_s);
+    sensor->deadline_ns = sensor->due_ns;
+
+    if (config->motion_trigger) {
+        if ((ret = sensor_sleep(sensor)) < 0) {
+            return ret;
+        }
+
+        sensor->due_ns = sensor->started_ns + sensor_idle_period_ns(sensor);
+    }
+
+    return 0;
+}
+
+// Switch both sensors, the FIFO and its watermark over to an adapt rate.
+// The FIFO goes through bypass mode on the way so frames from before and
+// after never mix in one drain (the few since the last drain are lost):
+static int sensor_set_rate(struct ism330dlc_sensor *sensor, int rate) {
+    struct sensor_config *config = &sensor->config;
+    struct fifo_config fifo = config->fifo;
+
+    double configured_hz = odr_to_hz(config->fifo.odr);
+
+    int reg_value[5];
+    int ret;
+    int i;
+
+    fifo.odr = adapt_fifo_odr(rate);
+
+    // Scale the watermark with the rate, a whole pattern at least:
+    fifo.watermark = config->fifo.watermark * odr_to_hz(fifo.odr) /
+                     configured_hz;
+
+    if (fifo.watermark < sensor->stream.pattern_len) {
+        fifo.watermark = sensor->stream.pattern_len;
+    }
+
+    shadow_set(&sensor->regs, FIFO_CTRL5, FIFO_CTRL5_DEFAULT);
+    adapt_stage(&sensor->regs, rate);
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    if ((ret = restart_fifo_stream(&fifo, &sensor->stream)) < 0) {
+        return ret;
+    }
+
+    fifo_registers(&fifo, reg_value);
+
+    for (i = 0; i < 5; i++) {
+        shadow_set(&sensor->regs, FIFO_CTRL1 + i, reg_value[i]);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    PRINT_INFO("Sensor %d at %.0f Hz (gyro %.1f dps, accel %.1f mg RMS)\n",
+               sensor->id, odr_to_hz(fifo.odr), sensor->adapt.gyro_dps,
+               sensor->adapt.accel_mg);
+
+    sensor->fifo_odr = odr_to_hz(fifo.odr);
+    sensor->watermark_s = sensor_watermark_s(sensor, fifo.watermark);
+    sensor->rate_changed = 1;
+
+    adapt_switched(&sensor->adapt, rate, sensor_now_ns());
+
+    return 0;
+}
+
+// Let the controller see a drained batch and move the rate if it wants to:
+static void sensor_adapt(struct ism330dlc_sensor *sensor,
+                         const struct ism330dlc_frame *frames,
+                         int num_frames) {
+    int rate;
+    int ret;
+
+    if (sensor_idle(sensor)) {
+        return;
+    }
+
+    rate = adapt_update(&sensor->adapt, frames, num_frames,
+                        sensor->accel_scale, sensor->gyro_scale);
+
+    if ((rate != sensor->adapt.rate) &&
+        ((ret = sensor_set_rate(sensor, rate)) < 0)) {
+        recovery_failed(&sensor->recovery, ret);
+    }
+}
+
+// Drain the FIFO and stamp the frames:
+static int sensor_service_fifo(struct ism330dlc_sensor *sensor,
+                               long max_frames) {
+    struct ism330dlc_frame *frames = sensor->frames;
+
+    uint64_t now;
+
+    int num_frames;
+    int pushed = 0;
+    int ret;
+    int j;
+
+    if (max_frames > SENSOR_BATCH_FRAMES) {
+        max_frames = SENSOR_BATCH_FRAMES;
+    }
+
+    // The FIFO keeps the samples so a failed drain is tried again later:
+    if ((num_frames = drain_fifo(&sensor->stream, frames, max_frames)) < 0) {
+        recovery_failed(&sensor->recovery, num_frames);
+        return 0;
+    }
+
+    recovery_succeeded(&sensor->recovery);
+
+    if (fifo_timestamp_enabled(&sensor->config.fifo)) {
+        // Unwrap the frame timestamps oldest first then line the model up
+        // with the counter as it reads now:
+        for (j = 0; j < num_frames; j++) {
+            sensor->ticks[j] = clock_model_unwrap(&sensor->clock,
+                                                  frames[j].device_time);
+        }
+
+        // Without a new observation the model as it stands still stamps
+        // them:
+        if ((ret = clock_model_sync(&sensor->clock, sensor->bus,
+                                    sensor->device_addr)) < 0) {
+            recovery_failed(&sensor->recovery, ret);
+        }
+
+        for (j = 0; j < num_frames; j++) {
+            frames[j].timestamp_ns = clock_model_host_ns(&sensor->clock,
+                                                         sensor->ticks[j]);
+        }
+    } else {
+        now = sensor_now_ns();
+
+        // Frames came out of the FIFO oldest first one FIFO period apart:
+        for (j = 0; j < num_frames; j++) {
+            frames[j].timestamp_ns = now - (uint64_t)
+                ((num_frames - 1 - j) * 1e9 / sensor->fifo_odr);
+        }
+    }
+
+    for (j = 0; j < num_frames; j++) {
+        // Only the pre-trigger window of what the idle FIFO collected:
+        if (frames[j].timestamp_ns < sensor->window_ns) {
+            continue;
+        }
+
+        frames[j].sensor = sensor->id;
+
+        if (sensor->rate_changed) {
+            frames[j].flags |= FRAME_RATE;
+            sensor->rate_changed = 0;
+        }
+
+        ring_push(&sensor->ring, &frames[j]);
+        pushed++;
+    }
+
+    sensor_calibrate_frames(sensor, frames, num_frames);
+
+    if (sensor->config.adaptive) {
+        sensor_adapt(sensor, frames, num_frames);
+    }
+
+    return pushed;
+}
+
+// Hand out the pre-trigger history from the idle FIFO (stamped at the idle
+// rate), as much of it as max_frames allows:
+static long sensor_drain_history(struct ism330dlc_sensor *sensor,
+                                 long max_frames) {
+    unsigned long drained;
+
+    uint64_t now = sensor_now_ns();
+    uint64_t window_ns = 1e9 * sensor->config.motion.pretrigger_s;
+
+    long taken = 0;
+
+    sensor->window_ns = now > window_ns ? now - window_ns : 0;
+
+    while (taken < max_frames) {
+        drained = sensor->stream.frames;
+        taken += sensor_service_fifo(sensor, max_frames - taken);
+
+        if (sensor->stream.frames - drained < SENSOR_BATCH_FRAMES) {
+            break;
+        }
+    }
+
+    sensor->window_ns = 0;
+
+    return taken;
+}
+
+// Back to streaming: the configured ODRs and FIFO and INT1 on the watermark.
+// The FIFO starts straight away rather than waiting GYRO_TURN_ON_S out so
+// the first gyroscope samples after an event are still settling:
+static int sensor_wake(struct ism330dlc_sensor *sensor) {
+    struct sensor_config *config = &sensor->config;
+
+    int reg_config[1];
+    int reg_value[5];
+    int ret;
+    int i;
+
+    shadow_set(&sensor->regs, FIFO_CTRL5, FIFO_CTRL5_DEFAULT);
+
+    reg_config[0] = config->accel_odr;
+    shadow_stage(&sensor->regs, CTRL1_XL, reg_config, 1);
+
+    reg_config[0] = config->gyro_odr;
+    shadow_stage(&sensor->regs, CTRL2_G, reg_config, 1);
+
+    if (config->interrupt) {
+        reg_config[0] = INT1_FTH_ENABLED;
+        shadow_stage(&sensor->regs, INT1_CTRL, reg_config, 1);
+
+        motion_route(&sensor->regs, &config->motion, 0);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    if ((ret = restart_fifo_stream(&config->fifo, &sensor->stream)) < 0) {
+        return ret;
+    }
+
+    fifo_registers(&config->fifo, reg_value);
+
+    for (i = 0; i < 5; i++) {
+        shadow_set(&sensor->regs, FIFO_CTRL1 + i, reg_value[i]);
+    }
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    PRINT_INFO("Sensor %d woke up\n", sensor->id);
+
+    sensor->fifo_odr = odr_to_hz(config->fifo.odr);
+    sensor->motion_ns = sensor_now_ns();
+    sensor->idle_ns += sensor->motion_ns - sensor->idle_since_ns;
+    atomic_store(&sensor->idle, 0);
+
+    return 0;
+}
+
+// Idle: wake up on an event (INT1 edge or the next poll) with the history
+// from before it, otherwise only keep the clock model in step:
+static int sensor_service_idle(struct ism330dlc_sensor *sensor,
+                               long max_frames) {
+    int events;
+    int ret;
+
+    if ((events = motion_events(sensor->bus, sensor->device_addr)) < 0) {
+        recovery_failed(&sensor->recovery, events);
+        return 0;
+    }
+
+    recovery_succeeded(&sensor->recovery);
+
+    if (sensor->config.motion.free_fall_mg <= 0) {
+        events &= ~MOTION_FREE_FALL;
+    }
+
+    if (events == 0) {
+        if (fifo_timestamp_enabled(&sensor->config.fifo) &&
+            ((ret = clock_model_sync(&sensor->clock, sensor->bus,
+                                     sensor->device_addr)) < 0)) {
+            recovery_failed(&sensor->recovery, ret);
+        }
+
+        return 0;
+    }
+
+    sensor->wakeups++;
+
+    if (events & MOTION_FREE_FALL) {
+        sensor->free_falls++;
+    }
+
+    max_frames = sensor_drain_history(sensor, max_frames);
+
+    // Still idle if it did not take, so the next event tries again:
+    if ((ret = sensor_wake(sensor)) < 0) {
+        recovery_failed(&sensor->recovery, ret);
+    }
+
+    return max_frames;
+}
+
+// Streaming on a trigger: a wake-up latched since the last drain means it is
+// still moving. Returns 1 once it has been still for inactive_s:
+static int sensor_inactive(struct ism330dlc_sensor *sensor) {
+    uint64_t now = sensor_now_ns();
+
+    int events;
+
+    if ((events = motion_events(sensor->bus, sensor->device_addr)) < 0) {
+        recovery_failed(&sensor->recovery, events);
+        return 0;
+    }
+
+    if (events & MOTION_WAKE_UP) {
+        sensor->motion_ns = now;
+        return 0;
+    }
+
+    return now - sensor->motion_ns >
+           (uint64_t) (1e9 * sensor->config.motion.inactive_s);
+}
+
+// Read the output registers once. A sample that can not be read by its
+// deadline is counted missing rather than waited for:
+static int sensor_service_polled(struct ism330dlc_sensor *sensor,
+                                 uint64_t edge_ns) {
+    struct ism330dlc_frame frame;
+
+    int raw_frame_data[14 + HUB_MAG_BYTES];
+    int num_bytes = 14;
+
+    // The sensor hub registers follow the accelerometer ones:
+    if (sensor->config.hub.mag_addr) {
+        num_bytes += HUB_MAG_BYTES;
+    }
+
+    // Get temperature, gyroscope, accelerometer (and magnetometer) data in
+    // one read:
+    if (read_deadline(sensor->bus, &sensor->recovery, sensor->device_addr,
+                      OUT_TEMP_L, raw_frame_data, num_bytes) < 0) {
+        sensor->missing++;
+        return 0;
+    }
+
+    unpack_frame(raw_frame_data, &frame);
+
+    if (sensor->config.hub.mag_addr) {
+        hub_unpack(&raw_frame_data[14], frame.mag);
+        frame.flags |= FRAME_MAG;
+    }
+
+    // Grab the time (the edge time when interrupt driven):
+    frame.timestamp_ns = edge_ns ? edge_ns : sensor_now_ns();
+    frame.sensor = sensor->id;
+
+    ring_push(&sensor->ring, &frame);
+
+    sensor_calibrate_frames(sensor, &frame, 1);
+
+    return 1;
+}
+
+// Read the output registers at the deadline, recording how late the read
+// started, and move the deadline on by a period from where it was rather
+// than from now. Deadlines already gone by are skipped, not caught up on:
+static int sensor_service_periodic(struct ism330dlc_sensor *sensor) {
+    uint64_t period_ns = sensor->config.period_ns;
+    uint64_t now = sensor_now_ns();
+    uint64_t missed;
+
+    int ret;
+
+    // The first read lays the grid down:
+    if (atomic_load(&sensor->jitter.hist.count) == 0) {
+        sensor->deadline_ns = now;
+    }
+
+    rt_jitter_record(&sensor->jitter, now > sensor->deadline_ns ?
+                                      now - sensor->deadline_ns : 0);
+
+    if ((ret = sensor_service_polled(sensor, 0)) > 0) {
+        sensor->taken += ret;
+        sensor->last_ns = sensor_now_ns();
+    }
+
+    sensor->deadline_ns += period_ns;
+
+    if ((now = sensor_now_ns()) > sensor->deadline_ns) {
+        missed = (now - sensor->deadline_ns) / period_ns + 1;
+
+        rt_jitter_skip(&sensor->jitter, missed);
+        sensor->deadline_ns += missed * period_ns;
+    }
+
+    sensor->due_ns = sensor->deadline_ns;
+
+    if (sensor_pending(sensor)) {
+        sensor->due_ns = 0;
+    }
+
+    return ret;
+}
+
+// Set a power cycled device up again: wait for it to boot, write the whole
+// configuration back and let it settle with the FIFO held in bypass mode,
+// then restart the timestamp counter and the FIFO:
+static int sensor_recover(struct ism330dlc_sensor *sensor,
+                          unsigned int generation) {
+    struct sensor_config *config = &sensor->config;
+
+    int fifo_mode = shadow_get(&sensor->regs, FIFO_CTRL5);
+    int ret;
+
+    PRINT_WARN("Sensor %d was power cycled, restoring its configuration\n",
+               sensor->id);
+
+    if ((ret = probe_device(sensor->bus, sensor->device_addr,
+                            SENSOR_BOOT_TIMEOUT_US)) < 0) {
+        return ret;
+    }
+
+    if ((ret = shadow_restore(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    shadow_set(&sensor->regs, FIFO_CTRL5, FIFO_CTRL5_DEFAULT);
+
+    if ((ret = shadow_commit(&sensor->regs)) < 0) {
+        return ret;
+    }
+
+    if (config->fast_start) {
+        if ((ret = settle_device(sensor->bus, sensor->device_addr,
+                                 config->accel_odr, config->gyro_odr)) < 0) {
+            return ret;
+        }
+    }
+
+    if (config->hub.mag_addr &&
+        ((ret = hub_open(&sensor->regs, &config->hub)) < 0)) {
+        return ret;
+    }
+
+    if (config->fifo_streaming) {
+        if (fifo_timestamp_enabled(&config->fifo)) {
+            if ((ret = reset_device_timer(sensor->bus,
+                                          sensor->device_addr)) < 0) {
+                return ret;
+            }
+
+            clock_model_init(&sensor->clock, CLOCK_TICK_NS);
+
+            if ((ret = clock_model_sync(&sensor->clock, sensor->bus,
+                                        sensor->device_addr)) < 0) {
+                return ret;
+            }
+        }
+
+        shadow_set(&sensor->regs, FIFO_CTRL5, fifo_mode);
+
+        if ((ret = shadow_commit(&sensor->regs)) < 0) {
+            return ret;
+        }
+
+        // Line the stream up with the restarted FIFO on the next drain:
+        sensor->stream.synced = 0;
+        sensor->stream.backlog = 0;
+    }
+
+    sensor->power_generation = generation;
+    sensor->recoveries++;
+
+    return 0;
+}
+
+int sensor_service(struct ism330dlc_sensor *sensor, uint64_t edge_ns,
+                   long max_frames) {
+    unsigned int generation = power_generation(sensor->recovery.power);
+
+    uint64_t period_ns;
+
+    int inactive = 0;
+    int ret;
+
+    // The device lost its configuration to a power cycle (maybe one another
+    // sensor on the same power line asked for). Try again after a backoff
+    // if it is not back yet:
+    if (generation != sensor->power_generation) {
+        if (sensor_recover(sensor, generation) < 0) {
+            recovery_failed(&sensor->recovery, -EDEVICEHUNG);
+
+            sensor->due_ns = sensor_now_ns() +
+                1000ULL * sensor->recovery.policy.backoff_max_us;
+
+            return 0;
+        }
+
+        sensor->due_ns = sensor_now_ns() +
+                         (uint64_t) (1e9 * sensor->watermark_s);
+
+        return 0;
+    }
+
+    if (sensor->config.motion_trigger && sensor_idle(sensor)) {
+        ret = sensor_service_idle(sensor, max_frames);
+
+        if (sensor_idle(sensor)) {
+            period_ns = sensor_idle_period_ns(sensor);
+        } else {
+            period_ns = 1e9 * sensor->watermark_s;
+        }
+    } else if (sensor->config.fifo_streaming) {
+        if (sensor->config.motion_trigger) {
+            inactive = sensor_inactive(sensor);
+        }
+
+        ret = sensor_service_fifo(sensor, max_frames);
+
+        // What is left in the FIFO after that drain goes with bypass mode:
+        if (inactive && ((inactive = sensor_sleep(sensor)) < 0)) {
+            recovery_failed(&sensor->recovery, inactive);
+        }
+
+        // With INT1 the next edge should come in a watermark period but
+        // give it two before draining anyway:
+        period_ns = 1e9 * sensor->watermark_s;
+
+        if (sensor->irq) {
+            period_ns *= 2;
+        }
+
+        if (sensor_idle(sensor)) {
+            period_ns = sensor_idle_period_ns(sensor);
+        }
+    } else if (sensor->config.period_ns && !sensor->irq) {
+        return sensor_service_periodic(sensor);
+    } else {
+        ret = sensor_service_polled(sensor, edge_ns);
+
+        if (sensor->irq) {
+            period_ns = SENSOR_INT1_TIMEOUT_MS * 1000000ULL;
+        } else {
+            period_ns = SENSOR_POLL_PERIOD_NS;
+        }
+    }
+
+    if (ret > 0) {
+        sensor->taken += ret;
+        sensor->last_ns = sensor_now_ns();
+    }
+
+    sensor->due_ns = sensor_now_ns() + period_ns;
+
+    if (sensor_pending(sensor)) {
+        sensor->due_ns = 0;
+    }
+
+    return ret;
+}
+
+void sensor_report(struct ism330dlc_sensor *sensor, FILE *out) {
+    const struct sensor_config *config = &sensor->config;
+
+    double elapsed_s = (sensor->last_ns - sensor->started_ns) * 1e-9;
+
+    unsigned long ring_dropped = ring_overruns(&sensor->ring);
+
+    uint64_t idle_ns;
+    uint64_t adapt_ns;
+
+    char prefix[32];
+
+    int i;
+
+    fprintf(out, "Sensor %d: %ld samples at %.1f Hz (configured %.1f Hz)\n",
+            sensor->id, sensor->taken,
+            elapsed_s > 0 ? sensor->taken / elapsed_s : 0, sensor->rate_hz);
+
+    fprintf(out, "Sensor %d: dropped %lu frames (%lu ring overruns, %lu "
+            "FIFO frames, %lu missed reads)\n", sensor->id,
+            ring_dropped + sensor->stream.dropped + sensor->missing,
+            ring_dropped, sensor->stream.dropped, sensor->missing);
+
+    if (sensor->recovery.power) {
+        fprintf(out, "Sensor %d: restored after %lu power cycles\n",
+                sensor->id, sensor->recoveries);
+    }
+
+    if (config->fifo_streaming) {
+        fprintf(out, "Sensor %d: drained %lu frames in %lu bursts "
+                "(%lu overruns)\n", sensor->id, sensor->stream.frames,
+                sensor->stream.bursts, sensor->stream.overruns);
+    }
+
+    if (sensor->irq) {
+        fprintf(out, "Sensor %d: missed %lu INT1 edges\n", sensor->id,
+                sensor->missed_edges);
+    } else if (config->period_ns && !config->fifo_streaming) {
+        snprintf(prefix, sizeof(prefix), "Sensor %d: ", sensor->id);
+        rt_jitter_dump(&sensor->jitter, prefix, out);
+    }
+
+    if (config->motion_trigger) {
+        idle_ns = sensor->idle_ns;
+
+        if (sensor_idle(sensor)) {
+            idle_ns += sensor_now_ns() - sensor->idle_since_ns;
+        }
+
+        fprintf(out, "Sensor %d: woke up %lu times (%lu free-falls), idle "
+                "for %.1f s\n", sensor->id, sensor->wakeups,
+                sensor->free_falls, idle_ns * 1e-9);
+    }
+
+    if (config->adaptive) {
+        fprintf(out, "Sensor %d: %lu rate switches, now at %.0f Hz, time "
+                "at", sensor->id, sensor->adapt.switches,
+                odr_to_hz(adapt_fifo_odr(sensor->adapt.rate)));
+
+        for (i = 0; i < ADAPT_NUM_RATES; i++) {
+            adapt_ns = sensor->adapt.rate_ns[i];
+
+            if (i == sensor->adapt.rate) {
+                adapt_ns += sensor_now_ns() - sensor->adapt.since_ns;
+            }
+
+            if (adapt_ns) {
+                fprintf(out, " %.0f Hz %.1f s",
+                        odr_to_hz(adapt_fifo_odr(i)), adapt_ns * 1e-9);
+            }
+        }
+
+        fputc('\n', out);
+    }
+
+    if (sensor->calibrating) {
+        fprintf(out, "Sensor %d: %lu still and %lu moving calibration "
+                "windows, gyro bias %.1f %.1f %.1f mdps, accel offset %.1f "
+                "%.1f %.1f mg\n", sensor->id, sensor->calib.still,
+                sensor->calib.moving, sensor->calib.profile.gyro_bias[0],
+                sensor->calib.profile.gyro_bias[1],
+                sensor->calib.profile.gyro_bias[2],
+                sensor->calib.applied[0], sensor->calib.applied[1],
+                sensor->calib.applied[2]);
+    }
+
+    if (config->fifo_streaming && fifo_timestamp_enabled(&config->fifo)) {
+        fprintf(out, "Sensor %d: device clock drift %.1f ppm over %lu syncs "
+                "(%lu wraps)\n", sensor->id,
+                clock_model_drift_ppm(&sensor->clock),
+                sensor->clock.observations, sensor->clock.wraps);
+    }
+}
+
+void sensor_close(struct ism330dlc_sensor *sensor) {
+    ring_free(&sensor->ring);
+}
@@ -0,0 +1,281 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+#include "ism330dlc_shadow.h"    // ISM330DLC shadow registers
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Give SW_RESET this long before checking it has cleared [us]
+#define SHADOW_RESET_US 50
+
+// Give up on SW_RESET clearing itself after this long:
+#define SHADOW_RESET_TIMEOUT_US 10000
+
+// Shadowed registers and their defaults (page 38 to 40):
+static const uint8_t shadow_defaults[][2] = {
+    {SENSOR_SYNC_TIME_FRAME, SENSOR_SYNC_TIME_FRAME_DEFAULT},
+    {SENSOR_SYNC_RES_RATIO, SENSOR_SYNC_RES_RATIO_DEFAULT},
+    {FIFO_CTRL1, FIFO_CTRL1_DEFAULT},
+    {FIFO_CTRL2, FIFO_CTRL2_DEFAULT},
+    {FIFO_CTRL3, FIFO_CTRL3_DEFAULT},
+    {FIFO_CTRL4, FIFO_CTRL4_DEFAULT},
+    {FIFO_CTRL5, FIFO_CTRL5_DEFAULT},
+    {DRDY_PULSE_CFG, DRDY_PULSE_CFG_DEFAULT},
+    {INT1_CTRL, INT1_CTRL_DEFAULT},
+    {INT2_CTRL, INT2_CTRL_DEFAULT},
+    {CTRL1_XL, CTRL1_XL_DEFAULT},
+    {CTRL2_G, CTRL2_G_DEFAULT},
+    {CTRL3_C, CTRL3_C_DEFAULT},
+    {CTRL4_C, CTRL4_C_DEFAULT},
+    {CTRL5_C, CTRL5_C_DEFAULT},
+    {CTRL6_C, CTRL6_C_DEFAULT},
+    {CTRL7_G, CTRL7_G_DEFAULT},
+    {CTRL8_XL, CTRL8_XL_DEFAULT},
+    {CTRL9_XL, CTRL9_XL_DEFAULT},
+    {CTRL10_C, CTRL10_C_DEFAULT},
+    {MASTER_CONFIG, MASTER_CONFIG_DEFAULT},
+    {TAP_CFG, TAP_CFG_DEFAULT},
+    {TAP_THS_6D, TAP_THS_6D_DEFAULT},
+    {INT_DUR2, INT_DUR2_DEFAULT},
+    {WAKE_UP_THS, WAKE_UP_THS_DEFAULT},
+    {WAKE_UP_DUR, WAKE_UP_DUR_DEFAULT},
+    {FREE_FALL, FREE_FALL_DEFAULT},
+    {MD1_CFG, MD1_CFG_DEFAULT},
+    {MD2_CFG, MD2_CFG_DEFAULT},
+    {X_OFS_USR, X_OFS_USR_DEFAULT},
+    {Y_OFS_USR, Y_OFS_USR_DEFAULT},
+    {Z_OFS_USR, Z_OFS_USR_DEFAULT}
+};
+
+#define SHADOW_NUM_DEFAULTS \
+    (sizeof(shadow_defaults) / sizeof(shadow_defaults[0]))
+
+static void shadow_seed(struct reg_shadow *shadow) {
+    unsigned int i;
+
+    memset(shadow->shadowed, 0, sizeof(shadow->shadowed));
+
+    for (i = 0; i < SHADOW_NUM_DEFAULTS; i++) {
+        shadow->shadowed[shadow_defaults[i][0]] = 1;
+        shadow->value[shadow_defaults[i][0]] = shadow_defaults[i][1];
+    }
+
+    memcpy(shadow->staged, shadow->value, sizeof(shadow->staged));
+}
+
+void shadow_init(struct reg_shadow *shadow, struct ism330dlc_bus *bus,
+                 int device_addr) {
+    memset(shadow, 0, sizeof(*shadow));
+
+    shadow->bus = bus;
+    shadow->device_addr = device_addr;
+
+    shadow_seed(shadow);
+}
+
+int shadow_reset(struct reg_shadow *shadow) {
+    int reg_value[1];
+
+    unsigned int waited_us = 0;
+
+    int ret;
+
+    reg_value[0] = apply_config(CTRL3_C_DEFAULT, SW_RESET_ENABLED);
+
+    if ((ret = bus_write(shadow->bus, shadow->device_addr, CTRL3_C,
+                         reg_value, 1)) < 0) {
+        i2c_error_handler(ret);
+        return ret;
+    }
+
+    // SW_RESET clears itself once the registers are back at their defaults
+    // (page 56):
+    do {
+        if (waited_us >= SHADOW_RESET_TIMEOUT_US) {
+            PRINT_ERROR("SW_RESET of device 0x%X did not clear\n",
+                        shadow->device_addr);
+            return -1;
+        }
+
+        bus_delay_us(shadow->bus, SHADOW_RESET_US);
+        waited_us += SHADOW_RESET_US;
+
+        if ((ret = bus_read(shadow->bus, shadow->device_addr, CTRL3_C,
+                            reg_value, 1)) < 0) {
+            i2c_error_handler(ret);
+            return ret;
+        }
+    } while (reg_value[0] & 0x01);
+
+    shadow_seed(shadow);
+
+    return 0;
+}
+
+int shadow_restore(struct reg_shadow *shadow) {
+    uint8_t staged[128];
+
+    int ret;
+
+    memcpy(staged, shadow->staged, sizeof(staged));
+
+    if ((ret = shadow_reset(shadow)) < 0) {
+        return ret;
+    }
+
+    memcpy(shadow->staged, staged, sizeof(staged));
+
+    return 0;
+}
+
+void shadow_stage(struct reg_shadow *shadow, int reg_addr, const int *configs,
+                  int num_configs) {
+    int i;
+
+    for (i = 0; i < num_configs; i++) {
+        shadow->staged[reg_addr & 0x7F] =
+            apply_config(shadow->staged[reg_addr & 0x7F], configs[i]);
+    }
+}
+
+void shadow_set(struct reg_shadow *shadow, int reg_addr, int value) {
+    shadow->staged[reg_addr & 0x7F] = value & 0xFF;
+}
+
+int shadow_get(struct reg_shadow *shadow, int reg_addr) {
+    return shadow->staged[reg_addr & 0x7F];
+}
+
+static int shadow_dirty(struct reg_shadow *shadow, int reg_addr) {
+    return shadow->shadowed[reg_addr] &&
+           (shadow->staged[reg_addr] != shadow->value[reg_addr]);
+}
+
+// Write staged registers first to last in one burst (or a byte at a time
+// when IF_INC is off) and read them back if asked to:
+static int shadow_write_run(struct reg_shadow *shadow, int first, int last) {
+    int reg_value[128];
+    int num_bytes = last - first + 1;
+    int burst = shadow->value[CTRL3_C] & 0x04;
+    int mismatch = 0;
+    int ret = 0;
+    int i;
+
+    for (i = 0; i < num_bytes; i++) {
+        reg_value[i] = shadow->staged[first + i];
+    }
+
+    PRINT_DEBUG("Setting registers 0x%X to 0x%X (%d bytes)\n", first, last,
+                num_bytes);
+
+    for (i = 0; i < num_bytes; i += burst ? num_bytes : 1) {
+        if ((ret = bus_write(shadow->bus, shadow->device_addr, first + i,
+                             &reg_value[i], burst ? num_bytes : 1)) < 0) {
+            i2c_error_handler(ret);
+            return ret;
+        }
+
+        shadow->bursts++;
+    }
+
+    shadow->bytes += num_bytes;
+
+    memcpy(&shadow->value[first], &shadow->staged[first], num_bytes);
+
+    if (!shadow->verify) {
+        return 0;
+    }
+
+    // IF_INC may have just been changed by this run:
+    burst = shadow->value[CTRL3_C] & 0x04;
+
+    for (i = 0; i < num_bytes; i += burst ? num_bytes : 1) {
+        if ((ret = bus_read(shadow->bus, shadow->device_addr, first + i,
+                            &reg_value[i], burst ? num_bytes : 1)) < 0) {
+            i2c_error_handler(ret);
+            return ret;
+        }
+    }
+
+    for (i = 0; i < num_bytes; i++) {
+        if (reg_value[i] != shadow->staged[first + i]) {
+            PRINT_ERROR("Register 0x%X reads back 0x%X instead of 0x%X\n",
+                        first + i, reg_value[i], shadow->staged[first + i]);
+
+            shadow->value[first + i] = reg_value[i];
+            mismatch = 1;
+        }
+    }
+
+    if (mismatch) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int shadow_commit(struct reg_shadow *shadow) {
+    int first;
+    int last;
+    int next;
+    int ret;
+
+    for (first = 0; first < 128; first++) {
+        if (!shadow_dirty(shadow, first)) {
+            continue;
+        }
+
+        // Stretch the burst over shadowed registers as long as the next
+        // changed one is close enough:
+        last = first;
+
+        for (next = first + 1; (next < 128) && shadow->shadowed[next] &&
+                               (next - last <= SHADOW_MERGE_GAP + 1); next++) {
+            if (shadow_dirty(shadow, next)) {
+                last = next;
+            }
+        }
+
+        if ((ret = shadow_write_run(shadow, first, last)) < 0) {
+            return ret;
+        }
+
+        first = last;
+    }
+
+    return 0;
+}
+
+int shadow_write(struct reg_shadow *shadow, int reg_addr, const int *configs,
+                 int num_configs) {
+    shadow_stage(shadow, reg_addr, configs, num_configs);
+
+    return shadow_commit(shadow);
+}
@@ -0,0 +1,283 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>     // C Standard I/O libary
+#include <string.h>    // C Standard string manipulation
+#include <stdint.h>    // C Standard integer types
+#include <stdatomic.h> // C Standard atomics
+
+// Include POSIX headers:
+#include <fcntl.h>     // POSIX file control
+#include <unistd.h>    // POSIX ftruncate/close
+#include <sys/mman.h>  // POSIX shared memory
+#include <sys/stat.h>  // POSIX file status
+
+// Include user headers:
+#include "ism330dlc_shm.h"       // ISM330DLC shared memory ring
+#include "ism330dlc_debug.h"     // ISM330DLC debug messages
+
+int shm_publish_open(struct shm_publisher *pub, const char *name,
+                     size_t capacity, const struct shm_header *info) {
+    struct shm_header *header;
+    size_t size = 1;
+
+    memset(pub, 0, sizeof(*pub));
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    snprintf(pub->name, sizeof(pub->name), "%s", name);
+
+    // Start from a new object. Readers still holding one left behind by an
+    // earlier run keep it and see it never move again:
+    shm_unlink(pub->name);
+
+    pub->fd = shm_open(pub->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+
+    if (pub->fd < 0) {
+        perror(pub->name);
+        return -1;
+    }
+
+    pub->mapped = sizeof(struct shm_header) + size * sizeof(struct shm_slot);
+
+    if (ftruncate(pub->fd, pub->mapped) < 0) {
+        perror("ftruncate");
+        goto fail;
+    }
+
+    pub->header = mmap(NULL, pub->mapped, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       pub->fd, 0);
+
+    if (pub->header == MAP_FAILED) {
+        perror("mmap");
+        pub->header = NULL;
+        goto fail;
+    }
+
+    // Touch every slot now so the first lap does not page fault:
+    memset(pub->header, 0, pub->mapped);
+
+    header = pub->header;
+
+    *header = *info;
+
+    memcpy(header->magic, SHM_MAGIC, sizeof(header->magic));
+    header->version = SHM_VERSION;
+    header->header_size = sizeof(struct shm_header);
+    header->slot_size = sizeof(struct shm_slot);
+    header->capacity = size;
+    header->closed = 0;
+
+    atomic_init(&header->head, 0);
+
+    pub->slots = (struct shm_slot *) (header + 1);
+    pub->mask = size - 1;
+
+    PRINT_INFO("Publishing frames to %s (%zu slots)\n", pub->name, size);
+
+    return 0;
+
+fail:
+    close(pub->fd);
+    shm_unlink(pub->name);
+    return -1;
+}
+
+void shm_publish(struct shm_publisher *pub,
+                 const struct ism330dlc_frame *frames, size_t num_frames) {
+    struct shm_slot *slot;
+    size_t i;
+
+    for (i = 0; i < num_frames; i++) {
+        slot = &pub->slots[(pub->head + i) & pub->mask];
+
+        // Readers still on the frame being replaced see it change under them:
+        atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        slot->frame = frames[i];
+
+        atomic_store_explicit(&slot->seq, pub->head + i + 1,
+                              memory_order_release);
+    }
+
+    pub->head += num_frames;
+
+    // One store per batch is all the readers poll on:
+    atomic_store_explicit(&pub->header->head, pub->head,
+                          memory_order_release);
+}
+
+void shm_publish_close(struct shm_publisher *pub) {
+    if (pub->header == NULL) {
+        return;
+    }
+
+    __atomic_store_n(&pub->header->closed, 1, __ATOMIC_RELEASE);
+
+    munmap(pub->header, pub->mapped);
+    close(pub->fd);
+    shm_unlink(pub->name);
+
+    pub->header = NULL;
+}
+
+int shm_reader_open(struct shm_reader *reader, const char *name) {
+    const struct shm_header *header;
+    struct stat st;
+
+    memset(reader, 0, sizeof(*reader));
+
+    if ((reader->fd = shm_open(name, O_RDONLY, 0)) < 0) {
+        perror(name);
+        return -1;
+    }
+
+    if ((fstat(reader->fd, &st) < 0) ||
+        (st.st_size < (off_t) sizeof(struct shm_header))) {
+        PRINT_ERROR("%s is too short to be a frame ring\n", name);
+        close(reader->fd);
+        return -1;
+    }
+
+    reader->mapped = st.st_size;
+    reader->header = mmap(NULL, reader->mapped, PROT_READ, MAP_SHARED,
+                          reader->fd, 0);
+
+    if (reader->header == MAP_FAILED) {
+        perror("mmap");
+        close(reader->fd);
+        return -1;
+    }
+
+    header = reader->header;
+
+    if ((memcmp(header->magic, SHM_MAGIC, 8) != 0) ||
+        (header->version != SHM_VERSION) ||
+        (header->slot_size != sizeof(struct shm_slot))) {
+        PRINT_ERROR("%s is not a version %d frame ring\n", name,
+                    SHM_VERSION);
+        shm_reader_close(reader);
+        return -1;
+    }
+
+    // Slots start after the header, fit the mapping and can be indexed with
+    // a mask:
+    if ((header->header_size < sizeof(struct shm_header)) ||
+        (header->capacity == 0) ||
+        (header->capacity & (header->capacity - 1)) ||
+        (header->header_size + (uint64_t) header->capacity *
+         header->slot_size > reader->mapped)) {
+        PRINT_ERROR("%s has a corrupt header\n", name);
+        shm_reader_close(reader);
+        return -1;
+    }
+
+    reader->slots = (const struct shm_slot *)
+                    ((const uint8_t *) header + header->header_size);
+    reader->mask = header->capacity - 1;
+    reader->next = atomic_load_explicit(&header->head, memory_order_acquire);
+
+    return 0;
+}
+
+void shm_reader_close(struct shm_reader *reader) {
+    munmap((void *) reader->header, reader->mapped);
+    close(reader->fd);
+}
+
+int shm_reader_peek(struct shm_reader *reader,
+                    const struct ism330dlc_frame **frame) {
+    const struct shm_slot *slot;
+    uint64_t head;
+    uint64_t seq;
+
+    while (1) {
+        head = atomic_load_explicit(&reader->header->head,
+                                    memory_order_acquire);
+
+        if (reader->next == head) {
+            return 0;
+        }
+
+        // Lapped: the oldest frames the ring still holds come next:
+        if (head - reader->next > reader->mask + 1) {
+            reader->overruns += head - reader->next - (reader->mask + 1);
+            reader->next = head - (reader->mask + 1);
+        }
+
+        slot = &reader->slots[reader->next & reader->mask];
+        seq = atomic_load_explicit(&slot->seq,
+                                   memory_order_acquire);
+
+        if (seq == reader->next + 1) {
+            *frame = &slot->frame;
+            return 1;
+        }
+
+        // Overwritten since head was read:
+        reader->overruns++;
+        reader->next++;
+    }
+}
+
+int shm_reader_release(struct shm_reader *reader) {
+    const struct shm_slot *slot = &reader->slots[reader->next & reader->mask];
+    uint64_t seq;
+
+    // Everything read from the frame happens before the check:
+    atomic_thread_fence(memory_order_acquire);
+
+    seq = atomic_load_explicit(&slot->seq,
+                               memory_order_relaxed);
+
+    reader->next++;
+
+    if (seq != reader->next) {
+        reader->overruns++;
+        return -1;
+    }
+
+    reader->frames++;
+
+    return 0;
+}
+
+size_t shm_reader_read(struct shm_reader *reader,
+                       struct ism330dlc_frame *frames, size_t max_frames) {
+    const struct ism330dlc_frame *frame;
+    size_t count = 0;
+
+    while ((count < max_frames) && shm_reader_peek(reader, &frame)) {
+        frames[count] = *frame;
+
+        if (shm_reader_release(reader) == 0) {
+            count++;
+        }
+    }
+
+    return count;
+}
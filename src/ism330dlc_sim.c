@@ -0,0 +1,1214 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <string.h> // C Standard string manipulation
+#include <math.h>   // C Standard math
+#include <time.h>   // C Standard date and time manipulation
+#include <stdint.h> // C Standard integer types
+#include <errno.h>  // C Standard error numbers
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library! (error codes)
+
+#include "ism330dlc_sim.h"       // Simulated ISM330DLC
+#include "ism330dlc_hub.h"       // ISM330DLC sensor hub (LIS2MDL registers)
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+#define PI 3.14159265358979
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Synthetic motion: slow sway on X/Y, gravity plus a small vibration on Z
+// and a slow rotation on all three gyroscope axes:
+#define SIM_SWAY_MG 100.0    // [milli-g]
+#define SIM_SWAY_HZ 0.5      // [Hz]
+#define SIM_VIBE_MG 20.0     // [milli-g]
+#define SIM_VIBE_HZ 3.0      // [Hz]
+#define SIM_ROTATE_MDPS 20000.0 // [milli-dps]
+#define SIM_NOISE_LSB 2
+
+// Magnetic field in the device frame, swinging with the sway [milli-gauss]:
+static const double sim_mag_field_mg[3] = {220.0, -50.0, -420.0};
+#define SIM_MAG_SWING_MG 30.0
+
+// LIS2MDL ODR by CFG_REG_A bits 3:2 [Hz]:
+static const double sim_mag_odr[4] = {10, 20, 50, 100};
+
+// Zero-g offset and zero-rate level of the simulated part:
+static const double sim_accel_bias_mg[3] = {25.0, -15.0, 35.0};
+static const double sim_gyro_bias_mdps[3] = {400.0, -250.0, 150.0};
+
+// Gyroscope, accelerometer, sensor hub (3rd) and timestamp (4th) FIFO data
+// sets:
+#define SIM_FIFO_DATA_SETS 4
+
+// Register defaults (page 38 to 40):
+static const uint8_t sim_defaults[][2] = {
+    {FUNC_CFG_ACCESS, FUNC_CFG_ACCESS_DEFAULT},
+    {SENSOR_SYNC_TIME_FRAME, SENSOR_SYNC_TIME_FRAME_DEFAULT},
+    {SENSOR_SYNC_RES_RATIO, SENSOR_SYNC_RES_RATIO_DEFAULT},
+    {FIFO_CTRL1, FIFO_CTRL1_DEFAULT},
+    {FIFO_CTRL2, FIFO_CTRL2_DEFAULT},
+    {FIFO_CTRL3, FIFO_CTRL3_DEFAULT},
+    {FIFO_CTRL4, FIFO_CTRL4_DEFAULT},
+    {FIFO_CTRL5, FIFO_CTRL5_DEFAULT},
+    {DRDY_PULSE_CFG, DRDY_PULSE_CFG_DEFAULT},
+    {INT1_CTRL, INT1_CTRL_DEFAULT},
+    {INT2_CTRL, INT2_CTRL_DEFAULT},
+    {WHO_AM_I, WHO_AM_I_DEFAULT},
+    {CTRL1_XL, CTRL1_XL_DEFAULT},
+    {CTRL2_G, CTRL2_G_DEFAULT},
+    {CTRL3_C, CTRL3_C_DEFAULT},
+    {CTRL4_C, CTRL4_C_DEFAULT},
+    {CTRL5_C, CTRL5_C_DEFAULT},
+    {CTRL6_C, CTRL6_C_DEFAULT},
+    {CTRL7_G, CTRL7_G_DEFAULT},
+    {CTRL8_XL, CTRL8_XL_DEFAULT},
+    {CTRL9_XL, CTRL9_XL_DEFAULT},
+    {CTRL10_C, CTRL10_C_DEFAULT},
+    {MASTER_CONFIG, MASTER_CONFIG_DEFAULT},
+    {TAP_CFG, TAP_CFG_DEFAULT},
+    {TAP_THS_6D, TAP_THS_6D_DEFAULT},
+    {INT_DUR2, INT_DUR2_DEFAULT},
+    {WAKE_UP_THS, WAKE_UP_THS_DEFAULT},
+    {WAKE_UP_DUR, WAKE_UP_DUR_DEFAULT},
+    {FREE_FALL, FREE_FALL_DEFAULT},
+    {MD1_CFG, MD1_CFG_DEFAULT},
+    {MD2_CFG, MD2_CFG_DEFAULT},
+    {MASTER_CMD_CODE, MASTER_CMD_CODE_DEFAULT},
+    {SENS_SYNC_SPI_ERROR_CODE, SENS_SYNC_SPI_ERROR_CODE_DEFAULT},
+    {INT_OIS, INT_OIS_DEFAULT},
+    {CTRL1_OIS, CTRL1_OIS_DEFAULT},
+    {CTRL2_OIS, CTRL2_OIS_DEFAULT},
+    {CTRL3_OIS, CTRL3_OIS_DEFAULT},
+    {X_OFS_USR, X_OFS_USR_DEFAULT},
+    {Y_OFS_USR, Y_OFS_USR_DEFAULT},
+    {Z_OFS_USR, Z_OFS_USR_DEFAULT}
+};
+
+// ODR_XL/ODR_G/ODR_FIFO register codes to Hz (page 51 and 55):
+static const double sim_odr_table[16] = {
+    0, 12.5, 26, 52, 104, 208, 416, 833, 1666, 3332, 6664, 1.6, 0, 0, 0, 0
+};
+
+// Accelerometer FS_XL code to milli-g/LSB (page 22):
+static const double sim_accel_sensitivity[4] = {0.061, 0.488, 0.122, 0.244};
+
+// Full-scale by FS_XL [milli-g] (page 22):
+static const double sim_accel_full_scale[4] = {2000, 16000, 4000, 8000};
+
+// Gyroscope FS_G code to milli-dps/LSB (page 22):
+static const double sim_gyro_sensitivity[4] = {8.75, 17.5, 35.0, 70.0};
+
+// FIFO decimation code to factor (page 53):
+static const int sim_fifo_decimation[8] = {0, 1, 2, 3, 4, 8, 16, 32};
+
+double sim_odr_hz(int odr_code) {
+    return sim_odr_table[odr_code & 0x0F];
+}
+
+static uint64_t sim_monotonic_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+uint64_t sim_time_ns(struct ism330dlc_sim *sim) {
+    if (sim->config.realtime) {
+        return sim_monotonic_ns() - sim->epoch_ns;
+    }
+
+    return sim->virtual_ns;
+}
+
+// Let time pass on the bus either for real or on the virtual clock:
+static void sim_spend_ns(struct ism330dlc_sim *sim, uint64_t ns) {
+    struct timespec delay;
+
+    if (ns == 0) {
+        return;
+    }
+
+    if (sim->config.realtime) {
+        delay.tv_sec = ns / 1000000000ULL;
+        delay.tv_nsec = ns % 1000000000ULL;
+        nanosleep(&delay, NULL);
+    } else {
+        sim->virtual_ns += ns;
+    }
+}
+
+// Small xorshift generator so the noise is repeatable for a given seed:
+static int sim_noise(struct ism330dlc_sim *sim) {
+    sim->noise ^= sim->noise << 13;
+    sim->noise ^= sim->noise >> 17;
+    sim->noise ^= sim->noise << 5;
+
+    return (int) (sim->noise % (2 * SIM_NOISE_LSB + 1)) - SIM_NOISE_LSB;
+}
+
+static int16_t sim_saturate(double value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    } else if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+
+    return (int16_t) lrint(value);
+}
+
+// Motion starts once the device has been still for still_ms, then with
+// move_ms set it keeps taking turns moving for move_ms and lying still:
+static double sim_motion(struct ism330dlc_sim *sim, double t) {
+    double ms = t * 1000.0;
+
+    if (sim->config.move_ms) {
+        ms = fmod(ms, sim->config.still_ms + sim->config.move_ms);
+    }
+
+    return (ms < sim->config.still_ms) ? 0.0 : 1.0;
+}
+
+// Acceleration on top of gravity at time t [milli-g]:
+static void sim_motion_mg(struct ism330dlc_sim *sim, double t, double *mg) {
+    double motion = sim_motion(sim, t);
+
+    mg[0] = motion * SIM_SWAY_MG * sin(2 * PI * SIM_SWAY_HZ * t);
+    mg[1] = motion * SIM_SWAY_MG * cos(2 * PI * SIM_SWAY_HZ * t);
+    mg[2] = motion * SIM_VIBE_MG * sin(2 * PI * SIM_VIBE_HZ * t);
+}
+
+// X/Y/Z_OFS_USR are subtracted from the accelerometer output at 2^-10 or
+// 2^-6 g/LSB (USR_OFF_W):
+static double sim_user_offset(struct ism330dlc_sim *sim, int axis) {
+    double weight = (sim->regs[CTRL6_C] & 0x08) ? 1000.0 / 64 : 1000.0 / 1024;
+
+    return (int8_t) sim->regs[X_OFS_USR + axis] * weight;
+}
+
+static void sim_accel_at(struct ism330dlc_sim *sim, double t, int16_t *raw) {
+    double scale = sim_accel_sensitivity[(sim->regs[CTRL1_XL] >> 2) & 0x03];
+    double mg[3];
+    int i;
+
+    sim_motion_mg(sim, t, mg);
+    mg[2] += 1000.0;
+
+    for (i = 0; i < 3; i++) {
+        raw[i] = sim_saturate((mg[i] + sim_accel_bias_mg[i] -
+                               sim_user_offset(sim, i)) / scale
+                              + sim_noise(sim));
+    }
+}
+
+static void sim_gyro_at(struct ism330dlc_sim *sim, double t, int16_t *raw) {
+    double motion = sim_motion(sim, t);
+    double scale;
+    double mdps[3];
+    int i;
+
+    if (sim->regs[CTRL2_G] & 0x02) {
+        scale = 4.375; // FS_125
+    } else {
+        scale = sim_gyro_sensitivity[(sim->regs[CTRL2_G] >> 2) & 0x03];
+    }
+
+    mdps[0] = motion * SIM_ROTATE_MDPS * sin(2 * PI * SIM_SWAY_HZ * t);
+    mdps[1] = motion * 0.5 * SIM_ROTATE_MDPS * cos(2 * PI * SIM_SWAY_HZ * t);
+    mdps[2] = motion * 0.25 * SIM_ROTATE_MDPS * sin(2 * PI * SIM_VIBE_HZ * t);
+
+    for (i = 0; i < 3; i++) {
+        raw[i] = sim_saturate((mdps[i] + sim_gyro_bias_mdps[i]) / scale
+                              + sim_noise(sim));
+    }
+}
+
+// LIS2MDL output at time t: the field is only sampled at the magnetometer's
+// own ODR and held in between, and nothing comes out of idle mode:
+static int sim_mag_at(struct ism330dlc_sim *sim, double t, int16_t *raw) {
+    double odr = sim_mag_odr[(sim->mag_regs[LIS2MDL_CFG_REG_A] >> 2) & 0x03];
+    double motion;
+    int i;
+
+    if (sim->mag_regs[LIS2MDL_CFG_REG_A] & 0x03) {
+        return -1;
+    }
+
+    t = floor(t * odr) / odr;
+    motion = sim_motion(sim, t);
+
+    for (i = 0; i < 3; i++) {
+        raw[i] = sim_saturate((sim_mag_field_mg[i] + motion *
+                               SIM_MAG_SWING_MG * sin(2 * PI * SIM_SWAY_HZ *
+                                                      t + i)) /
+                              LIS2MDL_SENSITIVITY);
+    }
+
+    return 0;
+}
+
+// Slave 0 of the sensor hub is reading the magnetometer:
+static int sim_hub_reading(struct ism330dlc_sim *sim) {
+    return (sim->regs[CTRL10_C] & 0x04) && (sim->regs[MASTER_CONFIG] & 0x01) &&
+           sim->config.mag_addr &&
+           (sim->embedded[SLV0_ADD] == ((sim->config.mag_addr << 1) |
+                                        SLV0_ADD_READ));
+}
+
+static void sim_store(uint8_t *regs, int reg_addr, const int16_t *raw,
+                      int num_axis) {
+    int i;
+
+    for (i = 0; i < num_axis; i++) {
+        regs[reg_addr + 2 * i] = (uint16_t) raw[i] & 0xFF;
+        regs[reg_addr + 2 * i + 1] = (uint16_t) raw[i] >> 8;
+    }
+}
+
+// Wake-up on the high-pass filtered accelerometer (SLOPE_FDS) taken as an
+// ideal filter, so it sees the motion without gravity or the zero-g offset.
+// Any axis over WK_THS (full-scale/64 steps) sets WAKE_UP_SRC, which holds
+// until read with LIR (page 61). WAKE_DUR and free-fall are not modeled:
+static void sim_wake_up(struct ism330dlc_sim *sim, double t) {
+    double full_scale = sim_accel_full_scale[(sim->regs[CTRL1_XL] >> 2) &
+                                             0x03];
+    double threshold = (sim->regs[WAKE_UP_THS] & 0x3F) * full_scale / 64;
+    double mg[3];
+    int events = 0;
+    int i;
+
+    if (!(sim->regs[TAP_CFG] & 0x80)) {
+        return;
+    }
+
+    sim_motion_mg(sim, t, mg);
+
+    for (i = 0; i < 3; i++) {
+        if (fabs(mg[i]) > threshold) {
+            events |= WAKE_UP_SRC_WU_IA | (WAKE_UP_SRC_X_WU >> i);
+        }
+    }
+
+    if (sim->regs[TAP_CFG] & 0x01) {
+        sim->regs[WAKE_UP_SRC] |= events;
+    } else {
+        sim->regs[WAKE_UP_SRC] = events;
+    }
+}
+
+// Sensor hub cycle on an accelerometer sample: slave 0 reads into
+// SENSORHUB1_REG onwards or writes one byte (page 86). Only the magnetometer
+// at mag_addr answers on the auxiliary bus:
+static void sim_hub_cycle(struct ism330dlc_sim *sim, double t) {
+    int slave = sim->embedded[SLV0_ADD];
+    int reg_addr = sim->embedded[SLV0_SUBADD];
+    int num_bytes = sim->embedded[SLAVE0_CONFIG] & 0x07;
+    int16_t raw[3];
+    int i;
+
+    if (!(sim->regs[CTRL10_C] & 0x04) || !(sim->regs[MASTER_CONFIG] & 0x01)) {
+        return;
+    }
+
+    if (sim->config.mag_addr && ((slave >> 1) == sim->config.mag_addr)) {
+        if (slave & SLV0_ADD_READ) {
+            if (sim_mag_at(sim, t, raw) == 0) {
+                sim_store(sim->mag_regs, LIS2MDL_OUTX_L_REG, raw, 3);
+            }
+
+            for (i = 0; i < num_bytes; i++) {
+                sim->regs[SENSORHUB1_REG + i] =
+                    sim->mag_regs[(reg_addr + i) & 0x7F];
+            }
+        } else {
+            sim->mag_regs[reg_addr & 0x7F] =
+                sim->embedded[DATAWRITE_SRC_MODE_SUB_SLV0];
+        }
+    }
+
+    sim->regs[FUNC_SRC1] |= FUNC_SRC1_SENSORHUB_END_OP;
+}
+
+// Latch the newest sample of each enabled sensor into the output registers:
+static void sim_update_outputs(struct ism330dlc_sim *sim, uint64_t now) {
+    double odr;
+    uint64_t sample;
+    int16_t raw[3];
+
+    odr = sim_odr_hz(sim->regs[CTRL1_XL] >> 4);
+
+    if (odr > 0) {
+        sample = (uint64_t) ((now - sim->xl_start_ns) * 1e-9 * odr);
+
+        if (sample != sim->xl_sample) {
+            sim->xl_sample = sample;
+
+            sim_accel_at(sim, sim->xl_start_ns * 1e-9 + sample / odr,
+                         raw);
+            sim_store(sim->regs, OUTX_L_XL, raw, 3);
+
+            sim_wake_up(sim, sim->xl_start_ns * 1e-9 + sample / odr);
+            sim_hub_cycle(sim, sim->xl_start_ns * 1e-9 + sample / odr);
+
+            // Fixed 25 degC die temperature reads 0 LSB (page 24):
+            raw[0] = 0;
+            sim_store(sim->regs, OUT_TEMP_L, raw, 1);
+
+            sim->regs[STATUS_SPIAux] |= STATUS_XLDA | STATUS_TDA;
+        }
+    }
+
+    odr = sim_odr_hz(sim->regs[CTRL2_G] >> 4);
+
+    if (odr > 0) {
+        sample = (uint64_t) ((now - sim->g_start_ns) * 1e-9 * odr);
+
+        if (sample != sim->g_sample) {
+            sim->g_sample = sample;
+
+            sim_gyro_at(sim, sim->g_start_ns * 1e-9 + sample / odr,
+                        raw);
+            sim_store(sim->regs, OUTX_L_G, raw, 3);
+
+            sim->regs[STATUS_SPIAux] |= STATUS_GDA;
+        }
+    }
+}
+
+// Timestamp counter at time t: 25 us or 6.4 ms per LSB (TIMER_HR) running
+// timer_ppm off from nominal (page 69):
+static uint32_t sim_timer_at(struct ism330dlc_sim *sim, uint64_t t) {
+    double resolution_ns = (sim->regs[WAKE_UP_DUR] & 0x10) ? 25e3 : 6.4e6;
+
+    if (!(sim->regs[CTRL10_C] & 0x20) || (t < sim->timer_start_ns)) {
+        return 0;
+    }
+
+    resolution_ns /= 1.0 + sim->config.timer_ppm * 1e-6;
+
+    return (uint32_t) ((t - sim->timer_start_ns) / resolution_ns) & 0xFFFFFF;
+}
+
+static void sim_fifo_reset(struct ism330dlc_sim *sim) {
+    sim->fifo_head = 0;
+    sim->fifo_count = 0;
+    sim->fifo_out = -1;
+    sim->fifo_overrun = 0;
+    sim->fifo_tick = 0;
+    sim->fifo_removed = 0;
+    sim->fifo_start_ns = sim_time_ns(sim);
+}
+
+static void sim_fifo_push(struct ism330dlc_sim *sim, const int16_t *raw) {
+    int mode = sim->regs[FIFO_CTRL5] & 0x07;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (sim->fifo_count == SIM_FIFO_WORDS) {
+            // FIFO mode stops collecting once full, continuous mode
+            // overwrites the oldest word:
+            sim->fifo_overrun = 1;
+
+            if (mode == 0x01) {
+                return;
+            }
+
+            sim->fifo_head = (sim->fifo_head + 1) % SIM_FIFO_WORDS;
+            sim->fifo_count--;
+            sim->fifo_removed++;
+        }
+
+        sim->fifo[(sim->fifo_head + sim->fifo_count) % SIM_FIFO_WORDS] =
+            (uint16_t) raw[i];
+        sim->fifo_count++;
+    }
+}
+
+// Decimation of the gyroscope, accelerometer, sensor hub (3rd) and timestamp
+// (4th) data sets, 0 for a data set that is not in the FIFO (page 52 and 53):
+static void sim_fifo_decimations(struct ism330dlc_sim *sim, int *dec) {
+    dec[0] = sim_fifo_decimation[(sim->regs[FIFO_CTRL3] >> 3) & 0x07];
+    dec[1] = sim_fifo_decimation[sim->regs[FIFO_CTRL3] & 0x07];
+    dec[2] = sim_fifo_decimation[sim->regs[FIFO_CTRL4] & 0x07];
+    dec[3] = 0;
+
+    if (sim->regs[FIFO_CTRL2] & 0x80) {
+        dec[3] = sim_fifo_decimation[(sim->regs[FIFO_CTRL4] >> 3) & 0x07];
+    }
+}
+
+// Words in one repetition of the FIFO pattern (page 33):
+static int sim_fifo_pattern_words(struct ism330dlc_sim *sim) {
+    int dec[SIM_FIFO_DATA_SETS];
+    int period = 1;
+    int step;
+    int words = 0;
+    int set;
+
+    sim_fifo_decimations(sim, dec);
+
+    // Least common multiple of the decimations:
+    for (set = 0; set < SIM_FIFO_DATA_SETS; set++) {
+        if (dec[set]) {
+            step = period;
+
+            while (period % dec[set]) {
+                period += step;
+            }
+        }
+    }
+
+    for (set = 0; set < SIM_FIFO_DATA_SETS; set++) {
+        if (dec[set]) {
+            words += 3 * (period / dec[set]);
+        }
+    }
+
+    return words;
+}
+
+// Store every FIFO_ODR tick that has elapsed since the last update:
+static void sim_update_fifo(struct ism330dlc_sim *sim, uint64_t now) {
+    int mode = sim->regs[FIFO_CTRL5] & 0x07;
+    int dec[SIM_FIFO_DATA_SETS];
+    double odr = sim_odr_hz(sim->regs[FIFO_CTRL5] >> 3);
+    uint64_t ticks;
+    uint32_t timer;
+    int16_t raw[3];
+    double t;
+
+    sim_fifo_decimations(sim, dec);
+
+    if ((mode == 0x00) || (odr == 0) || (sim_fifo_pattern_words(sim) == 0)) {
+        return;
+    }
+
+    ticks = (uint64_t) ((now - sim->fifo_start_ns) * 1e-9 * odr);
+
+    while (sim->fifo_tick < ticks) {
+        if ((mode == 0x01) && (sim->fifo_count == SIM_FIFO_WORDS)) {
+            sim->fifo_tick = ticks;
+            break;
+        }
+
+        t = sim->fifo_start_ns * 1e-9 + sim->fifo_tick / odr;
+
+        // Gyroscope data set comes first in the pattern (page 33):
+        if (dec[0] && ((sim->fifo_tick % dec[0]) == 0)) {
+            sim_gyro_at(sim, t, raw);
+            sim_fifo_push(sim, raw);
+        }
+
+        if (dec[1] && ((sim->fifo_tick % dec[1]) == 0)) {
+            sim_accel_at(sim, t, raw);
+            sim_fifo_push(sim, raw);
+        }
+
+        // Sensor hub data set: the first 6 bytes slave 0 reads:
+        if (dec[2] && ((sim->fifo_tick % dec[2]) == 0)) {
+            if (!sim_hub_reading(sim) || (sim_mag_at(sim, t, raw) < 0)) {
+                raw[0] = raw[1] = raw[2] = 0;
+            }
+
+            sim_fifo_push(sim, raw);
+        }
+
+        // Timestamp data set: TIMESTAMP[23:8], TIMESTAMP[7:0] in the high
+        // byte, steps:
+        if (dec[3] && ((sim->fifo_tick % dec[3]) == 0)) {
+            timer = sim_timer_at(sim, (uint64_t) (t * 1e9));
+
+            raw[0] = (int16_t) ((timer >> 8) & 0xFFFF);
+            raw[1] = (int16_t) ((timer & 0xFF) << 8);
+            raw[2] = 0;
+
+            sim_fifo_push(sim, raw);
+        }
+
+        sim->fifo_tick++;
+    }
+}
+
+// FIFO watermark in words (page 50):
+static int sim_fifo_threshold(struct ism330dlc_sim *sim) {
+    return sim->regs[FIFO_CTRL1] | ((sim->regs[FIFO_CTRL2] & 0x07) << 8);
+}
+
+static int sim_read_fifo_status(struct ism330dlc_sim *sim, int reg_addr) {
+    int threshold = sim_fifo_threshold(sim);
+    int unread = sim->fifo_count > 0x7FF ? 0x7FF : sim->fifo_count;
+    int pattern_words = sim_fifo_pattern_words(sim);
+    int pattern = 0;
+    int value = 0;
+
+    if (pattern_words) {
+        pattern = sim->fifo_removed % pattern_words;
+    }
+
+    switch (reg_addr) {
+        case FIFO_STATUS1:
+            value = unread & 0xFF;
+            break;
+        case FIFO_STATUS2:
+            value = (unread >> 8) & 0x07;
+
+            if (threshold && (sim->fifo_count >= threshold)) {
+                value |= FIFO_STATUS2_WATERM;
+            }
+
+            if (sim->fifo_overrun) {
+                value |= FIFO_STATUS2_OVER_RUN;
+            }
+
+            if (sim->fifo_count >= SIM_FIFO_WORDS - 3) {
+                value |= FIFO_STATUS2_FIFO_FULL_SMART;
+            }
+
+            if (sim->fifo_count == 0) {
+                value |= FIFO_STATUS2_FIFO_EMPTY;
+            }
+            break;
+        case FIFO_STATUS3:
+            value = pattern & 0xFF;
+            break;
+        case FIFO_STATUS4:
+            value = (pattern >> 8) & 0x03;
+            break;
+    }
+
+    return value;
+}
+
+static int sim_read_byte(struct ism330dlc_sim *sim, int reg_addr) {
+    int value;
+
+    // FUNC_CFG_EN swaps everything but FUNC_CFG_ACCESS for bank A:
+    if ((sim->regs[FUNC_CFG_ACCESS] & 0x80) && (reg_addr != FUNC_CFG_ACCESS)) {
+        return sim->embedded[reg_addr];
+    }
+
+    switch (reg_addr) {
+        case FIFO_STATUS1:
+        case FIFO_STATUS2:
+        case FIFO_STATUS3:
+        case FIFO_STATUS4:
+            return sim_read_fifo_status(sim, reg_addr);
+        case FIFO_DATA_OUT_L:
+            if ((sim->fifo_out < 0) && sim->fifo_count) {
+                sim->fifo_out = sim->fifo[sim->fifo_head];
+                sim->fifo_head = (sim->fifo_head + 1) % SIM_FIFO_WORDS;
+                sim->fifo_count--;
+                sim->fifo_removed++;
+                sim->fifo_overrun = 0;
+
+                // Reading below the watermark drops INT1 so the next
+                // crossing is a new edge:
+                if (sim->fifo_count < sim_fifo_threshold(sim)) {
+                    sim->irq_fth_level = 0;
+                }
+            }
+
+            return sim->fifo_out < 0 ? 0 : sim->fifo_out & 0xFF;
+        case FIFO_DATA_OUT_H:
+            value = sim->fifo_out < 0 ? 0 : sim->fifo_out >> 8;
+            sim->fifo_out = -1;
+
+            return value;
+        case FUNC_SRC1:
+            value = sim->regs[FUNC_SRC1];
+            sim->regs[FUNC_SRC1] = 0;
+
+            return value;
+        case WAKE_UP_SRC:
+            value = sim->regs[WAKE_UP_SRC];
+
+            // Reading clears a latched event and drops INT1 (page 61):
+            if (sim->regs[TAP_CFG] & 0x01) {
+                sim->regs[WAKE_UP_SRC] = 0;
+                sim->irq_wu_level = 0;
+            }
+
+            return value;
+        case TIMESTAMP0_REG:
+            return sim_timer_at(sim, sim->read_ns) & 0xFF;
+        case TIMESTAMP1_REG:
+            return (sim_timer_at(sim, sim->read_ns) >> 8) & 0xFF;
+        case TIMESTAMP2_REG:
+            return (sim_timer_at(sim, sim->read_ns) >> 16) & 0xFF;
+        case OUT_TEMP_H:
+            sim->regs[STATUS_SPIAux] &= ~STATUS_TDA;
+            break;
+        case OUTZ_H_G:
+            sim->regs[STATUS_SPIAux] &= ~STATUS_GDA;
+            break;
+        case OUTZ_H_XL:
+            sim->regs[STATUS_SPIAux] &= ~STATUS_XLDA;
+            break;
+    }
+
+    return sim->regs[reg_addr];
+}
+
+// Registers back to their defaults as on power-on or SW_RESET:
+static void sim_reset_registers(struct ism330dlc_sim *sim) {
+    unsigned int i;
+
+    memset(sim->regs, 0, sizeof(sim->regs));
+    memset(sim->embedded, 0, sizeof(sim->embedded));
+
+    for (i = 0; i < sizeof(sim_defaults) / sizeof(sim_defaults[0]); i++) {
+        sim->regs[sim_defaults[i][0]] = sim_defaults[i][1];
+    }
+
+    sim->xl_start_ns = sim->g_start_ns = sim_time_ns(sim);
+    sim->timer_start_ns = sim->xl_start_ns;
+    sim->xl_sample = sim->g_sample = 0;
+    sim->irq_xl_sample = sim->irq_g_sample = 0;
+    sim->irq_fth_level = 0;
+    sim->irq_wu_level = 0;
+
+    sim->locked_up = 0;
+    sim->pending_count = 0;
+
+    sim_fifo_reset(sim);
+}
+
+static void sim_write_byte(struct ism330dlc_sim *sim, int reg_addr,
+                           int value) {
+    uint8_t previous = sim->regs[reg_addr];
+    uint64_t now = sim_time_ns(sim);
+
+    if ((sim->regs[FUNC_CFG_ACCESS] & 0x80) && (reg_addr != FUNC_CFG_ACCESS)) {
+        sim->embedded[reg_addr] = value & 0xFF;
+        return;
+    }
+
+    // Read only registers:
+    if ((reg_addr == WHO_AM_I) ||
+        ((reg_addr >= WAKE_UP_SRC) && (reg_addr <= OUTZ_H_XL)) ||
+        ((reg_addr >= FIFO_STATUS1) && (reg_addr <= FIFO_DATA_OUT_H))) {
+        return;
+    }
+
+    // Writing AAh to TIMESTAMP2_REG resets the counter (page 69):
+    if (reg_addr == TIMESTAMP2_REG) {
+        if ((value & 0xFF) == TIMESTAMP_RESET) {
+            sim->timer_start_ns = now;
+        }
+
+        return;
+    }
+
+    sim->regs[reg_addr] = value & 0xFF;
+
+    switch (reg_addr) {
+        case CTRL1_XL:
+            if ((previous ^ value) & 0xF0) {
+                sim->xl_start_ns = now;
+                sim->xl_sample = 0;
+            }
+            break;
+        case CTRL2_G:
+            if ((previous ^ value) & 0xF0) {
+                sim->g_start_ns = now;
+                sim->g_sample = 0;
+            }
+            break;
+        case CTRL3_C:
+            // SW_RESET restores the defaults and clears itself (page 56):
+            if (value & 0x01) {
+                sim_reset_registers(sim);
+            }
+            break;
+        case CTRL10_C:
+            if ((previous ^ value) & 0x20) {
+                sim->timer_start_ns = now;
+            }
+            break;
+        case FIFO_CTRL2:
+        case FIFO_CTRL3:
+        case FIFO_CTRL4:
+        case FIFO_CTRL5:
+            // Changing the FIFO mode or data sets restarts the FIFO:
+            if (previous != (value & 0xFF)) {
+                sim_fifo_reset(sim);
+            }
+            break;
+    }
+}
+
+// Common front of every transaction: bus errors and time on the wire:
+static int sim_transaction(struct ism330dlc_sim *sim, int device_addr,
+                           int num_bytes) {
+    int error;
+
+    sim->transactions++;
+
+    sim_spend_ns(sim, sim->config.latency_us * 1000ULL +
+                 (uint64_t) num_bytes * sim->config.byte_ns);
+
+    if (sim->locked_up) {
+        sim->errors++;
+        return -EBUSLOCKUP;
+    }
+
+    if (sim->pending_count > 0) {
+        sim->pending_count--;
+        error = sim->pending_error;
+    } else if (sim->config.error_period &&
+               ((sim->transactions % sim->config.error_period) == 0)) {
+        error = sim->config.error_code;
+    } else {
+        error = 0;
+    }
+
+    if (error == -EBUSLOCKUP) {
+        sim->locked_up = 1;
+    }
+
+    // Nobody answers a device still booting:
+    if (!error && ((device_addr != sim->config.device_addr) ||
+                   (sim_time_ns(sim) < sim->booted_ns))) {
+        error = -ENACK;
+    }
+
+    if (error) {
+        sim->errors++;
+    }
+
+    return error;
+}
+
+// Register address after a byte when IF_INC is set. FIFO_DATA_OUT_H rolls
+// back to FIFO_DATA_OUT_L so the whole FIFO drains in one burst:
+static int sim_next_addr(struct ism330dlc_sim *sim, int reg_addr) {
+    if (!(sim->regs[CTRL3_C] & 0x04)) {
+        return reg_addr;
+    }
+
+    if (reg_addr == FIFO_DATA_OUT_H) {
+        return FIFO_DATA_OUT_L;
+    }
+
+    return (reg_addr + 1) & 0x7F;
+}
+
+// Device on the bus that answers device_addr. Transactions nobody answers
+// go to the first one to be NACKed:
+static struct ism330dlc_sim *sim_select(struct ism330dlc_sim *sim,
+                                        int device_addr) {
+    struct ism330dlc_sim *device;
+
+    for (device = sim; device != NULL; device = device->next) {
+        if (device->config.device_addr == device_addr) {
+            return device;
+        }
+    }
+
+    return sim;
+}
+
+static int sim_read(void *ctx, int device_addr, int reg_addr, int *data,
+                    int num_bytes) {
+    struct ism330dlc_sim *sim = sim_select(ctx, device_addr);
+    uint64_t now;
+    int ret;
+    int i;
+
+    if ((ret = sim_transaction(sim, device_addr, num_bytes)) < 0) {
+        return ret;
+    }
+
+    now = sim_time_ns(sim);
+
+    sim_update_outputs(sim, now);
+    sim_update_fifo(sim, now);
+
+    // Everything in one read sees the same instant:
+    sim->read_ns = now;
+
+    for (i = 0; i < num_bytes; i++) {
+        data[i] = sim_read_byte(sim, reg_addr & 0x7F);
+        reg_addr = sim_next_addr(sim, reg_addr & 0x7F);
+    }
+
+    sim->bytes_read += num_bytes;
+
+    return 0;
+}
+
+static int sim_write(void *ctx, int device_addr, int reg_addr, int *data,
+                     int num_bytes) {
+    struct ism330dlc_sim *sim = sim_select(ctx, device_addr);
+    int ret;
+    int i;
+
+    if ((ret = sim_transaction(sim, device_addr, num_bytes)) < 0) {
+        return ret;
+    }
+
+    sim_update_fifo(sim, sim_time_ns(sim));
+
+    for (i = 0; i < num_bytes; i++) {
+        sim_write_byte(sim, reg_addr & 0x7F, data[i]);
+        reg_addr = sim_next_addr(sim, reg_addr & 0x7F);
+    }
+
+    sim->bytes_written += num_bytes;
+
+    return 0;
+}
+
+static int sim_scan(void *ctx, int *address_book) {
+    struct ism330dlc_sim *sim = ctx;
+    struct ism330dlc_sim *device;
+    int i;
+
+    for (device = sim; device != NULL; device = device->next) {
+        if (device->locked_up) {
+            return -EBUSLOCKUP;
+        }
+    }
+
+    for (i = 0; i < 127; i++) {
+        address_book[i] = 0;
+    }
+
+    // Probing every address costs a transaction each:
+    sim_spend_ns(sim, 127 * (sim->config.latency_us * 1000ULL +
+                             sim->config.byte_ns));
+
+    for (device = sim; device != NULL; device = device->next) {
+        address_book[device->config.device_addr] =
+            sim_time_ns(device) >= device->booted_ns;
+    }
+
+    return 0;
+}
+
+static int sim_delay_us(void *ctx, unsigned int usec) {
+    struct ism330dlc_sim *sim = ctx;
+
+    sim_spend_ns(sim, usec * 1000ULL);
+
+    // Virtual clocks of the other devices on the bus move along with it:
+    if (!sim->config.realtime) {
+        for (sim = sim->next; sim != NULL; sim = sim->next) {
+            sim_spend_ns(sim, usec * 1000ULL);
+        }
+    }
+
+    return 0;
+}
+
+// Let the simulated clock reach t (relative to the epoch):
+static void sim_sleep_until(struct ism330dlc_sim *sim, uint64_t t) {
+    struct timespec deadline;
+
+    if (sim->config.realtime) {
+        deadline.tv_sec = (sim->epoch_ns + t) / 1000000000ULL;
+        deadline.tv_nsec = (sim->epoch_ns + t) % 1000000000ULL;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    } else if (t > sim->virtual_ns) {
+        sim->virtual_ns = t;
+    }
+}
+
+// Time of the tick after number tick of a stream started at start_ns:
+static uint64_t sim_next_tick(uint64_t start_ns, uint64_t tick, double odr) {
+    return start_ns + (uint64_t) ((tick + 1) * 1e9 / odr) + 1;
+}
+
+static int sim_irq_wait(void *ctx, int timeout_ms, uint64_t *timestamp_ns) {
+    struct ism330dlc_sim *sim = ctx;
+
+    uint64_t now = sim_time_ns(sim);
+    uint64_t deadline = now + timeout_ms * 1000000ULL;
+    uint64_t next;
+
+    int threshold;
+    int level;
+    int edge;
+
+    double odr;
+
+    while (1) {
+        now = sim_time_ns(sim);
+
+        sim_update_outputs(sim, now);
+        sim_update_fifo(sim, now);
+
+        edge = 0;
+
+        if ((sim->regs[INT1_CTRL] & 0x01) &&
+            (sim->xl_sample != sim->irq_xl_sample)) {
+            sim->irq_xl_sample = sim->xl_sample;
+            edge = 1;
+        }
+
+        if ((sim->regs[INT1_CTRL] & 0x02) &&
+            (sim->g_sample != sim->irq_g_sample)) {
+            sim->irq_g_sample = sim->g_sample;
+            edge = 1;
+        }
+
+        // Watermark is a level so it only gives an edge going up:
+        threshold = sim_fifo_threshold(sim);
+        level = (sim->regs[INT1_CTRL] & 0x08) && threshold &&
+                (sim->fifo_count >= threshold);
+
+        if (level && !sim->irq_fth_level) {
+            edge = 1;
+        }
+
+        sim->irq_fth_level = level;
+
+        // So is wake-up (MD1_CFG INT1_WU):
+        level = (sim->regs[MD1_CFG] & 0x20) &&
+                (sim->regs[WAKE_UP_SRC] & WAKE_UP_SRC_WU_IA);
+
+        if (level && !sim->irq_wu_level) {
+            edge = 1;
+        }
+
+        sim->irq_wu_level = level;
+
+        if (edge) {
+            *timestamp_ns = now + (sim->config.realtime ? sim->epoch_ns : 0);
+            return 0;
+        }
+
+        if (now >= deadline) {
+            return 1;
+        }
+
+        // Nothing can change before the next sample of any stream:
+        next = deadline;
+
+        odr = sim_odr_hz(sim->regs[CTRL1_XL] >> 4);
+
+        if (((sim->regs[INT1_CTRL] & 0x01) || (sim->regs[MD1_CFG] & 0x20)) &&
+            (odr > 0)) {
+            next = MIN(next, sim_next_tick(sim->xl_start_ns, sim->xl_sample,
+                                           odr));
+        }
+
+        odr = sim_odr_hz(sim->regs[CTRL2_G] >> 4);
+
+        if ((sim->regs[INT1_CTRL] & 0x02) && (odr > 0)) {
+            next = MIN(next, sim_next_tick(sim->g_start_ns, sim->g_sample,
+                                           odr));
+        }
+
+        odr = sim_odr_hz(sim->regs[FIFO_CTRL5] >> 3);
+
+        if ((sim->regs[INT1_CTRL] & 0x08) && (odr > 0)) {
+            next = MIN(next, sim_next_tick(sim->fifo_start_ns,
+                                           sim->fifo_tick, odr));
+        }
+
+        sim_sleep_until(sim, next);
+    }
+}
+
+void sim_irq(struct ism330dlc_sim *sim, struct ism330dlc_irq *irq) {
+    irq->name = "sim";
+    irq->wait = sim_irq_wait;
+    irq->ctx = sim;
+}
+
+void sim_power_cycle(struct ism330dlc_sim *sim) {
+    sim_reset_registers(sim);
+
+    // The magnetometer shares the power line and boots in idle mode:
+    memset(sim->mag_regs, 0, sizeof(sim->mag_regs));
+    sim->mag_regs[LIS2MDL_WHO_AM_I] = LIS2MDL_ID;
+    sim->mag_regs[LIS2MDL_CFG_REG_A] = 0x03;
+
+    sim->booted_ns = sim_time_ns(sim) + sim->config.boot_us * 1000ULL;
+}
+
+static int sim_power_switch(void *ctx) {
+    sim_power_cycle(ctx);
+
+    return 0;
+}
+
+void sim_power(struct ism330dlc_sim *sim, struct ism330dlc_power *power) {
+    power->name = "sim";
+    power->cycle = sim_power_switch;
+    power->ctx = sim;
+    atomic_init(&power->generation, 0);
+}
+
+void sim_inject_error(struct ism330dlc_sim *sim, int error, int count) {
+    sim->pending_error = error;
+    sim->pending_count = count;
+}
+
+void sim_init(struct ism330dlc_sim *sim,
+              const struct ism330dlc_sim_config *config) {
+    memset(sim, 0, sizeof(*sim));
+
+    sim->config = *config;
+
+    if (sim->config.device_addr == 0) {
+        sim->config.device_addr = 0x6A;
+    }
+
+    sim->epoch_ns = sim_monotonic_ns();
+    sim->noise = config->seed ? config->seed : 0x2545F491;
+
+    sim_power_cycle(sim);
+}
+
+void sim_share_bus(struct ism330dlc_sim *sim, struct ism330dlc_sim *other) {
+    while (sim->next != NULL) {
+        sim = sim->next;
+    }
+
+    sim->next = other;
+}
+
+void sim_bus(struct ism330dlc_sim *sim, struct ism330dlc_bus *bus) {
+    bus->name = "sim";
+    bus->read = sim_read;
+    bus->write = sim_write;
+    bus->scan = sim_scan;
+    bus->delay_us = sim_delay_us;
+    bus->ctx = sim;
+}
+
+// pi_i2c error codes back to what an adapter driver would say:
+static int sim_errno(int error) {
+    switch (error) {
+        case -ENACK:
+            return -EREMOTEIO;
+        case -EBUSLOCKUP:
+            return -ETIMEDOUT;
+        default:
+            return -EIO;
+    }
+}
+
+int sim_i2c_transfer(void *ctx, struct i2c_msg *msgs, int num_msgs) {
+    struct ism330dlc_sim *sim = ctx;
+    struct ism330dlc_sim *device;
+
+    int data[SIM_XFER_MAX_BYTES];
+
+    int ret;
+    int i;
+
+    // Register address, repeated start and a read:
+    if ((num_msgs == 2) && (msgs[0].len == 1) &&
+        !(msgs[0].flags & I2C_M_RD) && (msgs[1].flags & I2C_M_RD) &&
+        (msgs[0].addr == msgs[1].addr) &&
+        (msgs[1].len <= SIM_XFER_MAX_BYTES)) {
+        if ((ret = sim_read(sim, msgs[0].addr, msgs[0].buf[0], data,
+                            msgs[1].len)) < 0) {
+            return sim_errno(ret);
+        }
+
+        for (i = 0; i < msgs[1].len; i++) {
+            msgs[1].buf[i] = data[i];
+        }
+
+        return 0;
+    }
+
+    if ((num_msgs != 1) || (msgs[0].len > SIM_XFER_MAX_BYTES)) {
+        return -EOPNOTSUPP;
+    }
+
+    // A read with no register address (a scan) only finds out whether
+    // anyone answers:
+    if (msgs[0].flags & I2C_M_RD) {
+        device = sim_select(sim, msgs[0].addr);
+
+        if ((ret = sim_transaction(device, msgs[0].addr, msgs[0].len)) < 0) {
+            return sim_errno(ret);
+        }
+
+        memset(msgs[0].buf, 0xFF, msgs[0].len);
+
+        return 0;
+    }
+
+    // Register address then data:
+    if (msgs[0].len < 2) {
+        return -EOPNOTSUPP;
+    }
+
+    for (i = 1; i < msgs[0].len; i++) {
+        data[i - 1] = msgs[0].buf[i];
+    }
+
+    if ((ret = sim_write(sim, msgs[0].addr, msgs[0].buf[0], data,
+                         msgs[0].len - 1)) < 0) {
+        return sim_errno(ret);
+    }
+
+    return 0;
+}
+
+int sim_spi_transfer(void *ctx, const uint8_t *tx, uint8_t *rx, int len) {
+    struct ism330dlc_sim *sim = ctx;
+
+    int data[SIM_XFER_MAX_BYTES];
+
+    int ret;
+    int i;
+
+    if ((len < 2) || (len > SIM_XFER_MAX_BYTES)) {
+        return -EMSGSIZE;
+    }
+
+    // Bit 7 of the address byte reads:
+    if (tx[0] & 0x80) {
+        ret = sim_read(sim, sim->config.device_addr, tx[0] & 0x7F, data,
+                       len - 1);
+
+        rx[0] = 0;
+
+        for (i = 1; i < len; i++) {
+            rx[i] = ret < 0 ? 0 : data[i - 1];
+        }
+    } else {
+        for (i = 1; i < len; i++) {
+            data[i - 1] = tx[i];
+        }
+
+        ret = sim_write(sim, sim->config.device_addr, tx[0], data, len - 1);
+    }
+
+    // A booting device just leaves MISO low:
+    if ((ret < 0) && (ret != -ENACK)) {
+        return -EIO;
+    }
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <string.h> // C Standard string manipulation
+#include <errno.h>  // C Standard error numbers
+#include <time.h>   // C Standard date and time manipulation
+#include <stdint.h> // C Standard integer types
+
+// Include POSIX and Linux headers:
+#include <fcntl.h>              // POSIX file control
+#include <unistd.h>             // POSIX read/close
+#include <sys/ioctl.h>          // ioctl
+#include <linux/spi/spidev.h>   // Linux SPI character device
+
+// Include user headers:
+#include <pi_i2c.h>              // Pi I2C library! (error codes)
+
+#include "ism330dlc_spidev.h"    // ISM330DLC Linux spidev bus
+
+static int spidev_transfer(struct spidev *dev, const uint8_t *tx,
+                           uint8_t *rx, int len) {
+    struct spi_ioc_transfer xfer;
+
+    int ret;
+
+    dev->transfers++;
+
+    if (dev->transfer != NULL) {
+        ret = dev->transfer(dev->ctx, tx, rx, len);
+    } else {
+        memset(&xfer, 0, sizeof(xfer));
+
+        xfer.tx_buf = (unsigned long) tx;
+        xfer.rx_buf = (unsigned long) rx;
+        xfer.len = len;
+        xfer.speed_hz = dev->speed_hz;
+        xfer.bits_per_word = 8;
+
+        ret = ioctl(dev->fd, SPI_IOC_MESSAGE(1), &xfer) < 0 ? -errno : 0;
+    }
+
+    if (ret == -EMSGSIZE) {
+        return -EBADXFR;
+    }
+
+    return ret < 0 ? -EBUSUNKERR : 0;
+}
+
+// Bytes of a burst that fit one transfer after the address byte, rounded
+// down to even so every chunk of a FIFO burst starts on a 16 bit word:
+static int spidev_chunk(const struct spidev *dev, int num_bytes) {
+    int max_chunk = (dev->max_bytes - 1) & ~1;
+
+    return num_bytes < max_chunk ? num_bytes : max_chunk;
+}
+
+static int spidev_read(void *ctx, int device_addr, int reg_addr, int *data,
+                       int num_bytes) {
+    struct spidev *dev = ctx;
+
+    uint8_t tx[SPIDEV_MAX_BYTES];
+    uint8_t rx[SPIDEV_MAX_BYTES];
+
+    int chunk;
+    int ret;
+    int i;
+
+    if (num_bytes <= 0) {
+        return -EBADXFR;
+    }
+
+    while (num_bytes > 0) {
+        chunk = spidev_chunk(dev, num_bytes);
+
+        // Register address then whatever comes back while clocking out
+        // zeros:
+        tx[0] = SPI_READ | reg_addr;
+        memset(&tx[1], 0, chunk);
+
+        if ((ret = spidev_transfer(dev, tx, rx, chunk + 1)) < 0) {
+            return ret;
+        }
+
+        for (i = 0; i < chunk; i++) {
+            data[i] = rx[i + 1];
+        }
+
+        reg_addr = bus_burst_next(reg_addr, chunk);
+        data += chunk;
+        num_bytes -= chunk;
+    }
+
+    return 0;
+}
+
+static int spidev_write(void *ctx, int device_addr, int reg_addr, int *data,
+                        int num_bytes) {
+    struct spidev *dev = ctx;
+
+    uint8_t tx[SPIDEV_MAX_BYTES];
+
+    int chunk;
+    int ret;
+    int i;
+
+    if (num_bytes <= 0) {
+        return -EBADXFR;
+    }
+
+    while (num_bytes > 0) {
+        chunk = spidev_chunk(dev, num_bytes);
+        tx[0] = reg_addr & ~SPI_READ;
+
+        for (i = 0; i < chunk; i++) {
+            tx[i + 1] = data[i];
+        }
+
+        if ((ret = spidev_transfer(dev, tx, NULL, chunk + 1)) < 0) {
+            return ret;
+        }
+
+        reg_addr = bus_burst_next(reg_addr, chunk);
+        data += chunk;
+        num_bytes -= chunk;
+    }
+
+    return 0;
+}
+
+// Nothing acknowledges on SPI so the device is as good as at every address
+// and WHO_AM_I has the last word:
+static int spidev_scan(void *ctx, int *address_book) {
+    int i;
+
+    for (i = 0; i < 127; i++) {
+        address_book[i] = 1;
+    }
+
+    return 0;
+}
+
+static int spidev_delay_us(void *ctx, unsigned int usec) {
+    struct timespec delay;
+
+    delay.tv_sec = usec / 1000000;
+    delay.tv_nsec = (usec % 1000000) * 1000L;
+
+    while (nanosleep(&delay, &delay) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void spidev_fill_bus(struct spidev *dev, struct ism330dlc_bus *bus) {
+    bus->name = "spidev";
+    bus->read = spidev_read;
+    bus->write = spidev_write;
+    bus->scan = spidev_scan;
+    bus->delay_us = spidev_delay_us;
+    bus->spi = 1;
+    bus->ctx = dev;
+}
+
+// Longest transfer the spidev driver takes (its bufsiz parameter):
+static int spidev_max_bytes(void) {
+    FILE *fpt;
+
+    int bufsiz;
+
+    if ((fpt = fopen("/sys/module/spidev/parameters/bufsiz", "r")) == NULL) {
+        return SPIDEV_MAX_BYTES;
+    }
+
+    if (fscanf(fpt, "%d", &bufsiz) != 1) {
+        bufsiz = SPIDEV_MAX_BYTES;
+    }
+
+    fclose(fpt);
+
+    if ((bufsiz < 3) || (bufsiz > SPIDEV_MAX_BYTES)) {
+        return SPIDEV_MAX_BYTES;
+    }
+
+    return bufsiz;
+}
+
+int spidev_open(struct spidev *dev, struct ism330dlc_bus *bus, int spi_bus,
+                int chip_select, uint32_t speed_hz) {
+    char path[32];
+
+    uint8_t mode = SPI_MODE_3;
+    uint8_t bits = 8;
+
+    memset(dev, 0, sizeof(*dev));
+
+    dev->spi_bus = spi_bus;
+    dev->chip_select = chip_select;
+    dev->speed_hz = speed_hz;
+    dev->max_bytes = spidev_max_bytes();
+
+    snprintf(path, sizeof(path), "/dev/spidev%d.%d", spi_bus, chip_select);
+
+    if ((dev->fd = open(path, O_RDWR)) < 0) {
+        perror(path);
+        return -1;
+    }
+
+    if ((ioctl(dev->fd, SPI_IOC_WR_MODE, &mode) < 0) ||
+        (ioctl(dev->fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0) ||
+        (ioctl(dev->fd, SPI_IOC_WR_MAX_SPEED_HZ, &dev->speed_hz) < 0)) {
+        perror(path);
+        close(dev->fd);
+        return -1;
+    }
+
+    spidev_fill_bus(dev, bus);
+
+    return 0;
+}
+
+void spidev_standin(struct spidev *dev, struct ism330dlc_bus *bus,
+                    uint32_t speed_hz,
+                    int (*transfer)(void *ctx, const uint8_t *tx,
+                                    uint8_t *rx, int len),
+                    void *ctx) {
+    memset(dev, 0, sizeof(*dev));
+
+    dev->spi_bus = -1;
+    dev->chip_select = -1;
+    dev->fd = -1;
+    dev->speed_hz = speed_hz;
+    dev->max_bytes = SPIDEV_MAX_BYTES;
+    dev->transfer = transfer;
+    dev->ctx = ctx;
+
+    spidev_fill_bus(dev, bus);
+}
+
+void spidev_close(struct spidev *dev) {
+    if (dev->fd >= 0) {
+        close(dev->fd);
+    }
+
+    dev->fd = -1;
+}
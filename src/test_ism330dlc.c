@@ -22,321 +22,735 @@
 // ============================================================================
 
 // Include C standard libraries:
-#include <stdlib.h> // C Standard library
-#include <stdio.h>  // C Standard I/O libary
-#include <time.h>   // C Standard date and time manipulation
-#include <stdint.h> // C Standard integer types
+#include <stdlib.h>    // C Standard library
+#include <stdio.h>     // C Standard I/O libary
+#include <string.h>    // C Standard string manipulation
+#include <math.h>      // C Standard math
+#include <time.h>      // C Standard date and time manipulation
+#include <stdint.h>    // C Standard integer types
+#include <signal.h>    // C Standard signal handling
+#include <unistd.h>    // POSIX getopt
 
 // Include user headers:
 #include <pi_i2c.h>              // Pi I2C library!
 #include <pi_lw_gpio.h>          // Pi GPIO library!
 #include <pi_microsleep_hard.h>  // PI microsleep library!
 
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_calib.h"     // ISM330DLC bias calibration
+#include "ism330dlc_convert.h"   // ISM330DLC unit conversion
+#include "ism330dlc_filter.h"    // ISM330DLC decimation filters
+#include "ism330dlc_fusion.h"    // ISM330DLC attitude estimation
+#include "ism330dlc_i2cdev.h"    // ISM330DLC Linux i2c-dev bus
+#include "ism330dlc_irq.h"       // ISM330DLC interrupt acquisition
+#include "ism330dlc_log.h"       // ISM330DLC binary log
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_replay.h"    // ISM330DLC session replay
+#include "ism330dlc_rt.h"        // ISM330DLC real-time acquisition
+#include "ism330dlc_sched.h"     // ISM330DLC multi-sensor scheduler
+#include "ism330dlc_sensor.h"    // ISM330DLC sensor handle
+#include "ism330dlc_shm.h"       // ISM330DLC shared memory ring
+#include "ism330dlc_sim.h"       // Simulated ISM330DLC
+#include "ism330dlc_spidev.h"    // ISM330DLC Linux spidev bus
 #include "ism330dlc_registers.h" // ISM330DLC register definitions
 
-// To convert from g's to SI units
-#define GRAVITY_CONSTANT 9.8066 // [m/s^2]
-
 // Turn the device on and off
 #define DEVICE_POWER_GPIO 4 // UPDATE
 
-// Testing ISM330DLC "iNEMO inertial module: 3D accelerometer and 3D gyroscope
-// with digital output for industrial applications" per the datasheet:
-// (Can find under doc/ism330dlc.pdf)
+// How long the device is held off when power cycling it to clear a lockup
+#define DEVICE_POWER_OFF_US 10000
+
+// Kernel I2C adapter on the Pi header (GPIO 2/3) for -B i2cdev
+#define DEVICE_I2C_ADAPTER 1 // UPDATE
+
+// ISM330DLC INT1 line on the Pi GPIO character device
+#define DEVICE_INT1_CHIP "/dev/gpiochip0"
+#define DEVICE_INT1_GPIO 17 // UPDATE
+
+// FIFO streaming: frames drained per burst once the watermark is reached
+#define FIFO_WATERMARK_FRAMES 64
+
+// Frames buffered between a sensor and the consumer (about five seconds at
+// 1.66 kHz)
+#define RING_FRAMES 8192
+
+// Frames the consumer takes at a time
+#define CONSUMER_BATCH 256
+
+// Calibration profile of the sensor at an address on a bus
+#define CALIB_PROFILE_FORMAT "test_ism330dlc_calib_%d_%02X.txt"
+
+// With -c the simulated devices lie still this long so there is a bias to
+// find
+#define SIM_STILL_MS 5000
+
+// With -x they take turns lying still and moving so there is something to
+// wake up on
+#define SIM_IDLE_STILL_MS 3000
+#define SIM_IDLE_MOVE_MS 2000
+
+// Attitude is written in degrees
+#define RAD_TO_DEG 57.2957795f
+
+// Sensors and simulated buses that can be given with -d
+#define MAX_SENSORS SCHED_MAX_SENSORS
+#define MAX_SIM_BUSES 4
+
+// Decimated streams that can be given with -m
+#define MAX_RATES 4
+
+// Output files are named after this (with a _replay suffix when replaying a
+// recording so it is not overwritten)
+#define OUTPUT_NAME "test_ism330dlc"
+#define REPLAY_OUTPUT_NAME "test_ism330dlc_replay"
+
+// One -m rate[:fir|cic] written to test_ism330dlc_<rate>hz.csv:
+struct rate_output {
+    double rate_hz;
+    int type;
+    FILE *csv;
+    struct filter_stream filter;
+    struct ism330dlc_frame frames[CONSUMER_BATCH];
+};
+
+// Where the results go (CSV file or binary log):
+struct output {
+    const char *name;
+    FILE *csv;
+    int binary;
+    struct log_writer log;
+
+    // Sensor ID as the last CSV column, only with more than one sensor so
+    // a single one keeps the original layout:
+    int sensor_column;
+
+    // FRAME_RATE as a Rate Change column (1 on the first frame at a new
+    // output data rate) before it, only when the rate can change:
+    int rate_column;
+
+    // CSV values by sensor ID (milli-g/milli-dps or SI units with -u):
+    struct convert_scale scales[MAX_SENSORS];
+    struct convert_sample samples[CONSUMER_BATCH];
+
+    // Magnetometer columns per LSB (milli-gauss or micro-tesla with -u) with
+    // -l, 0 for none:
+    float mag_scale;
+
+    // Attitude by sensor ID with -a (test_ism330dlc_attitude.csv):
+    FILE *attitude_csv;
+    struct fusion fusions[MAX_SENSORS];
+    struct convert_scale si_scales[MAX_SENSORS];
+    struct fusion_attitude attitude[CONSUMER_BATCH];
+
+    // Decimated streams:
+    struct rate_output rates[MAX_RATES];
+    int num_rates;
+
+    // Live frames for other processes with -p:
+    int publish;
+    struct shm_publisher shm;
+
+    unsigned long written;
+};
+
+// Transport the sensors are reached through (-B):
+enum backend {
+    BACKEND_PI_I2C,
+    BACKEND_I2CDEV,
+    BACKEND_SPIDEV
+};
+
+// One -d [bus:]addr[:int1_gpio] (bus -1 = the backend's default). On SPI
+// addr is the chip select:
+struct sensor_spec {
+    int bus;
+    int device_addr;
+    int int1_gpio;
+};
+
+static uint64_t host_now_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
 
-int i2c_error_handler(int errno) {
-    // An I2C error may be fatal or maybe something that we can recover from
-    // or even ignore all together:
-    switch (errno) {
-        case -ENACK:
-            printf("I2C Error! Encountered ENACK\n");
-            break;
-        case -EBADXFR:
-            printf("I2C Error! Encountered EBADXFR\n");
-            break;
-        case -EBADREGADDR:
-            printf("I2C Error! Encountered EBADREGADDR\n");
-            break;
-        case -ECLKTIMEOUT:
-            printf("I2C Error! Encountered ECLKTIMEOUT\n");
-            break;
-        case -ENACKRST:
-            printf("I2C Error! Encountered ENACKRST\n");
-            break;
-        case -EBUSLOCKUP:
-            printf("I2C Error! Encountered EBUSLOCKUP\n");
-            break;
-        case -EBUSUNKERR:
-            printf("I2C Error! Encountered EBUSUNKERR\n");
-            break;
-        case -EFAILSTCOND:
-            printf("I2C Error! Encountered EFAILSTCOND\n");
-            break;
-        case -EDEVICEHUNG:
-            printf("I2C Error! Encountered ESLAVEHUNG\n");
-            break;
-        default:
-            break;
-    }
+// Set from SIGINT to wind a run down cleanly:
+static volatile sig_atomic_t stop_requested = 0;
+
+// Set from SIGUSR1 to print the metrics while running:
+static volatile sig_atomic_t dump_requested = 0;
+
+static void handle_sigint(int sig) {
+    stop_requested = 1;
+}
+
+static void handle_sigusr1(int sig) {
+    dump_requested = 1;
+}
+
+// Power cycle through DEVICE_POWER_GPIO (every sensor on pi_i2c shares it):
+static int gpio_power_cycle(void *ctx) {
+    gpio_clear(DEVICE_POWER_GPIO);
+    microsleep_hard(DEVICE_POWER_OFF_US);
+    gpio_set(DEVICE_POWER_GPIO);
 
     return 0;
 }
 
-int scan_for_device(int device_addr) {
-    // Address book passed to returned by the function:
-    int address_book[127];
+static void dump_metrics(struct ism330dlc_sensor *sensors, int num_sensors) {
+    int i;
 
-    int ret;
+    metrics_dump(stdout);
 
-    if ((ret = scan_bus_i2c(address_book)) < 0) {
-        i2c_error_handler(ret);
+    for (i = 0; i < num_sensors; i++) {
+        sensor_report(&sensors[i], stdout);
     }
 
-    // Check and see if LIS3MDL was detected on the bus (if not then we can't
-    // really continue with the test):
-    if (address_book[device_addr] != 1) {
-        printf("Device was not detected at 0x%X\n", device_addr);
-        return -1;
+    fflush(stdout);
+}
+
+// Bus of a kernel I2C adapter, opened the first time a sensor is on it so
+// sensors on the same adapter share one:
+static struct ism330dlc_bus *i2cdev_adapter_bus(int adapter) {
+    static struct i2cdev adapters[MAX_SENSORS];
+    static struct ism330dlc_bus buses[MAX_SENSORS];
+    static int num_adapters = 0;
+
+    int i;
+
+    for (i = 0; i < num_adapters; i++) {
+        if (adapters[i].adapter == adapter) {
+            return &buses[i];
+        }
     }
 
-    printf("Device was detected at 0x%X\n", device_addr);
+    if (i2cdev_open(&adapters[i], &buses[i], adapter) < 0) {
+        return NULL;
+    }
 
-    return 0;
+    num_adapters++;
+
+    printf("Using /dev/i2c-%d with %s", adapter,
+           adapters[i].funcs & I2C_FUNC_I2C ? "I2C_RDWR combined transfers" :
+                                              "SMBus block transfers");
+
+    if (adapters[i].clock_hz) {
+        printf(" at %u kHz\n", adapters[i].clock_hz / 1000);
+    } else {
+        printf("\n");
+    }
+
+    return &buses[i];
 }
 
+static int parse_sensor_spec(const char *arg, struct sensor_spec *spec) {
+    char text[64];
+    char *fields[3];
+    char *end;
 
-int verify_device_id(int device_addr) {
-    // The returned device ID will be stored into an array that we pass
-    // to the read function:
-    int device_id[1];
+    int num_fields = 0;
+    int i;
 
-    int ret;
+    strncpy(text, arg, sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
 
-    printf("Verifying device 0x%X identity\n", device_addr);
+    fields[num_fields++] = strtok(text, ":");
 
-    if ((ret = read_i2c(device_addr, WHO_AM_I, device_id, 1)) < 0) {
-        i2c_error_handler(ret);
+    while ((num_fields < 3) &&
+           ((fields[num_fields] = strtok(NULL, ":")) != NULL)) {
+        num_fields++;
     }
 
-    // Compare returned device ID and error out if it does not match expected
-    // (If it doesn't match I would suspect something has gone horribly wrong)
-    if (device_id[0] != WHO_AM_I_DEFAULT) {
-        printf("Device identified as 0x%X but does not match expected 0x%X\n",
-               device_id[0], WHO_AM_I_DEFAULT);
+    if ((fields[0] == NULL) || (strtok(NULL, ":") != NULL)) {
         return -1;
     }
 
-    printf("Device identified as 0x%X and matches expected 0x%X\n",
-            device_id[0], WHO_AM_I_DEFAULT);
+    // addr, bus:addr or bus:addr:int1_gpio:
+    spec->bus = -1;
+    spec->int1_gpio = DEVICE_INT1_GPIO;
 
-    return 0;
+    for (i = 0; i < num_fields; i++) {
+        long value = strtol(fields[i], &end, 0);
+
+        if ((*end != '\0') || (value < 0)) {
+            return -1;
+        }
+
+        if ((num_fields == 1) || (i == 1)) {
+            spec->device_addr = value;
+        } else if (i == 0) {
+            spec->bus = value;
+        } else {
+            spec->int1_gpio = value;
+        }
+    }
+
+    return spec->device_addr < 0x80 ? 0 : -1;
+}
+
+// Roll, pitch and yaw in degrees after every frame:
+static void write_attitude(struct output *out,
+                           const struct ism330dlc_frame *frames,
+                           size_t num_frames) {
+    const struct fusion_attitude *attitude = out->attitude;
+
+    float euler[3];
+
+    size_t i;
+
+    fusion_frames(out->fusions, out->si_scales, frames, num_frames,
+                  out->attitude);
+
+    for (i = 0; i < num_frames; i++) {
+        fusion_euler(attitude[i].q, euler);
+
+        fprintf(out->attitude_csv, "%.6f, %.5f, %.5f, %.5f, %.5f, %.2f, "
+                "%.2f, %.2f", attitude[i].timestamp_ns * 1e-9,
+                attitude[i].q[0], attitude[i].q[1], attitude[i].q[2],
+                attitude[i].q[3], euler[0] * RAD_TO_DEG,
+                euler[1] * RAD_TO_DEG, euler[2] * RAD_TO_DEG);
+
+        if (out->sensor_column) {
+            fprintf(out->attitude_csv, ", %d", attitude[i].sensor);
+        }
+
+        fputc('\n', out->attitude_csv);
+    }
+}
+
+// Scale a batch in one go then print it, with the magnetometer columns
+// when mag_scale is set:
+static void write_csv(struct output *out, FILE *csv,
+                      const struct ism330dlc_frame *frames,
+                      size_t num_frames, float mag_scale) {
+    const struct convert_sample *sample = out->samples;
+
+    size_t i;
+
+    convert_frames(out->scales, frames, num_frames, out->samples);
+
+    for (i = 0; i < num_frames; i++) {
+        fprintf(csv, "%.6f, %.3f, %.3f, %.3f, %.3f, %.3f, %.3f",
+                frames[i].timestamp_ns * 1e-9,
+                sample[i].accel[0], sample[i].accel[1], sample[i].accel[2],
+                sample[i].gyro[0], sample[i].gyro[1], sample[i].gyro[2]);
+
+        if (mag_scale) {
+            fprintf(csv, ", %.1f, %.1f, %.1f", mag_scale * frames[i].mag[0],
+                    mag_scale * frames[i].mag[1],
+                    mag_scale * frames[i].mag[2]);
+        }
+
+        if (out->rate_column) {
+            fprintf(csv, ", %d", (frames[i].flags & FRAME_RATE) != 0);
+        }
+
+        if (out->sensor_column) {
+            fprintf(csv, ", %d", frames[i].sensor);
+        }
+
+        fputc('\n', csv);
+    }
 }
 
-// Set device configuration by writing to a register address
-int configure_device(int device_addr, int reg_addr, int *configs,
-                     int num_configs) {
-    int reg_value[1] = {0};
+static int write_frames(struct output *out,
+                        const struct ism330dlc_frame *frames,
+                        size_t num_frames) {
+    struct rate_output *rate;
+
+    size_t num_out;
 
     int i;
-    int ret;
 
-    int mask = 0;
-    int start_bit = 0;
-    int stop_bit = 0;
+    if (out->publish) {
+        shm_publish(&out->shm, frames, num_frames);
+    }
+
+    if (out->attitude_csv != NULL) {
+        write_attitude(out, frames, num_frames);
+    }
+
+    // Every decimated stream from the same frames:
+    for (i = 0; i < out->num_rates; i++) {
+        rate = &out->rates[i];
+
+        num_out = filter_stream_run(&rate->filter, frames, num_frames,
+                                    rate->frames);
+
+        write_csv(out, rate->csv, rate->frames, num_out, 0);
+    }
 
-    printf("Configuring device 0x%X\n", device_addr);
+    if (out->binary) {
+        if (log_append(&out->log, frames, num_frames) < 0) {
+            printf("Failed to append to %s.bin\n", out->name);
+            return -1;
+        }
 
-    // Get current register value to apply the options to:
-    if ((ret = read_i2c(device_addr, reg_addr, reg_value, 1)) < 0) {
-        i2c_error_handler(ret);
-        return ret;
+        out->written += num_frames;
+        return 0;
     }
 
-    printf("Register 0x%X currently reads 0x%X\n", reg_addr, reg_value[0]);
+    write_csv(out, out->csv, frames, num_frames, out->mag_scale);
 
-    // Go through all input options to come up with the final register value:
-    for (i = 0; i < num_configs; i++) {
-        // AND the current value of the register with a mask to clear the
-        // bit of the option being sent then OR it with the option to arrive
-        // to the final value of the register:
-        stop_bit = configs[i] >> 12;
-        start_bit = 0x0F & (configs[i] >> 8);
+    out->written += num_frames;
 
-        mask = ~((2 * ((1 << (stop_bit - start_bit)) - 1) + 1) << start_bit);
+    return 0;
+}
 
-        reg_value[0] = (reg_value[0] & mask) | (configs[i] << start_bit);
+// -T rate[:cpu]: read at rate Hz against absolute deadlines with the
+// device running at the lowest output data rate that keeps up, so every
+// read gets a new sample:
+static int parse_realtime(const char *arg, struct sensor_config *config,
+                          struct rt_config *rt) {
+    static const int odrs[][2] = {
+        {ACCEL_12_DOT_5_HZ, GYRO_12_DOT_5_HZ}, {ACCEL_26_HZ, GYRO_26_HZ},
+        {ACCEL_52_HZ, GYRO_52_HZ}, {ACCEL_104_HZ, GYRO_104_HZ},
+        {ACCEL_208_HZ, GYRO_208_HZ}, {ACCEL_416_HZ, GYRO_416_HZ},
+        {ACCEL_833_HZ, GYRO_833_HZ}, {ACCEL_1_DOT_66_K_HZ, GYRO_1_DOT_66_K_HZ},
+        {ACCEL_3_DOT_33_K_HZ, GYRO_3_DOT_33_K_HZ},
+        {ACCEL_6_DOT_66_K_HZ, GYRO_6_DOT_66_K_HZ}
+    };
+
+    char *end;
+    double rate_hz = strtod(arg, &end);
+
+    size_t i = 0;
+
+    rt->cpu = -1;
+
+    if (*end == ':') {
+        rt->cpu = strtol(end + 1, &end, 0);
     }
 
-    printf("Setting register 0x%X to 0x%X\n", reg_addr, (uint8_t) reg_value[0]);
+    if ((*end != '\0') || (rate_hz <= 0)) {
+        return -1;
+    }
 
-    if ((ret = write_i2c(device_addr, reg_addr, reg_value, 0x01)) < 0) {
-        i2c_error_handler(ret);
-        return ret;
+    while ((i < sizeof(odrs) / sizeof(odrs[0]) - 1) &&
+           (odr_to_hz(odrs[i][0]) < rate_hz)) {
+        i++;
     }
 
-    printf("Device configured\n");
+    config->accel_odr = odrs[i][0];
+    config->gyro_odr = odrs[i][1];
+    config->period_ns = 1e9 / rate_hz;
+
+    rt->enabled = 1;
+    rt->priority = RT_DEFAULT_PRIORITY;
 
     return 0;
 }
 
-// Get acceleration data and return in mili-g:
-int get_accel(int device_addr, int sensitivity, float *accel_data) {
-    int raw_accel_data[6] = {0, 0, 0, 0, 0, 0};
+// -m rate[:fir|cic]:
+static int parse_rate(const char *arg, struct rate_output *rate) {
+    char *end;
+
+    rate->rate_hz = strtod(arg, &end);
+    rate->type = FILTER_FIR;
+
+    if (strcmp(end, ":cic") == 0) {
+        rate->type = FILTER_CIC;
+    } else if ((*end != '\0') && (strcmp(end, ":fir") != 0)) {
+        return -1;
+    }
+
+    return rate->rate_hz > 0 ? 0 : -1;
+}
+
+// Open a CSV file per decimated stream once the acquisition rate is known:
+static int open_rates(struct output *out, double input_hz) {
+    struct rate_output *rate;
 
-    int16_t accel_x_raw = 0;
-    int16_t accel_y_raw = 0;
-    int16_t accel_z_raw = 0;
+    char path[64];
+    int factor;
+    int i;
 
-    float accel_x_converted = 0;
-    float accel_y_converted = 0;
-    float accel_z_converted = 0;
+    for (i = 0; i < out->num_rates; i++) {
+        rate = &out->rates[i];
+        factor = lround(input_hz / rate->rate_hz);
 
-    int scale;
+        if (filter_stream_init(&rate->filter, rate->type, factor) < 0) {
+            return -1;
+        }
 
-    int ret;
+        snprintf(path, sizeof(path), "%s_%ghz.csv", out->name,
+                 rate->rate_hz);
 
-    int attempt = 1;
+        printf("Writing %.1f Hz (%s, 1 in %d) to %s\n", input_hz / factor,
+               rate->type == FILTER_FIR ? "FIR" : "CIC", factor, path);
 
-    printf("Getting accelerometer data from device 0x%X\n", device_addr);
+        rate->csv = fopen(path, "w+");
 
-    // milli-g/LSB * 1000:
-    if (sensitivity == (ACCEL_FS_2_G)) {
-        scale = 61;
-    } else if (sensitivity == (ACCEL_FS_4_G)) {
-        scale = 122;
-    } else if (sensitivity == (ACCEL_FS_8_G)) {
-        scale = 244;
-    } else if (sensitivity == (ACCEL_FS_16_G)) {
-        scale = 488;
+        if (rate->csv == NULL) {
+            perror("fopen");
+            return -1;
+        }
+
+        fprintf(rate->csv, "Sample Timestamp, Acceleration X,"\
+                " Acceleration Y, Acceleration Z, Gyroscope X, Gyroscope Y,"\
+                " Gyroscope Z%s%s\n", out->rate_column ? ", Rate Change" : "",
+                out->sensor_column ? ", Sensor" : "");
     }
 
-    // Get raw acceleration data:
-    while (attempt) {
-        if ((ret = read_i2c(device_addr, OUTX_L_XL, raw_accel_data, 6)) < 0) {
-            i2c_error_handler(ret);
-            microsleep_hard(1000);
-        } else {
-            // Break the loop:
-            attempt = 0;
+    return 0;
+}
+
+// Open the CSV file or binary log, the shared memory ring, the decimated
+// streams and the attitude file. info describes the samples and input_hz is
+// the rate they come in at:
+static int open_outputs(struct output *out, const struct log_header *info,
+                        double input_hz, int attitude) {
+    struct shm_header shm_info = {0};
+
+    char path[64];
+
+    if (out->binary) {
+        snprintf(path, sizeof(path), "%s.bin", out->name);
+
+        printf("Writing results to %s\n", path);
+
+        // Binary log of raw samples written as they come in (convert with
+        // ism330dlc_log2csv):
+        if (log_open(&out->log, path, info) < 0) {
+            return -1;
+        }
+    } else {
+        snprintf(path, sizeof(path), "%s.csv", out->name);
+
+        printf("Writing results to %s (%s conversion)\n", path,
+               convert_kernel());
+
+        // Create a CSV file and write data to it as samples come in:
+        out->csv = fopen(path, "w+");
+
+        if (out->csv == NULL) {
+            perror("fopen");
+            return -1;
         }
+
+        fprintf(out->csv, "Sample Timestamp, Acceleration X,"\
+                " Acceleration Y, Acceleration Z, Gyroscope X, Gyroscope Y,"\
+                " Gyroscope Z%s%s%s\n", out->mag_scale ? ", Magnetic X,"\
+                " Magnetic Y, Magnetic Z" : "",
+                out->rate_column ? ", Rate Change" : "",
+                out->sensor_column ? ", Sensor" : "");
     }
 
-    // Get raw acceleration data:
-    while (attempt) {
-        if ((ret = read_i2c(device_addr, OUTX_L_XL, raw_accel_data, 6)) < 0) {
-            i2c_error_handler(ret);
-            microsleep_hard(1000);
-        } else {
-            // Append MSB to LSB:
-            accel_x_raw = (raw_accel_data[1] << 8) | raw_accel_data[0];
-            accel_y_raw = (raw_accel_data[3] << 8) | raw_accel_data[2];
-            accel_z_raw = (raw_accel_data[5] << 8) | raw_accel_data[4];
-
-            // Ensure that all axis reported non-zero values otherwise get
-            // more data:
-            if ((accel_x_raw != 0) && (accel_y_raw != 0) && (accel_z_raw != 0)) {
-                // Break the loop:
-                attempt = 0;
-            }
+    if (out->publish) {
+        shm_info.accel_odr = info->accel_odr;
+        shm_info.gyro_odr = info->gyro_odr;
+        shm_info.accel_scale = info->accel_scale;
+        shm_info.gyro_scale = info->gyro_scale;
+        shm_info.mag_scale = out->mag_scale ? LIS2MDL_SENSITIVITY : 0;
+
+        if (shm_publish_open(&out->shm, SHM_DEFAULT_NAME, SHM_DEFAULT_FRAMES,
+                             &shm_info) < 0) {
+            return -1;
         }
     }
 
-    printf("accel_x_raw = %d\n", accel_x_raw);
-    printf("accel_y_raw = %d\n", accel_y_raw);
-    printf("accel_z_raw = %d\n", accel_z_raw);
+    if (open_rates(out, input_hz) < 0) {
+        return -1;
+    }
+
+    if (attitude) {
+        snprintf(path, sizeof(path), "%s_attitude.csv", out->name);
+
+        printf("Writing attitude to %s\n", path);
 
-    // Convert based on scalar:
-    accel_x_converted = (scale * accel_x_raw) / 1000.0f; // [milli-g]
-    accel_y_converted = (scale * accel_y_raw) / 1000.0f; // [milli-g]
-    accel_z_converted = (scale * accel_z_raw) / 1000.0f; // [milli-g]
+        out->attitude_csv = fopen(path, "w+");
 
-    printf("accel_x_converted = %0.3f milli-g\n", accel_x_converted);
-    printf("accel_y_converted = %0.3f milli-g\n", accel_y_converted);
-    printf("accel_z_converted = %0.3f milli-g\n", accel_z_converted);
+        if (out->attitude_csv == NULL) {
+            perror("fopen");
+            return -1;
+        }
 
-    accel_data[0] = accel_x_converted;
-    accel_data[1] = accel_y_converted;
-    accel_data[2] = accel_z_converted;
+        fprintf(out->attitude_csv, "Sample Timestamp, Quaternion W,"\
+                " Quaternion X, Quaternion Y, Quaternion Z, Roll, Pitch,"\
+                " Yaw%s\n", out->sensor_column ? ", Sensor" : "");
+    }
 
     return 0;
 }
 
-// Get gyroscope data and return in milli degrees per second:
-int get_gyro(int device_addr, int sensitivity, float *gyro_data) {
-    int raw_gyro_data[6] = {0, 0, 0, 0, 0, 0};
+static void close_outputs(struct output *out) {
+    int i;
 
-    int16_t gyro_x_raw = 0;
-    int16_t gyro_y_raw = 0;
-    int16_t gyro_z_raw = 0;
+    if (out->binary) {
+        log_close(&out->log);
+    } else {
+        fclose(out->csv);
+    }
 
-    float gyro_x_converted = 0;
-    float gyro_y_converted = 0;
-    float gyro_z_converted = 0;
+    if (out->publish) {
+        shm_publish_close(&out->shm);
+    }
 
-    int scale;
+    if (out->attitude_csv != NULL) {
+        fclose(out->attitude_csv);
+    }
 
-    int ret;
+    for (i = 0; i < out->num_rates; i++) {
+        fclose(out->rates[i].csv);
+    }
+}
 
-    int attempt = 1;
+// Push a recording through the same outputs as live frames, as fast as they
+// go (speed 0) or at speed times the recorded rate, and say how many frames
+// a second that came to:
+static int run_replay(struct output *out, const char *path, double speed,
+                      const struct sensor_config *config, int units,
+                      int filter) {
+    static struct ism330dlc_frame frames[CONSUMER_BATCH];
+
+    struct replay replay;
+    struct log_header info = {0};
+
+    uint64_t start_ns;
+    double elapsed_s;
+    size_t num_frames;
+    int ret = 0;
+    int i;
 
-    printf("Getting accelerometer data from device 0x%X\n", device_addr);
+    info.accel_odr = odr_to_hz(config->accel_odr);
+    info.gyro_odr = odr_to_hz(config->gyro_odr);
+    info.accel_fs = config->accel_fs;
+    info.gyro_fs = config->gyro_fs;
 
-    // milli-dps/LSB * 1000 / 5:
-    if (sensitivity == (GYRO_FS_125_DPS_ENABLED)) {
-        scale = 4375 / 5;
-    } else if (sensitivity == (GYRO_FS_250_DPS)) {
-        scale = 8750 / 5;
-    } else if (sensitivity == (GYRO_FS_500_DPS)) {
-        scale = 17500 / 5;
-    } else if (sensitivity == (GYRO_FS_1000_DPS)) {
-        scale = 35000 / 5;
-    } else if (sensitivity == (GYRO_FS_2000_DPS)) {
-        scale = 70000 / 5;
+    // CSV values go back to raw with the scales they were written with:
+    for (i = 0; i < MAX_SENSORS; i++) {
+        convert_scale_init(&out->scales[i], info.accel_fs, info.gyro_fs,
+                           units);
     }
 
-    printf("scale = %d\n", scale);
+    if (replay_open(&replay, path, speed, out->scales, MAX_SENSORS,
+                    out->mag_scale) < 0) {
+        return -1;
+    }
 
-    // Get raw gyroscope data:
-    while (attempt) {
-        if ((ret = read_i2c(device_addr, OUTX_L_G, raw_gyro_data, 6)) < 0) {
-            i2c_error_handler(ret);
-            microsleep_hard(1000);
-        } else {
-            // Append MSB to LSB:
-            gyro_x_raw = (raw_gyro_data[1] << 8) | raw_gyro_data[0];
-            gyro_y_raw = (raw_gyro_data[3] << 8) | raw_gyro_data[2];
-            gyro_z_raw = (raw_gyro_data[5] << 8) | raw_gyro_data[4];
-
-            // Ensure that all axis reported non-zero values otherwise get
-            // more data:
-            if ((gyro_x_raw != 0) && (gyro_y_raw != 0) && (gyro_z_raw != 0)) {
-                // Break the loop:
-                attempt = 0;
-            }
+    // A log says what it was recorded at:
+    if (replay.format == REPLAY_LOG) {
+        info = *replay.view.header;
+    }
+
+    info.accel_scale = accel_sensitivity(info.accel_fs);
+    info.gyro_scale = gyro_sensitivity(info.gyro_fs);
+
+    for (i = 0; i < MAX_SENSORS; i++) {
+        convert_scale_init(&out->scales[i], info.accel_fs, info.gyro_fs,
+                           units);
+        convert_scale_init(&out->si_scales[i], info.accel_fs, info.gyro_fs,
+                           CONVERT_SI);
+        fusion_init(&out->fusions[i], filter);
+    }
+
+    // Same layout as the recording:
+    out->sensor_column = replay_multi_sensor(&replay);
+    out->rate_column = replay_rate_changes(&replay);
+
+    if (open_outputs(out, &info, info.accel_odr, filter >= 0) < 0) {
+        replay_close(&replay);
+        return -1;
+    }
+
+    signal(SIGINT, handle_sigint);
+
+    start_ns = host_now_ns();
+
+    while (!stop_requested &&
+           ((num_frames = replay_read(&replay, frames, CONSUMER_BATCH)) > 0)) {
+        if ((ret = write_frames(out, frames, num_frames)) < 0) {
+            break;
         }
     }
 
-    printf("gyro_x_raw = %d\n", gyro_x_raw);
-    printf("gyro_y_raw = %d\n", gyro_y_raw);
-    printf("gyro_z_raw = %d\n", gyro_z_raw);
+    elapsed_s = (host_now_ns() - start_ns) * 1e-9;
 
-    // Convert based on scalar:
-    gyro_x_converted = (5 * scale * gyro_x_raw) / 1000.0f; // [milli-dps]
-    gyro_y_converted = (5 * scale * gyro_y_raw) / 1000.0f; // [milli-dps]
-    gyro_z_converted = (5 * scale * gyro_z_raw) / 1000.0f; // [milli-dps]
+    printf("Replayed %lu frames in %.3f s: %.0f frames/s", replay.frames,
+           elapsed_s, replay.frames / elapsed_s);
 
-    printf("gyro_x_converted = %0.3f milli-dps\n", gyro_x_converted);
-    printf("gyro_y_converted = %0.3f milli-dps\n", gyro_y_converted);
-    printf("gyro_z_converted = %0.3f milli-dps\n", gyro_z_converted);
+    if (replay.last_ns > replay.first_ns) {
+        printf(", %.1fx real time",
+               (replay.last_ns - replay.first_ns) * 1e-9 / elapsed_s);
+    }
 
-    gyro_data[0] = gyro_x_converted;
-    gyro_data[1] = gyro_y_converted;
-    gyro_data[2] = gyro_z_converted;
+    printf("\n");
 
-    return 0;
+    if (replay.skipped) {
+        printf("Skipped %lu lines or records that were not samples of "
+               "sensor 0 to %d\n", replay.skipped, MAX_SENSORS - 1);
+    }
+
+    close_outputs(out);
+    replay_close(&replay);
+
+    return ret;
+}
+
+static void usage(const char *program) {
+    printf("Usage: %s [-s] [-f] [-F] [-i] [-t] [-b] [-r] [-n samples] "
+           "[-u] [-c] [-x] [-A] [-l] [-p] [-a filter] [-m rate[:cic]]...\n"
+           "       [-g ftype] [-e period] [-w] [-d [bus:]addr[:int1_gpio]]...\n"
+           "       [-B backend] [-R recording [-S speed]] [-T rate[:cpu]]\n",
+           program);
+    printf("  -s  Run against simulated ISM330DLCs instead of pi_i2c\n");
+    printf("  -f  Stream through the FIFO at 1.66 kHz instead of polling\n");
+    printf("  -F  Stream through the FIFO at 6.66 kHz (too fast for I2C, "
+           "use -B spidev)\n");
+    printf("  -i  Wait on INT1 (data-ready or FIFO watermark) instead of "
+           "sleeping\n");
+    printf("  -t  Stamp FIFO samples from the device timestamp counter "
+           "(with -f)\n");
+    printf("  -b  Write a binary log (test_ism330dlc.bin) instead of CSV\n");
+    printf("  -r  Read the configuration back after writing it\n");
+    printf("  -u  Write m/s^2 and rad/s to the CSV file instead of milli-g "
+           "and milli-dps\n");
+    printf("  -c  Calibrate the bias while running, starting from and saving "
+           "to\n      test_ism330dlc_calib_<bus>_<addr>.txt\n");
+    printf("  -x  Sit idle at 26 Hz until the sensor moves, stream from a "
+           "second before\n      that and go idle again once still for 2 s "
+           "(with -f)\n");
+    printf("  -A  Follow the motion with the output data rate, from 1.66 "
+           "kHz down to 26 Hz\n      once still for 2 s and back up while "
+           "moving (with -f)\n");
+    printf("  -l  Read a LIS2MDL magnetometer through the sensor hub into "
+           "the same frames\n      (about 100 Hz in the FIFO with -f)\n");
+    printf("  -p  Publish the frames live to other processes in shared "
+           "memory " SHM_DEFAULT_NAME "\n      (follow with "
+           "ism330dlc_shm_reader)\n");
+    printf("  -m  Also write a stream decimated to rate Hz (FIR, or CIC with "
+           ":cic) to\n      test_ism330dlc_<rate>hz.csv\n");
+    printf("  -g  Narrow the gyroscope bandwidth with LPF1 (FTYPE 0 to 3)\n");
+    printf("  -a  Estimate attitude with madgwick or mahony and write it to\n"
+           "      test_ism330dlc_attitude.csv\n");
+    printf("  -n  Number of samples to take from every sensor (0 = until "
+           "Ctrl-C, default 500)\n");
+    printf("  -e  Lock the simulated bus up every given number of "
+           "transactions (with -s)\n");
+    printf("  -w  Scan the bus and sleep a second at startup instead of "
+           "probing and\n      waiting for the samples to settle\n");
+    printf("  -d  Add a sensor (default 0:0x6A). Bus 0 is pi_i2c, with -s "
+           "every bus is a separate simulated bus\n");
+    printf("  -B  Reach the sensors through pi_i2c (default) or i2cdev, "
+           "where every -d bus\n      is a kernel adapter /dev/i2c-<bus> "
+           "(default %d). With -s, i2cdev sends the\n      simulated bus "
+           "the same combined transfers. Or spidev, where every -d is\n"
+           "      bus:chip_select for /dev/spidev<bus>.<chip_select> "
+           "(default 0:0)\n", DEVICE_I2C_ADAPTER);
+    printf("  -T  Read at rate Hz against absolute deadlines from SCHED_FIFO "
+           "threads (pinned\n      to cpu) with memory locked, and report "
+           "the start jitter (not with -f or -i)\n");
+    printf("  -R  Replay a test_ism330dlc.csv or .bin recording instead of "
+           "running sensors,\n      writing to test_ism330dlc_replay.* "
+           "(CSV files are read at the rates and\n      units -f and -u "
+           "give)\n");
+    printf("  -S  Replay at speed times the recorded rate instead of as fast "
+           "as possible\n");
 }
 
-int main(void) {
+int main(int argc, char **argv) {
     // ISM330DLC slave address (page 17):
     uint8_t ism330dlc_addr = 0x6A;
 
@@ -348,143 +762,615 @@ int main(void) {
 
     int speed_grade = I2C_FULL_SPEED;
 
-    int config[7];
-
+    // Sensors to run (-d), 0x6A on pi_i2c unless told otherwise:
+    struct sensor_spec specs[MAX_SENSORS];
+    int num_sensors = 0;
+
+    // Simulated devices modeled on a 400 kHz bus: address and register
+    // phase per transaction plus 9 clocks per data byte. Sensors given the
+    // same bus share one:
+    struct ism330dlc_sim_config sim_config = {
+        .device_addr = 0x6A,
+        .realtime = 1,
+        .latency_us = 50,
+        .byte_ns = 22500,
+        .timer_ppm = 150,
+        .boot_us = 5000
+    };
+
+    static struct ism330dlc_sim sims[MAX_SENSORS];
+    static struct ism330dlc_bus sim_buses[MAX_SIM_BUSES];
+    static struct i2cdev sim_i2cdevs[MAX_SIM_BUSES];
+
+    // Chip selects with -B spidev:
+    static struct spidev spidevs[MAX_SENSORS];
+    static struct ism330dlc_bus spi_buses[MAX_SENSORS];
+    struct ism330dlc_sim *sim_bus_head[MAX_SIM_BUSES] = {0};
+
+    static struct ism330dlc_sensor sensors[MAX_SENSORS];
+    static struct ism330dlc_sched sched;
+
+    struct sensor_config config = {
+        .accel_odr = ACCEL_52_HZ,
+        .accel_fs = ACCEL_FS_2_G,
+        .gyro_odr = GYRO_52_HZ,
+        .gyro_fs = GYRO_FS_250_DPS,
+        .fast_start = 1,
+        .retry = RETRY_POLICY_DEFAULT,
+        .fifo = {
+            .mode = FIFO_CONTINUOUS_MODE,
+            .odr = FIFO_ODR_1_DOT_66_K_HZ,
+            .dec_gyro = DEC_FIFO_GYRO_NO_DECIMATION,
+            .dec_accel = DEC_FIFO_XL_NO_DECIMATION,
+            .watermark = 6 * FIFO_WATERMARK_FRAMES
+        },
+        .motion = MOTION_CONFIG_DEFAULT
+    };
+
+    // INT1 edge sources (gpiochip lines unless simulating):
+    struct ism330dlc_irq irqs[MAX_SENSORS];
+    struct gpio_irq gpio_int1[MAX_SENSORS];
+    int num_gpio_irqs = 0;
+
+    // Power switches a locked up sensor is cycled through:
+    static struct ism330dlc_power sim_switches[MAX_SENSORS];
+    static struct ism330dlc_power gpio_switch = {
+        .name = "DEVICE_POWER_GPIO",
+        .cycle = gpio_power_cycle
+    };
+
+    // Binary log header:
+    struct log_header log_info = {0};
+
+    static struct ism330dlc_frame frames[CONSUMER_BATCH];
+    static struct output out;
+
+    struct timespec idle = {0, 1000000};
+
+    // Bus every sensor is on:
+    struct ism330dlc_bus *sensor_buses[MAX_SENSORS];
+    int backend = BACKEND_PI_I2C;
+
+    // Power-on and the first frame out of every sensor for the startup time:
+    uint64_t power_on_ns;
+    uint64_t first_ns[MAX_SENSORS] = {0};
+    int started = 0;
+
+    long number_of_samples = 500;
+    int units = CONVERT_MILLI;
+    int filter = -1;
+    int calibrate = 0;
+    int device_timestamps = 0;
+    int simulate = 0;
+    int opt;
+
+    // Real-time bus threads with -T:
+    static struct rt_config rt;
+
+    // Recording to replay with -R instead of running sensors (-S speed):
+    const char *replay_path = NULL;
+    double replay_speed = 0;
+
+    size_t num_frames;
+
+    struct calib_profile profile;
+    char profile_path[64];
+    float gyro_bias[3];
+
+    int status;
     int ret;
     int i;
 
-    // CSV file to save data:
-    FILE* fpt;
+    out.name = OUTPUT_NAME;
+
+    while ((opt = getopt(argc, argv,
+                         "sfFitbrucxAlpa:m:g:e:wn:d:B:R:S:T:h")) != -1) {
+        switch (opt) {
+            case 's':
+                simulate = 1;
+                break;
+            case 'f':
+                config.fifo_streaming = 1;
+                config.accel_odr = ACCEL_1_DOT_66_K_HZ;
+                config.gyro_odr = GYRO_1_DOT_66_K_HZ;
+                config.fifo.odr = FIFO_ODR_1_DOT_66_K_HZ;
+                break;
+            case 'F':
+                config.fifo_streaming = 1;
+                config.accel_odr = ACCEL_6_DOT_66_K_HZ;
+                config.gyro_odr = GYRO_6_DOT_66_K_HZ;
+                config.fifo.odr = FIFO_ODR_6_DOT_66_K_HZ;
+                break;
+            case 'i':
+                config.interrupt = 1;
+                break;
+            case 't':
+                device_timestamps = 1;
+                config.fifo.dec_timestamp = DEC_DS4_FIFO_NO_DECIMATION;
+                break;
+            case 'b':
+                out.binary = 1;
+                break;
+            case 'r':
+                config.verify = 1;
+                break;
+            case 'u':
+                units = CONVERT_SI;
+                break;
+            case 'c':
+                calibrate = 1;
+                sim_config.still_ms = SIM_STILL_MS;
+                break;
+            case 'x':
+                config.motion_trigger = 1;
+                sim_config.still_ms = SIM_IDLE_STILL_MS;
+                sim_config.move_ms = SIM_IDLE_MOVE_MS;
+                break;
+            case 'A':
+                config.adaptive = 1;
+                config.adapt = (struct adapt_config) ADAPT_CONFIG_DEFAULT;
+                sim_config.still_ms = SIM_IDLE_STILL_MS;
+                sim_config.move_ms = SIM_IDLE_MOVE_MS;
+                break;
+            case 'l':
+                config.hub.mag_addr = LIS2MDL_ADDR;
+                config.fifo.dec_hub = DEC_DS3_FIFO_16;
+                sim_config.mag_addr = LIS2MDL_ADDR;
+                break;
+            case 'p':
+                out.publish = 1;
+                break;
+            case 'm':
+                if ((out.num_rates == MAX_RATES) ||
+                    (parse_rate(optarg, &out.rates[out.num_rates]) < 0)) {
+                    usage(argv[0]);
+                    return -1;
+                }
+
+                out.num_rates++;
+                break;
+            case 'g':
+                config.gyro_lpf1 = GYRO_FTYPE_0 | (atoi(optarg) & 0x03);
+                break;
+            case 'a':
+                if (strcmp(optarg, "madgwick") == 0) {
+                    filter = FUSION_MADGWICK;
+                } else if (strcmp(optarg, "mahony") == 0) {
+                    filter = FUSION_MAHONY;
+                } else {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'e':
+                sim_config.error_code = -EBUSLOCKUP;
+                sim_config.error_period = atoi(optarg);
+                break;
+            case 'w':
+                config.fast_start = 0;
+                break;
+            case 'n':
+                number_of_samples = atol(optarg);
+                break;
+            case 'T':
+                if (parse_realtime(optarg, &config, &rt) < 0) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'R':
+                replay_path = optarg;
+                break;
+            case 'S':
+                replay_speed = atof(optarg);
+                break;
+            case 'B':
+                if (strcmp(optarg, "pi_i2c") == 0) {
+                    backend = BACKEND_PI_I2C;
+                } else if (strcmp(optarg, "i2cdev") == 0) {
+                    backend = BACKEND_I2CDEV;
+                } else if (strcmp(optarg, "spidev") == 0) {
+                    backend = BACKEND_SPIDEV;
+                } else {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'd':
+                if ((num_sensors == MAX_SENSORS) ||
+                    (parse_sensor_spec(optarg, &specs[num_sensors]) < 0)) {
+                    usage(argv[0]);
+                    return -1;
+                }
+
+                num_sensors++;
+                break;
+            default:
+                usage(argv[0]);
+                return -1;
+        }
+    }
 
-    static int number_of_samples = 500;
+    // 1 gauss = 100 micro-tesla:
+    if (config.hub.mag_addr) {
+        out.mag_scale = units == CONVERT_SI ? 0.1f * LIS2MDL_SENSITIVITY :
+                                              LIS2MDL_SENSITIVITY;
+    }
 
-    float accel_data[3];
-    float gyro_data[3];
+    if (replay_path != NULL) {
+        out.name = REPLAY_OUTPUT_NAME;
 
-    float accel_x[number_of_samples];
-    float accel_y[number_of_samples];
-    float accel_z[number_of_samples];
+        return run_replay(&out, replay_path, replay_speed, &config, units,
+                          filter);
+    }
 
-    float gyro_x[number_of_samples];
-    float gyro_y[number_of_samples];
-    float gyro_z[number_of_samples];
+    if (num_sensors == 0) {
+        specs[0].bus = -1;
+        specs[0].device_addr = backend == BACKEND_SPIDEV ? 0 : ism330dlc_addr;
+        specs[0].int1_gpio = DEVICE_INT1_GPIO;
+        num_sensors = 1;
+    }
 
-    struct timespec sample_time;
+    // The Pi header adapter with i2c-dev, else bus 0:
+    for (i = 0; i < num_sensors; i++) {
+        if (specs[i].bus < 0) {
+            specs[i].bus = (backend == BACKEND_I2CDEV) && !simulate ?
+                           DEVICE_I2C_ADAPTER : 0;
+        }
 
-    long int sample_second[number_of_samples];
-    long int sample_nano_second[number_of_samples];
+        if ((backend != BACKEND_SPIDEV) && (specs[i].device_addr == 0)) {
+            usage(argv[0]);
+            return -1;
+        }
+    }
 
-    printf("Begin test_ism330dlc.c\n");
-    printf("Configuring pi_i2c:\n");
-    printf("sda_pin = %d\n", sda_pin);
-    printf("sda_pin = %d\n", scl_pin);
-    printf("speed_grade = %d Hz\n", speed_grade);
+    // Simulated 10 MHz SPI: 8 clocks a byte and a cheaper transaction:
+    if (backend == BACKEND_SPIDEV) {
+        sim_config.latency_us = 20;
+        sim_config.byte_ns = 8e9 / SPIDEV_MAX_SPEED_HZ;
+    }
 
-    // Turn on the PCA9685:
-    gpio_set_mode(GPIO_OUTPUT, DEVICE_POWER_GPIO);
-    gpio_set(DEVICE_POWER_GPIO);
+    // Bus lockups are an I2C failure:
+    if ((backend == BACKEND_SPIDEV) && sim_config.error_period) {
+        printf("Leave out -e with -B spidev\n");
+        return -1;
+    }
 
-    printf("ISM330DLC turned on\n");
+    // The pre-trigger history comes out of the FIFO:
+    if (config.motion_trigger && !config.fifo_streaming) {
+        printf("Motion triggered acquisition streams through the FIFO, use "
+               "-f\n");
+        return -1;
+    }
 
-    // Configure at standard mode:
-    if ((ret = config_i2c(sda_pin, scl_pin, speed_grade)) < 0 ) {
-        printf("config_i2c() failed to configure and returned %d\n", ret);
-        return ret;
+    // The rate follows the FIFO ODR, and decimation assumes a fixed one:
+    if (config.adaptive &&
+        (!config.fifo_streaming || config.motion_trigger || out.num_rates ||
+         (adapt_rate_index(config.accel_odr) < 0))) {
+        printf("Adaptive rates stream through the FIFO, use -f and leave out "
+               "-x and -m\n");
+        return -1;
     }
 
-    // Check to see if the device is present prior to interacting with device:
-    if ((ret = scan_for_device(ism330dlc_addr)) < 0) {
+    // -T paces polled reads itself:
+    if (config.period_ns && (config.fifo_streaming || config.interrupt)) {
+        printf("Real-time mode polls the output registers, leave out -f and "
+               "-i\n");
         return -1;
     }
 
-    // Check to see if the device ID matches what's expected prior to
-    // continuing with the test:
-    if ((ret = verify_device_id(ism330dlc_addr)) < 0) {
+    // Device timestamps come through the FIFO:
+    if (device_timestamps && !config.fifo_streaming) {
+        printf("Device timestamps come through the FIFO, use -f\n");
         return -1;
     }
 
-    // Configure FIFO:
-    // - Bypass mode. FIFO disabled
-    config[0] = FIFO_BYPASS_MODE;
+    printf("Begin test_ism330dlc.c\n");
+
+    if (simulate) {
+        for (i = 0; i < num_sensors; i++) {
+            if (specs[i].bus >= MAX_SIM_BUSES) {
+                printf("Only %d simulated buses\n", MAX_SIM_BUSES);
+                return -1;
+            }
+
+            printf("Using simulated ISM330DLC at 0x%X on bus %d\n",
+                   specs[i].device_addr, specs[i].bus);
+
+            sim_config.device_addr = specs[i].device_addr;
+            sim_config.seed = i;
+            sim_init(&sims[i], &sim_config);
+
+            power_on_ns = host_now_ns();
+
+            if (backend == BACKEND_SPIDEV) {
+                // Every chip select is a bus of its own:
+                spidev_standin(&spidevs[i], &spi_buses[i],
+                               SPIDEV_MAX_SPEED_HZ, sim_spi_transfer,
+                               &sims[i]);
+                sensor_buses[i] = &spi_buses[i];
+                continue;
+            } else if (sim_bus_head[specs[i].bus] != NULL) {
+                sim_share_bus(sim_bus_head[specs[i].bus], &sims[i]);
+            } else if (backend == BACKEND_I2CDEV) {
+                // The kernel's I2C_RDWR messages go to the simulated bus:
+                sim_bus_head[specs[i].bus] = &sims[i];
+                i2cdev_standin(&sim_i2cdevs[specs[i].bus],
+                               &sim_buses[specs[i].bus], sim_i2c_transfer,
+                               &sims[i]);
+            } else {
+                sim_bus_head[specs[i].bus] = &sims[i];
+                sim_bus(&sims[i], &sim_buses[specs[i].bus]);
+            }
 
-    if ((ret = configure_device(ism330dlc_addr, FIFO_CTRL5, config, 1)) < 0) {
-        return ret;
+            sensor_buses[i] = &sim_buses[specs[i].bus];
+        }
+    } else if (backend != BACKEND_PI_I2C) {
+        for (i = 0; i < num_sensors; i++) {
+            if (backend == BACKEND_I2CDEV) {
+                sensor_buses[i] = i2cdev_adapter_bus(specs[i].bus);
+            } else if (spidev_open(&spidevs[i], &spi_buses[i], specs[i].bus,
+                                   specs[i].device_addr,
+                                   SPIDEV_MAX_SPEED_HZ) == 0) {
+                printf("Using /dev/spidev%d.%d at %.1f MHz\n", specs[i].bus,
+                       specs[i].device_addr, SPIDEV_MAX_SPEED_HZ * 1e-6);
+                sensor_buses[i] = &spi_buses[i];
+            } else {
+                sensor_buses[i] = NULL;
+            }
+
+            if (sensor_buses[i] == NULL) {
+                return -1;
+            }
+        }
+
+        // Turn on the PCA9685:
+        gpio_set_mode(GPIO_OUTPUT, DEVICE_POWER_GPIO);
+        gpio_set(DEVICE_POWER_GPIO);
+
+        power_on_ns = host_now_ns();
+
+        printf("ISM330DLC turned on\n");
+    } else {
+        for (i = 0; i < num_sensors; i++) {
+            if (specs[i].bus != 0) {
+                printf("Only bus 0 (pi_i2c) is available\n");
+                return -1;
+            }
+
+            sensor_buses[i] = &pi_i2c_bus;
+        }
+
+        printf("Configuring pi_i2c:\n");
+        printf("sda_pin = %d\n", sda_pin);
+        printf("sda_pin = %d\n", scl_pin);
+        printf("speed_grade = %d Hz\n", speed_grade);
+
+        // Turn on the PCA9685:
+        gpio_set_mode(GPIO_OUTPUT, DEVICE_POWER_GPIO);
+        gpio_set(DEVICE_POWER_GPIO);
+
+        power_on_ns = host_now_ns();
+
+        printf("ISM330DLC turned on\n");
+
+        // Configure at standard mode:
+        if ((ret = config_i2c(sda_pin, scl_pin, speed_grade)) < 0 ) {
+            printf("config_i2c() failed to configure and returned %d\n", ret);
+            return ret;
+        }
     }
 
-    // Configure accelerometer:
-    // - 56 Hz sampling rate
-    // - Full-scale of plus minus 2Gs
-    config[0] = ACCEL_52_HZ; config[1] = ACCEL_FS_2_G;
+    // Configure every sensor:
+    // - 56 Hz sampling rate (1.66 kHz when streaming)
+    // - Full-scale of plus minus 2Gs and 250 degrees per second
+    for (i = 0; i < num_sensors; i++) {
+        if ((ret = sensor_open(&sensors[i], i, sensor_buses[i],
+                               specs[i].device_addr, &config)) < 0) {
+            return ret;
+        }
+
+        convert_scale_init(&out.scales[i], config.accel_fs, config.gyro_fs,
+                           units);
+        convert_scale_init(&out.si_scales[i], config.accel_fs,
+                           config.gyro_fs, CONVERT_SI);
+        fusion_init(&out.fusions[i], filter);
+
+        // Pick up where the last run left the calibration:
+        if (calibrate) {
+            snprintf(profile_path, sizeof(profile_path), CALIB_PROFILE_FORMAT,
+                     specs[i].bus, specs[i].device_addr);
+
+            if (calib_load(&profile, profile_path) == 0) {
+                printf("Loaded calibration of sensor %d from %s\n", i,
+                       profile_path);
+                ret = sensor_calibrate(&sensors[i], &profile);
+            } else {
+                ret = sensor_calibrate(&sensors[i], NULL);
+            }
+
+            if (ret < 0) {
+                return ret;
+            }
+        }
+
+        if (simulate) {
+            sim_power(&sims[i], &sim_switches[i]);
+            sensors[i].recovery.power = &sim_switches[i];
+        } else {
+            sensors[i].recovery.power = &gpio_switch;
+        }
+
+        if (!config.interrupt) {
+            continue;
+        }
+
+        if (simulate) {
+            sim_irq(&sims[i], &irqs[i]);
+        } else if ((ret = gpio_irq_open(&gpio_int1[num_gpio_irqs], &irqs[i],
+                                        DEVICE_INT1_CHIP,
+                                        specs[i].int1_gpio)) < 0) {
+            return ret;
+        } else {
+            num_gpio_irqs++;
+        }
+
+        sensors[i].irq = &irqs[i];
+
+        printf("Waiting on INT1 of sensor %d through %s\n", i, irqs[i].name);
+    }
+
+    // Let the sensors settle, all of them before any starts streaming so no
+    // FIFO fills while the others settle:
+    if (!config.fast_start) {
+        bus_delay_us(sensors[0].bus, 1e6);
+    }
+
+    for (i = 0; i < num_sensors; i++) {
+        if ((ret = sensor_settle(&sensors[i])) < 0) {
+            return ret;
+        }
+
+        printf("Sensor %d settled %.1f ms after power-on\n", i,
+               (sensors[i].settled_ns - power_on_ns) * 1e-6);
+    }
+
+    // Start streaming:
+    // - Continuous mode with both data sets at 1.66 kHz
+    // - Timestamp as the 4th data set with -t
+    sched_init(&sched, number_of_samples);
+
+    for (i = 0; i < num_sensors; i++) {
+        if ((ret = sensor_start(&sensors[i], RING_FRAMES)) < 0) {
+            return ret;
+        }
 
-    if ((ret = configure_device(ism330dlc_addr, CTRL1_XL, config, 2)) < 0) {
-        return ret;
+        sched_add(&sched, &sensors[i]);
     }
 
-    // Configure gyroscope:
-    // - 56 Hz sampling rate
-    // - Full-scale of 250 degrees per second
-    config[0] = GYRO_52_HZ; config[1] = GYRO_FS_250_DPS;
+    // Binary log header (and the shared memory ring's):
+    log_info.accel_odr = odr_to_hz(config.accel_odr);
+    log_info.gyro_odr = odr_to_hz(config.gyro_odr);
+    log_info.accel_fs = config.accel_fs;
+    log_info.gyro_fs = config.gyro_fs;
+    log_info.accel_scale = sensors[0].accel_scale;
+    log_info.gyro_scale = sensors[0].gyro_scale;
 
-    if ((ret = configure_device(ism330dlc_addr, CTRL2_G, config, 2)) < 0) {
-        return ret;
+    out.sensor_column = num_sensors > 1;
+    out.rate_column = config.adaptive;
+
+    if (open_outputs(&out, &log_info, sensors[0].rate_hz, filter >= 0) < 0) {
+        return -1;
     }
 
-    sleep(1);
+    signal(SIGINT, handle_sigint);
+    signal(SIGUSR1, handle_sigusr1);
+
+    // Everything the run needs is allocated by now:
+    if (rt.enabled) {
+        printf("Reading every %.1f us at SCHED_FIFO priority %d%s\n",
+               config.period_ns * 1e-3, rt.priority,
+               rt.cpu >= 0 ? " pinned to a CPU" : "");
+
+        if (rt_lock_memory() < 0) {
+            printf("Running without locked memory\n");
+        }
+
+        sched.rt = &rt;
+    }
 
     printf("Getting accelerometer gyroscope data\n");
 
-    // Get a number of samples:
-    for (i = 0; i < number_of_samples; i++) {
-        // Get accelerometer data:
-        if ((ret = get_accel(ism330dlc_addr, ACCEL_FS_2_G, accel_data)) < 0) {
-            return ret;
+    if (sched_start(&sched) < 0) {
+        return -1;
+    }
+
+    // Write the merged stream out while the bus threads run:
+    while (1) {
+        if (stop_requested) {
+            sched_stop(&sched);
         }
 
-        // Get gyroscope data:
-        if ((ret = get_gyro(ism330dlc_addr, GYRO_FS_250_DPS, gyro_data)) < 0) {
-            return ret;
+        if (dump_requested) {
+            dump_requested = 0;
+            dump_metrics(sensors, num_sensors);
         }
 
-        // Grab the time:
-        clock_gettime(CLOCK_MONOTONIC, &sample_time);
+        num_frames = sched_pop(&sched, frames, CONSUMER_BATCH);
 
-        // Save off data for later:
-        sample_second[i] = sample_time.tv_sec;
-        sample_nano_second[i] = sample_time.tv_nsec;
+        if (num_frames == 0) {
+            if (sched_finished(&sched)) {
+                break;
+            }
 
-        accel_x[i] = accel_data[0];
-        accel_y[i] = accel_data[1];
-        accel_z[i] = accel_data[2];
+            nanosleep(&idle, NULL);
+            continue;
+        }
 
-        gyro_x[i] = gyro_data[0];
-        gyro_y[i] = gyro_data[1];
-        gyro_z[i] = gyro_data[2];
+        // Time to the first valid sample of every sensor:
+        if (started < num_sensors) {
+            for (i = 0; i < (int) num_frames; i++) {
+                if (first_ns[frames[i].sensor] == 0) {
+                    first_ns[frames[i].sensor] = host_now_ns();
+                    started++;
+
+                    printf("Sensor %d: first valid sample %.1f ms after "
+                           "power-on\n", frames[i].sensor,
+                           (first_ns[frames[i].sensor] - power_on_ns) * 1e-6);
+                }
+            }
+        }
 
-        microsleep_hard(0.05e6);
+        // Gyroscope bias as calibration has it now:
+        for (i = 0; calibrate && (i < num_sensors); i++) {
+            calib_gyro_bias(&sensors[i].calib, gyro_bias);
+            convert_scale_bias(&out.scales[i], gyro_bias);
+            convert_scale_bias(&out.si_scales[i], gyro_bias);
+        }
+
+        if (write_frames(&out, frames, num_frames) < 0) {
+            sched_stop(&sched);
+            break;
+        }
     }
 
+    status = sched_join(&sched);
+
     printf("Finished test\n");
-    printf("Writing results to test_ism330dlc.csv\n");
+    printf("Wrote %lu samples\n", out.written);
+
+    dump_metrics(sensors, num_sensors);
 
-    // Create a CSV file and write data to it
-    fpt = fopen("test_ism330dlc.csv", "w+");
+    for (i = 0; calibrate && (i < num_sensors); i++) {
+        if (sensors[i].calib.profile.windows == 0) {
+            continue;
+        }
 
-    fprintf(fpt,"Sample Timestamp, Acceleration X, Acceleration Y,"\
-            " Acceleration Z, Gyroscope X, Gyroscope Y, Gyroscope Z\n");
+        snprintf(profile_path, sizeof(profile_path), CALIB_PROFILE_FORMAT,
+                 specs[i].bus, specs[i].device_addr);
 
-    for (i = 0; i < number_of_samples; i++) {
-        fprintf(fpt,"%.3f, %.3f, %.3f, %.3f, %.3f, %.3f, %.3f\n",
-                sample_second[i] + sample_nano_second[i] * 1e-9, accel_x[i],
-                accel_y[i], accel_z[i], gyro_x[i], gyro_y[i], gyro_z[i]);
+        if (calib_save(&sensors[i].calib.profile, profile_path) == 0) {
+            printf("Saved calibration of sensor %d to %s\n", i, profile_path);
+        }
     }
 
     // Done writing so let's close it:
-    fclose(fpt);
+    close_outputs(&out);
 
-    // Turn off the PCA9685:
-    gpio_clear(DEVICE_POWER_GPIO);
+    for (i = 0; i < num_sensors; i++) {
+        sensor_close(&sensors[i]);
+    }
 
-    printf("ISM330DLC turned off\n");
+    for (i = 0; i < num_gpio_irqs; i++) {
+        gpio_irq_close(&gpio_int1[i]);
+    }
 
-    return 0;
+    if (!simulate) {
+        // Turn off the PCA9685:
+        gpio_clear(DEVICE_POWER_GPIO);
+
+        printf("ISM330DLC turned off\n");
+    }
+
+    return status;
 }
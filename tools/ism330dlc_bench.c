@@ -0,0 +1,373 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdlib.h> // C Standard library
+#include <stdio.h>  // C Standard I/O libary
+#include <stdint.h> // C Standard integer types
+
+// Include POSIX headers:
+#include <unistd.h> // POSIX unlink
+
+// Include user headers:
+#include "ism330dlc.h"           // ISM330DLC driver
+#include "ism330dlc_convert.h"   // ISM330DLC unit conversion
+#include "ism330dlc_fifo.h"      // ISM330DLC FIFO streaming
+#include "ism330dlc_log.h"       // ISM330DLC binary log
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+#include "ism330dlc_sim.h"       // Simulated ISM330DLC
+
+// Benchmarks of the host side of every stage between the bus and the output
+// files, run against the simulated device on its virtual clock so the bus
+// itself costs nothing and only our own code is timed. Results go to stdout
+// as one JSON object so runs of different builds can be compared (make
+// bench).
+
+#define BENCH_ADDR 0x6A
+
+// Iterations of every benchmark:
+#define BENCH_CONFIGS 200000
+#define BENCH_SAMPLES 100000
+#define BENCH_DRAINS 5000
+#define BENCH_CONVERSIONS 2000
+#define BENCH_OUTPUTS 200
+
+// Frames per conversion and output batch (the consumer batch of
+// test_ism330dlc):
+#define BENCH_FRAMES 256
+
+// FIFO at 1.66 kHz drained 64 frames apart, plus however long each burst
+// takes on the bus:
+#define BENCH_DRAIN_US 38400
+#define BENCH_WATERMARK_FRAMES 64
+
+// Polling interval of get_frames() at 1.66 kHz:
+#define BENCH_POLL_US 100
+
+#define BENCH_LOG_PATH "ism330dlc_bench.bin"
+
+static struct ism330dlc_sim sim;
+static struct ism330dlc_bus bus;
+
+static struct fifo_stream stream;
+
+static struct ism330dlc_frame frames[FIFO_WORDS];
+static struct convert_sample samples[BENCH_FRAMES];
+static struct convert_sample_q samples_q[BENCH_FRAMES];
+
+static uint64_t latency_ns[BENCH_SAMPLES];
+
+// A fresh simulated device on a 400 kHz bus that only exists in memory:
+static void bench_device(void) {
+    struct ism330dlc_sim_config config = {
+        .device_addr = BENCH_ADDR,
+        .realtime = 0,
+        .latency_us = 50,
+        .byte_ns = 22500,
+        .seed = 1
+    };
+
+    sim_init(&sim, &config);
+    sim_bus(&sim, &bus);
+}
+
+static int compare_ns(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+// "name": {"count": n, "p50_ns": ..., "p99_ns": ..., "max_ns": ...}
+static void print_latency(const char *name, uint64_t *ns, size_t count) {
+    qsort(ns, count, sizeof(*ns), compare_ns);
+
+    printf("  \"%s\": {\"count\": %zu, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+           "\"max_ns\": %llu},\n", name, count,
+           (unsigned long long) ns[count / 2],
+           (unsigned long long) ns[count * 99 / 100],
+           (unsigned long long) ns[count - 1]);
+}
+
+// "name": {"count": n, "ns_per_op": ..., "ops_per_s": ...}
+static void print_rate(const char *name, unsigned long count,
+                       uint64_t elapsed_ns, const char *last) {
+    printf("  \"%s\": {\"count\": %lu, \"ns_per_op\": %.1f, \"ops_per_s\": "
+           "%.0f}%s\n", name, count, (double) elapsed_ns / count,
+           count * 1e9 / elapsed_ns, last);
+}
+
+// Read-modify-write of one register, the way every setting is made:
+static int bench_configure(void) {
+    int configs[2] = {ACCEL_52_HZ, ACCEL_FS_2_G};
+
+    uint64_t start_ns;
+    int i;
+
+    bench_device();
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < BENCH_CONFIGS; i++) {
+        if (configure_device(&bus, BENCH_ADDR, CTRL1_XL, configs, 2) < 0) {
+            return -1;
+        }
+    }
+
+    print_rate("configure_device", BENCH_CONFIGS,
+               metrics_now_ns() - start_ns, ",");
+
+    return 0;
+}
+
+// One polled sample at a time through get_frames() at 1.66 kHz:
+static int bench_polled(void) {
+    int configs[1] = {ACCEL_1_DOT_66_K_HZ};
+    int gyro_configs[1] = {GYRO_1_DOT_66_K_HZ};
+
+    uint64_t start_ns;
+    int i;
+
+    bench_device();
+
+    if ((configure_device(&bus, BENCH_ADDR, CTRL1_XL, configs, 1) < 0) ||
+        (configure_device(&bus, BENCH_ADDR, CTRL2_G, gyro_configs, 1) < 0)) {
+        return -1;
+    }
+
+    for (i = 0; i < BENCH_SAMPLES; i++) {
+        start_ns = metrics_now_ns();
+
+        if (get_frames(&bus, BENCH_ADDR, frames, 1, BENCH_POLL_US) < 0) {
+            return -1;
+        }
+
+        latency_ns[i] = metrics_now_ns() - start_ns;
+    }
+
+    print_latency("polled_sample", latency_ns, BENCH_SAMPLES);
+
+    return 0;
+}
+
+// Watermark bursts out of the FIFO at 1.66 kHz, per burst and per frame:
+static int bench_fifo(void) {
+    struct fifo_config config = {
+        .mode = FIFO_CONTINUOUS_MODE,
+        .odr = FIFO_ODR_1_DOT_66_K_HZ,
+        .dec_gyro = DEC_FIFO_GYRO_NO_DECIMATION,
+        .dec_accel = DEC_FIFO_XL_NO_DECIMATION,
+        .watermark = 6 * BENCH_WATERMARK_FRAMES
+    };
+
+    int configs[1] = {ACCEL_1_DOT_66_K_HZ};
+    int gyro_configs[1] = {GYRO_1_DOT_66_K_HZ};
+
+    uint64_t start_ns;
+    uint64_t total_ns = 0;
+    unsigned long total_frames = 0;
+    int ret;
+    int i;
+
+    bench_device();
+
+    if ((configure_device(&bus, BENCH_ADDR, CTRL1_XL, configs, 1) < 0) ||
+        (configure_device(&bus, BENCH_ADDR, CTRL2_G, gyro_configs, 1) < 0) ||
+        (configure_fifo(&bus, BENCH_ADDR, &config, &stream) < 0)) {
+        return -1;
+    }
+
+    for (i = 0; i < BENCH_DRAINS; i++) {
+        bus_delay_us(&bus, BENCH_DRAIN_US);
+
+        start_ns = metrics_now_ns();
+
+        if ((ret = drain_fifo(&stream, frames, FIFO_WORDS)) < 0) {
+            return -1;
+        }
+
+        latency_ns[i] = metrics_now_ns() - start_ns;
+
+        total_ns += latency_ns[i];
+        total_frames += ret;
+    }
+
+    print_latency("fifo_burst", latency_ns, BENCH_DRAINS);
+    print_rate("fifo_frame", total_frames, total_ns, ",");
+
+    return 0;
+}
+
+// Raw frames with every axis in use:
+static void make_frames(void) {
+    int i;
+    int axis;
+
+    srand(1);
+
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        for (axis = 0; axis < 3; axis++) {
+            frames[i].gyro[axis] = (rand() % 2001) - 1000;
+            frames[i].accel[axis] = (rand() % 2001) - 1000;
+        }
+
+        frames[i].accel[2] += 16384;
+        frames[i].timestamp_ns = i * 602410ULL;
+        frames[i].sensor = 0;
+        frames[i].flags = FRAME_GYRO | FRAME_ACCEL;
+    }
+}
+
+static void bench_convert(const struct convert_scale *scale) {
+    uint64_t start_ns;
+    int i;
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < BENCH_CONVERSIONS; i++) {
+        convert_frames(scale, frames, BENCH_FRAMES, samples);
+    }
+
+    print_rate("convert_frame", BENCH_CONVERSIONS * BENCH_FRAMES,
+               metrics_now_ns() - start_ns, ",");
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < BENCH_CONVERSIONS; i++) {
+        convert_frames_q(scale, frames, BENCH_FRAMES, samples_q);
+    }
+
+    print_rate("convert_frame_q", BENCH_CONVERSIONS * BENCH_FRAMES,
+               metrics_now_ns() - start_ns, ",");
+}
+
+// test_ism330dlc.csv rows (conversion included) to a temporary file:
+static int bench_csv(const struct convert_scale *scale) {
+    FILE *csv;
+
+    uint64_t start_ns;
+    long bytes;
+    int i;
+    int j;
+
+    if ((csv = tmpfile()) == NULL) {
+        perror("tmpfile");
+        return -1;
+    }
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < BENCH_OUTPUTS; i++) {
+        convert_frames(scale, frames, BENCH_FRAMES, samples);
+
+        for (j = 0; j < BENCH_FRAMES; j++) {
+            fprintf(csv, "%.6f, %d, %.3f, %.3f, %.3f, %.3f, %.3f, %.3f\n",
+                    frames[j].timestamp_ns * 1e-9, frames[j].sensor,
+                    samples[j].accel[0], samples[j].accel[1],
+                    samples[j].accel[2], samples[j].gyro[0],
+                    samples[j].gyro[1], samples[j].gyro[2]);
+        }
+    }
+
+    fflush(csv);
+
+    print_rate("csv_frame", BENCH_OUTPUTS * BENCH_FRAMES,
+               metrics_now_ns() - start_ns, ",");
+
+    bytes = ftell(csv);
+
+    printf("  \"csv_bytes_per_frame\": %.1f,\n",
+           (double) bytes / (BENCH_OUTPUTS * BENCH_FRAMES));
+
+    fclose(csv);
+
+    return 0;
+}
+
+// test_ism330dlc.bin records through log_append():
+static int bench_log(void) {
+    struct log_writer log;
+    struct log_header info = {0};
+
+    uint64_t start_ns;
+    int i;
+
+    if (log_open(&log, BENCH_LOG_PATH, &info) < 0) {
+        return -1;
+    }
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < BENCH_OUTPUTS; i++) {
+        if (log_append(&log, frames, BENCH_FRAMES) < 0) {
+            log_close(&log);
+            unlink(BENCH_LOG_PATH);
+            return -1;
+        }
+    }
+
+    print_rate("binary_frame", BENCH_OUTPUTS * BENCH_FRAMES,
+               metrics_now_ns() - start_ns, ",");
+
+    printf("  \"binary_bytes_per_frame\": %zu\n", sizeof(struct log_record));
+
+    log_close(&log);
+    unlink(BENCH_LOG_PATH);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    struct convert_scale scale;
+
+    printf("{\n");
+
+    // What was measured:
+    printf("  \"compiler\": \"%s\",\n", __VERSION__);
+#ifdef __OPTIMIZE__
+    printf("  \"optimized\": true,\n");
+#else
+    printf("  \"optimized\": false,\n");
+#endif
+    printf("  \"convert_kernel\": \"%s\",\n", convert_kernel());
+
+    if ((bench_configure() < 0) || (bench_polled() < 0) ||
+        (bench_fifo() < 0)) {
+        fprintf(stderr, "Simulated bus failed\n");
+        return -1;
+    }
+
+    convert_scale_init(&scale, ACCEL_FS_2_G, GYRO_FS_250_DPS, CONVERT_MILLI);
+    make_frames();
+
+    bench_convert(&scale);
+
+    if ((bench_csv(&scale) < 0) || (bench_log() < 0)) {
+        return -1;
+    }
+
+    printf("}\n");
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdlib.h> // C Standard library
+#include <stdio.h>  // C Standard I/O libary
+#include <math.h>   // C Standard math
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc_convert.h"   // ISM330DLC unit conversion
+#include "ism330dlc_fusion.h"    // ISM330DLC attitude estimation
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_registers.h" // ISM330DLC register definitions
+
+// Synthetic stream: level sensor turning about Z at 1.66 kHz with a little
+// noise on every axis
+#define BENCH_FRAMES 1024
+#define BENCH_PERIOD_NS 602410
+#define BENCH_RATE_DPS 90.0
+#define BENCH_UPDATES 1000000
+
+#define PI 3.14159265358979
+
+static struct ism330dlc_frame frames[BENCH_FRAMES];
+static struct convert_sample samples[BENCH_FRAMES];
+static struct convert_sample_q samples_q[BENCH_FRAMES];
+static struct fusion_attitude attitude[BENCH_FRAMES];
+
+// Turn rate the frames average out to [deg/s]:
+static double rate_dps;
+
+static void make_frames(struct convert_scale *scale) {
+    int i;
+    int axis;
+
+    long rate = lround(BENCH_RATE_DPS * PI / 180.0 / scale->gyro);
+
+    srand(1);
+
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        for (axis = 0; axis < 3; axis++) {
+            frames[i].gyro[axis] = (rand() % 21) - 10;
+            frames[i].accel[axis] = (rand() % 21) - 10;
+        }
+
+        frames[i].gyro[2] += rate;
+        frames[i].accel[2] += lround(GRAVITY_CONSTANT / scale->accel);
+        frames[i].sensor = 0;
+    }
+
+    convert_frames(scale, frames, BENCH_FRAMES, samples);
+    convert_frames_q(scale, frames, BENCH_FRAMES, samples_q);
+
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        rate_dps += samples[i].gyro[2] * 180.0 / PI / BENCH_FRAMES;
+    }
+}
+
+// Heading error against the turn actually simulated [deg]:
+static double yaw_error(const float *q, long updates) {
+    float euler[3];
+
+    double expected = fmod(rate_dps * updates * BENCH_PERIOD_NS * 1e-9,
+                           360.0);
+    double error;
+
+    fusion_euler(q, euler);
+
+    error = fmod(euler[2] * 180.0 / PI - expected + 540.0, 360.0) - 180.0;
+
+    return error;
+}
+
+static void report(const char *name, const float *q, long updates,
+                   uint64_t elapsed_ns) {
+    float euler[3];
+
+    fusion_euler(q, euler);
+
+    printf("%-16s %8.1f ns/update  roll %6.2f pitch %6.2f yaw error %6.2f "
+           "deg\n", name, (double) elapsed_ns / updates,
+           euler[0] * 180.0 / PI, euler[1] * 180.0 / PI,
+           yaw_error(q, updates));
+}
+
+// Time every filter over the same stream:
+int main(int argc, char **argv) {
+    struct convert_scale scale;
+    struct fusion fusion;
+
+    long updates = argc > 1 ? atol(argv[1]) : BENCH_UPDATES;
+    long i;
+
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+
+    float q[4];
+    int filter;
+    int j;
+
+    if (updates < BENCH_FRAMES) {
+        printf("Usage: %s [updates >= %d]\n", argv[0], BENCH_FRAMES);
+        return -1;
+    }
+
+    convert_scale_init(&scale, ACCEL_FS_2_G, GYRO_FS_250_DPS, CONVERT_SI);
+    make_frames(&scale);
+
+    for (filter = FUSION_MADGWICK; filter <= FUSION_MAHONY; filter++) {
+        fusion_init(&fusion, filter);
+
+        start_ns = metrics_now_ns();
+
+        for (i = 0; i < updates; i++) {
+            fusion_update(&fusion, &samples[i % BENCH_FRAMES],
+                          i * BENCH_PERIOD_NS);
+        }
+
+        elapsed_ns = metrics_now_ns() - start_ns;
+
+        report(filter == FUSION_MADGWICK ? "madgwick float" : "mahony float",
+               fusion.q, updates - 1, elapsed_ns);
+    }
+
+    fusion_init(&fusion, FUSION_MAHONY);
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < updates; i++) {
+        fusion_update_q(&fusion, &samples_q[i % BENCH_FRAMES],
+                        i * BENCH_PERIOD_NS);
+    }
+
+    elapsed_ns = metrics_now_ns() - start_ns;
+
+    for (j = 0; j < 4; j++) {
+        q[j] = fusion.q_q[j] / 1073741824.0f;
+    }
+
+    report("mahony fixed", q, updates - 1, elapsed_ns);
+
+    // Conversion and update together the way test_ism330dlc runs them:
+    fusion_init(&fusion, FUSION_MADGWICK);
+
+    start_ns = metrics_now_ns();
+
+    for (i = 0; i < updates; i += BENCH_FRAMES) {
+        for (j = 0; j < BENCH_FRAMES; j++) {
+            frames[j].timestamp_ns = (i + j) * BENCH_PERIOD_NS;
+        }
+
+        fusion_frames(&fusion, &scale, frames, BENCH_FRAMES, attitude);
+    }
+
+    elapsed_ns = metrics_now_ns() - start_ns;
+
+#ifdef ISM330DLC_FUSION_FIXED
+    report("frames (fixed)", attitude[BENCH_FRAMES - 1].q, i - 1,
+           elapsed_ns);
+#else
+    report("frames (float)", attitude[BENCH_FRAMES - 1].q, i - 1,
+           elapsed_ns);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdio.h>  // C Standard I/O libary
+#include <stdint.h> // C Standard integer types
+
+// Include user headers:
+#include "ism330dlc_log.h"       // ISM330DLC binary log
+
+// Convert a binary sample log into the test_ism330dlc.csv layout:
+int main(int argc, char **argv) {
+    struct log_view view;
+
+    const struct log_record *record;
+
+    FILE* fpt;
+
+    uint64_t i;
+
+    int sensor_column = 0;
+    int rate_column = 0;
+
+    if (argc < 2) {
+        printf("Usage: %s <log> [csv]\n", argv[0]);
+        return -1;
+    }
+
+    if (log_map(&view, argv[1]) < 0) {
+        return -1;
+    }
+
+    fpt = fopen(argc > 2 ? argv[2] : "test_ism330dlc.csv", "w+");
+
+    if (fpt == NULL) {
+        perror("fopen");
+        log_unmap(&view);
+        return -1;
+    }
+
+    // Sensor ID as the last column only for a log of more than one sensor,
+    // and before it FRAME_RATE as a Rate Change column only for a log with
+    // output data rate changes (-A):
+    for (i = 0; i < view.num_records; i++) {
+        if (view.records[i].sensor != 0) {
+            sensor_column = 1;
+        }
+
+        if (view.records[i].flags & FRAME_RATE) {
+            rate_column = 1;
+        }
+    }
+
+    fprintf(fpt,"Sample Timestamp, Acceleration X, Acceleration Y,"\
+            " Acceleration Z, Gyroscope X, Gyroscope Y, Gyroscope Z%s%s\n",
+            rate_column ? ", Rate Change" : "",
+            sensor_column ? ", Sensor" : "");
+
+    for (i = 0; i < view.num_records; i++) {
+        record = &view.records[i];
+
+        fprintf(fpt,"%.6f, %.3f, %.3f, %.3f, %.3f, %.3f, %.3f",
+                record->timestamp_ns * 1e-9,
+                view.header->accel_scale * record->accel[0],
+                view.header->accel_scale * record->accel[1],
+                view.header->accel_scale * record->accel[2],
+                view.header->gyro_scale * record->gyro[0],
+                view.header->gyro_scale * record->gyro[1],
+                view.header->gyro_scale * record->gyro[2]);
+
+        if (rate_column) {
+            fprintf(fpt, ", %d", (record->flags & FRAME_RATE) != 0);
+        }
+
+        if (sensor_column) {
+            fprintf(fpt, ", %d", record->sensor);
+        }
+
+        fputc('\n', fpt);
+    }
+
+    fclose(fpt);
+
+    printf("Converted %llu records (%llu committed) at %.1f/%.1f Hz\n",
+           (unsigned long long) view.num_records,
+           (unsigned long long) view.header->records,
+           view.header->accel_odr, view.header->gyro_odr);
+
+    log_unmap(&view);
+
+    return 0;
+}
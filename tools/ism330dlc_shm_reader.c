@@ -0,0 +1,113 @@
+// Raspberry Pi ISM330DLC Example
+//
+// Copyright (c) 2022 Benjamin Spencer
+// ============================================================================
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// ============================================================================
+
+// Include C standard libraries:
+#include <stdlib.h> // C Standard library
+#include <stdio.h>  // C Standard I/O libary
+#include <stdint.h> // C Standard integer types
+#include <time.h>   // C Standard date and time manipulation
+
+// Include user headers:
+#include "ism330dlc_metrics.h"   // ISM330DLC bus metrics
+#include "ism330dlc_shm.h"       // ISM330DLC shared memory ring
+
+// How often the reader reports and how long it naps once caught up
+#define REPORT_NS 1000000000ULL
+#define IDLE_NS 1000000
+
+// Follow the frames test_ism330dlc -p publishes, optionally spending work_us
+// on every frame to play a slow consumer, and report once a second how far
+// behind the reader is and what it lost:
+int main(int argc, char **argv) {
+    struct shm_reader reader;
+
+    const struct ism330dlc_frame *frame;
+
+    const char *name = argc > 1 ? argv[1] : SHM_DEFAULT_NAME;
+    uint64_t work_ns = argc > 2 ? strtoull(argv[2], NULL, 0) * 1000 : 0;
+
+    struct timespec idle = {0, IDLE_NS};
+
+    uint64_t report_ns;
+    uint64_t now_ns;
+    uint64_t latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+    uint64_t frames = 0;
+    uint64_t done_ns;
+
+    if (shm_reader_open(&reader, name) < 0) {
+        printf("Usage: %s [name] [work_us]\n", argv[0]);
+        return -1;
+    }
+
+    printf("Following %s: %u slots, %.1f/%.1f Hz\n", name,
+           reader.header->capacity, reader.header->accel_odr,
+           reader.header->gyro_odr);
+
+    report_ns = metrics_now_ns() + REPORT_NS;
+
+    while (1) {
+        if (shm_reader_peek(&reader, &frame)) {
+            // Publication to here (both on CLOCK_MONOTONIC):
+            now_ns = metrics_now_ns();
+
+            if (now_ns > frame->timestamp_ns) {
+                latency_ns = now_ns - frame->timestamp_ns;
+            }
+
+            done_ns = now_ns + work_ns;
+
+            while (work_ns && (metrics_now_ns() < done_ns)) {
+            }
+
+            if ((shm_reader_release(&reader) == 0) &&
+                (latency_ns > max_latency_ns)) {
+                max_latency_ns = latency_ns;
+            }
+        } else if (shm_reader_closed(&reader)) {
+            break;
+        } else {
+            nanosleep(&idle, NULL);
+        }
+
+        if ((now_ns = metrics_now_ns()) >= report_ns) {
+            printf("%llu frames/s, lag %llu, overruns %llu, max age %.3f ms\n",
+                   (unsigned long long) (reader.frames - frames),
+                   (unsigned long long) shm_reader_lag(&reader),
+                   (unsigned long long) reader.overruns,
+                   max_latency_ns * 1e-6);
+
+            frames = reader.frames;
+            max_latency_ns = 0;
+            report_ns = now_ns + REPORT_NS;
+        }
+    }
+
+    printf("Publisher closed: read %llu frames, lost %llu\n",
+           (unsigned long long) reader.frames,
+           (unsigned long long) reader.overruns);
+
+    shm_reader_close(&reader);
+
+    return 0;
+}